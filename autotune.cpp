@@ -0,0 +1,202 @@
+/*
+ Finds, for a given (device, fft size, kernel variant), the number of butterflies per thread
+ (hence the workgroup size), the number of workgroups, the storage of the twiddle factors,
+ the layout of the local memory (see local_layout.cpp), the storage of the inputs and outputs
+ (buffers or images, see image_io.cpp) and the use of sub-group shuffles (see subgroups.cpp)
+ that minimize the kernel duration, and stores the result in the tuning db (see tuning_db.cpp).
+
+ For the generated kernels ('FftAlgo::StockhamGenerated'), all the combinations of the options
+ of the generator are tried too (see kernel_generator.cpp).
+
+ 'autotuneRealFft' tunes the number of butterflies per thread and the local memory layout of 'GpuRealFftPlan'.
+ */
+
+#include <memory>
+#include <optional>
+
+namespace imajuscule {
+
+  // Returns the average kernel duration in nanoseconds.
+  template<typename Plan>
+  double averageKernelDuration(Plan & plan, int nIterations, int nSkipIterations) {
+    double elapsed = 0.;
+    for(int i=0; i<nSkipIterations+nIterations; ++i)
+    {
+      cl_event event = plan.enqueue();
+
+      cl_int ret = clWaitForEvents(1, &event);
+      CHECK_CL_ERROR(ret);
+
+      if(i>=nSkipIterations) {
+        elapsed += commandDuration(event);
+      }
+      ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+    }
+    return elapsed / nIterations;
+  }
+
+  template<typename T>
+  GpuFftConfig autotune(cl_context context,
+                        cl_device_id device_id,
+                        cl_command_queue command_queue,
+                        int size,
+                        FftAlgo algo,
+                        std::string const & kernel_file = {},
+                        int nIterations = 100) {
+    constexpr int nSkipIterations = 5;
+    std::string const variant = kernel_file.empty() ? defaultKernelFile(algo) : kernel_file;
+    // (several algorithms share a kernel file, e.g. the Cooley-Tukey kernels with and without the bit reversal)
+    std::string const tuned = tuningVariant(algo, variant, FftPrecision<T, T>::name());
+
+    // The input values have no influence on the kernel duration.
+    std::vector<T> input(size);
+    for(int i=0; i<size; ++i) {
+      input[i] = std::sin(static_cast<T>(i));
+    }
+
+    std::optional<TuningEntry> best;
+
+    // The kernels compute the whole fft in a single workgroup, so the number of workgroups is 1
+    // and the workgroup size is 'size/(2*nButterfliesPerThread)'.
+    int const nWorkgroups = 1;
+    bool const generated = (algo == FftAlgo::StockhamGenerated);
+    std::string const kernel_src = generated ? std::string{} : read_kernel(variant);
+    bool const tables = generated || kernelSupportsTwiddleTables(kernel_src);
+    std::vector<GeneratedKernelOptions> const generatorOptions = generated ? allGeneratedKernelOptions() :
+                                                                             std::vector<GeneratedKernelOptions>{{}};
+    std::vector<IoStorage> const ioOptions = (std::is_same_v<T, float> && kernelSupportsImageIo(kernel_src)) ?
+                                             std::vector<IoStorage>(std::begin(explicitIoStorages), std::end(explicitIoStorages)) :
+                                             std::vector<IoStorage>{IoStorage::Buffers};
+    std::vector<SubgroupShuffles> const shuffleOptions = (kernelSupportsSubgroupShuffles(kernel_src) &&
+                                                          subgroupExtension(device_id) != SubgroupExtension::None) ?
+                                                         std::vector<SubgroupShuffles>(std::begin(explicitSubgroupShuffles), std::end(explicitSubgroupShuffles)) :
+                                                         std::vector<SubgroupShuffles>{SubgroupShuffles::Off};
+    std::vector<LocalLayout> const layoutOptions = (generated || kernelSupportsLocalLayouts(kernel_src)) ?
+                                                   std::vector<LocalLayout>(std::begin(explicitLocalLayouts), std::end(explicitLocalLayouts)) :
+                                                   std::vector<LocalLayout>{LocalLayout::Interleaved};
+    for(int nButterfliesPerThread = 1; nButterfliesPerThread <= size/2; nButterfliesPerThread *= 2) {
+      for(auto twiddles : explicitTwiddleStorages) {
+        if(!tables && twiddles != TwiddleStorage::OnTheFly) {
+          continue;
+        }
+        for(auto const & generator : generatorOptions) {
+          for(auto layout : layoutOptions) {
+            for(auto io : ioOptions) {
+              for(auto shuffles : shuffleOptions) {
+                GpuFftConfig config;
+                config.nButterfliesPerThread = nButterfliesPerThread;
+                config.nWorkgroups = nWorkgroups;
+                config.twiddles = twiddles;
+                config.generator = generator;
+                config.layout = layout;
+                config.io = io;
+                config.shuffles = shuffles;
+
+                std::unique_ptr<GpuFftPlan<T>> plan;
+                double duration;
+                try {
+                  plan = std::make_unique<GpuFftPlan<T>>(context, device_id, command_queue, size, algo, variant, config);
+                  if(plan->getIoStorage() != io || plan->getSubgroupShuffles() != shuffles) {
+                    // the plan fell back to buffers (or to local memory), which are tuned already.
+                    continue;
+                  }
+                  plan->write(input);
+                  duration = averageKernelDuration(*plan, nIterations, nSkipIterations);
+                }
+                catch(std::runtime_error const & e) {
+                  // this configuration is not supported by the device.
+                  continue;
+                }
+                catch(const char * e) {
+                  // an OpenCL error (see 'kill' in error_check.cpp): the device can't run this configuration.
+                  continue;
+                }
+
+                std::cout << "tuning " << tuned << " size " << size << ": "
+                << nButterfliesPerThread << " butterflies per thread, "
+                << plan->getLocalSize() << " items per workgroup, "
+                << nWorkgroups << " workgroup(s), "
+                << toString(twiddles) << " twiddles, "
+                << toString(layout) << " layout, "
+                << toString(io) << " io, "
+                << toString(shuffles) << " shuffles"
+                << (generated ? ", generator " + toString(generator) : std::string{}) << ": " << duration/1000. << " us" << std::endl;
+
+                if(!best || duration < best->duration_ns) {
+                  best = TuningEntry{config, duration};
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    if(!best) {
+      throw std::runtime_error("no configuration is supported by the device");
+    }
+    TuningDb::getInstance().set(deviceInfoString(device_id, CL_DEVICE_NAME), tuned, size, *best);
+    return best->config;
+  }
+
+  // Like 'autotune', for 'GpuRealFftPlan' (see gpu_real_fft_plan.cpp), whose kernels only have
+  // the number of butterflies per thread and the local memory layout to tune.
+  template<typename T>
+  GpuFftConfig autotuneRealFft(cl_context context,
+                               cl_device_id device_id,
+                               cl_command_queue command_queue,
+                               int size,
+                               int nIterations = 100) {
+    constexpr int nSkipIterations = 5;
+    std::string const tuned = GpuRealFftPlan<T>::tuningDbVariant();
+
+    // The input values have no influence on the kernel duration.
+    std::vector<T> signal(size);
+    for(int i=0; i<size; ++i) {
+      signal[i] = std::sin(static_cast<T>(i));
+    }
+
+    std::optional<TuningEntry> best;
+
+    // The kernels compute the complex fft of size N/2, in a single workgroup.
+    for(int nButterfliesPerThread = 1; nButterfliesPerThread <= size/4; nButterfliesPerThread *= 2) {
+      for(auto layout : explicitLocalLayouts) {
+        GpuFftConfig config;
+        config.nButterfliesPerThread = nButterfliesPerThread;
+        config.nWorkgroups = 1;
+        config.layout = layout;
+
+        std::unique_ptr<GpuRealFftPlan<T>> plan;
+        double duration;
+        try {
+          plan = std::make_unique<GpuRealFftPlan<T>>(context, device_id, command_queue, size, config);
+          plan->writeSignal(signal);
+          duration = averageKernelDuration(*plan, nIterations, nSkipIterations);
+        }
+        catch(std::runtime_error const & e) {
+          // this configuration is not supported by the device.
+          continue;
+        }
+        catch(const char * e) {
+          // an OpenCL error (see 'kill' in error_check.cpp): the device can't run this configuration.
+          continue;
+        }
+
+        std::cout << "tuning " << tuned << " size " << size << ": "
+        << nButterfliesPerThread << " butterflies per thread, "
+        << plan->getLocalSize() << " items per workgroup, "
+        << toString(layout) << " layout: " << duration/1000. << " us" << std::endl;
+
+        if(!best || duration < best->duration_ns) {
+          best = TuningEntry{config, duration};
+        }
+      }
+    }
+    if(!best) {
+      throw std::runtime_error("no configuration is supported by the device");
+    }
+    TuningDb::getInstance().set(deviceInfoString(device_id, CL_DEVICE_NAME), tuned, size, *best);
+    return best->config;
+  }
+
+} // NS imajuscule
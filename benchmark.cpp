@@ -0,0 +1,256 @@
+/*
+ Benchmarks of the fft plans (see main_benchmark.cpp):
+
+ - a 'BenchmarkCase' creates, for a given size and batch count, a 'BenchmarkRunner'
+   which owns a plan and its host vectors,
+ - 'runBenchmark' measures the kernel durations (with the profiling events of the command queue,
+   or on the host for the cpu plans) and the end-to-end durations (transfers included, measured on the host),
+ - the results are written as CSV or JSON, for regression tracking.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+namespace imajuscule {
+
+  // Statistics of the durations of the iterations of a benchmark, in nanoseconds.
+  struct DurationStats {
+    double min = 0.;
+    double median = 0.;
+    double p99 = 0.;
+
+    static DurationStats compute(std::vector<double> durations) {
+      verify(!durations.empty());
+      std::sort(durations.begin(), durations.end());
+      auto const percentile = [&](double p) {
+        size_t const rank = static_cast<size_t>(std::ceil(p * durations.size()));
+        return durations[std::max<size_t>(rank, 1) - 1];
+      };
+      DurationStats s;
+      s.min = durations.front();
+      s.median = percentile(0.5);
+      s.p99 = percentile(0.99);
+      return s;
+    }
+  };
+
+  // Owns what is needed to compute the ffts of a benchmark, for a given size and batch count.
+  struct BenchmarkRunner {
+    virtual ~BenchmarkRunner() = default;
+
+    // Enqueues the kernels of one iteration, using the input that is on the device.
+    // 'events' receives the events of the kernels, they should be released by the caller.
+    // The cpu plans compute synchronously and return no event: the duration is measured on the host.
+    virtual void enqueueKernels(std::vector<cl_event> & events) = 0;
+
+    // Copies the input to the device, computes the ffts, and copies the result from the device.
+    virtual void execute() = 0;
+  };
+
+  template<typename T>
+  std::vector<T> randomInput(size_t n) {
+    std::vector<T> input;
+    input.reserve(n);
+    for(size_t i=0; i<n; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+    return input;
+  }
+
+  template<typename Plan>
+  struct PlanRunnerBase : public BenchmarkRunner {
+    PlanRunnerBase(std::unique_ptr<Plan> p) : plan(std::move(p)) {}
+
+  protected:
+    using Real = typename Plan::Complex::value_type;
+
+    std::unique_ptr<Plan> plan;
+    std::vector<Real> input;
+    std::vector<typename Plan::Complex> output;
+  };
+
+  template<typename Plan>
+  struct FftPlanRunner : public PlanRunnerBase<Plan> {
+    FftPlanRunner(std::unique_ptr<Plan> p) : PlanRunnerBase<Plan>(std::move(p)) {
+      this->input = randomInput<typename PlanRunnerBase<Plan>::Real>(this->plan->inputElements());
+      this->plan->write(this->input);
+    }
+
+    void enqueueKernels(std::vector<cl_event> & events) override {
+      events.clear();
+      events.push_back(this->plan->enqueue());
+    }
+
+    void execute() override {
+      this->plan->execute(this->input, this->output);
+    }
+  };
+
+  template<typename Plan>
+  struct RealFftPlanRunner : public PlanRunnerBase<Plan> {
+    RealFftPlanRunner(std::unique_ptr<Plan> p) : PlanRunnerBase<Plan>(std::move(p)) {
+      this->input = randomInput<typename PlanRunnerBase<Plan>::Real>(this->plan->signalElements());
+      this->plan->writeSignal(this->input);
+    }
+
+    void enqueueKernels(std::vector<cl_event> & events) override {
+      events.clear();
+      events.push_back(this->plan->enqueueForward());
+    }
+
+    void execute() override {
+      this->plan->forward(this->input, this->output);
+    }
+  };
+
+  template<typename Plan>
+  struct HugeFftPlanRunner : public PlanRunnerBase<Plan> {
+    HugeFftPlanRunner(std::unique_ptr<Plan> p) : PlanRunnerBase<Plan>(std::move(p)) {
+      this->input = randomInput<typename PlanRunnerBase<Plan>::Real>(this->plan->size());
+      this->plan->write(this->input);
+    }
+
+    void enqueueKernels(std::vector<cl_event> & events) override {
+      this->plan->enqueue(events);
+    }
+
+    void execute() override {
+      this->plan->execute(this->input, this->output);
+    }
+  };
+
+  template<typename Plan>
+  struct CpuFftPlanRunner : public PlanRunnerBase<Plan> {
+    CpuFftPlanRunner(std::unique_ptr<Plan> p) : PlanRunnerBase<Plan>(std::move(p)) {
+      this->input = randomInput<typename PlanRunnerBase<Plan>::Real>(this->plan->inputElements());
+      this->plan->write(this->input);
+    }
+
+    void enqueueKernels(std::vector<cl_event> & events) override {
+      events.clear();
+      this->plan->compute();
+    }
+
+    void execute() override {
+      this->plan->execute(this->input, this->output);
+    }
+  };
+
+  template<typename Plan>
+  struct CpuHugeFftPlanRunner : public PlanRunnerBase<Plan> {
+    CpuHugeFftPlanRunner(std::unique_ptr<Plan> p) : PlanRunnerBase<Plan>(std::move(p)) {
+      this->input = randomInput<typename PlanRunnerBase<Plan>::Real>(this->plan->size());
+      this->plan->write(this->input);
+    }
+
+    void enqueueKernels(std::vector<cl_event> & events) override {
+      events.clear();
+      this->plan->compute();
+    }
+
+    void execute() override {
+      this->plan->execute(this->input, this->output);
+    }
+  };
+
+  struct BenchmarkCase {
+    // The name of the plan, the kernel file if it is not implied by the name.
+    std::string name, kernel;
+    bool supportsBatches;
+    // Throws std::runtime_error when the device doesn't support the size or the batch count.
+    std::function<std::unique_ptr<BenchmarkRunner>(int size, int batchCount)> makeRunner;
+  };
+
+  struct BenchmarkResult {
+    std::string name, kernel;
+    int size, batchCount, nIterations;
+    DurationStats kernelStats, endToEndStats;
+
+    // We count 2.5 * N * log2(N) floating point operations per fft of N reals,
+    // like the FFTW benchmarks do for real-data transforms, so that the plans computing
+    // complex ffts and the plans packing the reals are compared for the same work.
+    double flops() const {
+      return 2.5 * size * power_of_two_exponent(size) * batchCount;
+    }
+    // The throughput for a duration in nanoseconds
+    double gflops(double duration_ns) const {
+      return flops() / duration_ns;
+    }
+  };
+
+  BenchmarkResult runBenchmark(BenchmarkCase const & c, BenchmarkRunner & runner,
+                               int size, int batchCount, int nIterations, int nSkipIterations) {
+    BenchmarkResult res{c.name, c.kernel, size, batchCount, nIterations, {}, {}};
+
+    std::vector<double> kernelDurations, endToEndDurations;
+    std::vector<cl_event> events;
+    for(int i=0; i<nSkipIterations+nIterations; ++i) {
+      auto const start = std::chrono::steady_clock::now();
+      runner.enqueueKernels(events);
+      double duration = 0.;
+      if(events.empty()) {
+        duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      }
+      else {
+        cl_int ret = clWaitForEvents(events.size(), events.data());
+        CHECK_CL_ERROR(ret);
+      }
+      for(auto e : events) {
+        duration += commandDuration(e);
+        cl_int ret = clReleaseEvent(e);
+        CHECK_CL_ERROR(ret);
+      }
+      if(i>=nSkipIterations) {
+        kernelDurations.push_back(duration);
+      }
+    }
+    for(int i=0; i<nSkipIterations+nIterations; ++i) {
+      auto const start = std::chrono::steady_clock::now();
+      runner.execute();
+      auto const end = std::chrono::steady_clock::now();
+      if(i>=nSkipIterations) {
+        endToEndDurations.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+      }
+    }
+    res.kernelStats = DurationStats::compute(std::move(kernelDurations));
+    res.endToEndStats = DurationStats::compute(std::move(endToEndDurations));
+    return res;
+  }
+
+  // The durations are written in microseconds.
+
+  void writeCsv(std::ostream & os, std::vector<BenchmarkResult> const & results) {
+    os << "name,kernel,size,batch,iterations,"
+    << "kernel_min_us,kernel_median_us,kernel_p99_us,kernel_gflops,"
+    << "e2e_min_us,e2e_median_us,e2e_p99_us,e2e_gflops" << std::endl;
+    for(auto const & r : results) {
+      os << r.name << "," << r.kernel << "," << r.size << "," << r.batchCount << "," << r.nIterations;
+      for(auto const * s : {&r.kernelStats, &r.endToEndStats}) {
+        os << "," << s->min/1000. << "," << s->median/1000. << "," << s->p99/1000. << "," << r.gflops(s->median);
+      }
+      os << std::endl;
+    }
+  }
+
+  void writeJson(std::ostream & os, std::string const & device, std::vector<BenchmarkResult> const & results) {
+    auto const writeStats = [&](const char * key, DurationStats const & s, double gflops) {
+      os << "\"" << key << "\": {\"min_us\": " << s.min/1000. << ", \"median_us\": " << s.median/1000.
+      << ", \"p99_us\": " << s.p99/1000. << ", \"gflops\": " << gflops << "}";
+    };
+    os << "{" << std::endl << "  \"device\": \"" << device << "\"," << std::endl << "  \"results\": [";
+    for(size_t i=0; i<results.size(); ++i) {
+      auto const & r = results[i];
+      os << (i ? "," : "") << std::endl << "    {\"name\": \"" << r.name << "\", \"kernel\": \"" << r.kernel << "\""
+      << ", \"size\": " << r.size << ", \"batch\": " << r.batchCount << ", \"iterations\": " << r.nIterations << ", ";
+      writeStats("kernel", r.kernelStats, r.gflops(r.kernelStats.median));
+      os << ", ";
+      writeStats("e2e", r.endToEndStats, r.gflops(r.endToEndStats.median));
+      os << "}";
+    }
+    os << std::endl << "  ]" << std::endl << "}" << std::endl;
+  }
+
+} // NS imajuscule
@@ -0,0 +1,664 @@
+/*
+ Instrumentation of the OpenCL commands.
+
+ Every enqueue (kernels, buffer and image transfers, copies, fills, maps and unmaps) goes through
+ a wrapper (the 'clEnqueue*' functions are redefined at the end of this file), which, when 'ClTrace'
+ is enabled, records:
+ - the duration of the API call on the host,
+ - the 4 profiling timestamps of the command: QUEUED, SUBMIT, START and END
+   (only if the command queue was created with CL_QUEUE_PROFILING_ENABLE),
+ - the stage of the command: the labels of the 'ClTraceStage' objects alive in the calling thread.
+
+ 'ClTrace::summary' reports, per stage and command, the time spent in the API calls, between QUEUED and SUBMIT
+ (the driver), between SUBMIT and START (waiting for the device) and between START and END (the execution),
+ and for each device, the fraction of the time during which a kernel, a transfer or nothing was executing,
+ and how much the commands overlapped: this tells whether a workload is compute-bound, transfer-bound
+ or launch-bound, and whether the transfers of a pipeline (see gpu_fft_pipeline.cpp) overlap the kernels.
+
+ 'ClTrace::writeChromeTrace' exports the commands in the trace event format, which can be opened
+ in chrome://tracing or https://ui.perfetto.dev: the API calls are on the timelines of the host threads,
+ the executions on the timelines of the command queues, and the pending commands (QUEUED to START)
+ on asynchronous tracks. The device timestamps are converted to the host clock using the API call
+ of the shortest duration of each device.
+
+ The trace is disabled by default. Setting the 'GPGPU_TRACE' environment variable to a file name enables it
+ for the whole program: the trace is written to that file, and the summary printed, at exit.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace imajuscule {
+
+  enum class ClCommand {
+    Kernel,
+    WriteBuffer,
+    ReadBuffer,
+    CopyBuffer,
+    FillBuffer,
+    MapBuffer,
+    UnmapMemObject,
+    WriteImage,
+    ReadImage,
+    MapImage
+  };
+
+  inline const char * toString(ClCommand c) {
+    switch(c) {
+      case ClCommand::Kernel: return "kernel";
+      case ClCommand::WriteBuffer: return "write";
+      case ClCommand::ReadBuffer: return "read";
+      case ClCommand::CopyBuffer: return "copy";
+      case ClCommand::FillBuffer: return "fill";
+      case ClCommand::MapBuffer: return "map";
+      case ClCommand::UnmapMemObject: return "unmap";
+      case ClCommand::WriteImage: return "write image";
+      case ClCommand::ReadImage: return "read image";
+      case ClCommand::MapImage: return "map image";
+    }
+    return "?";
+  }
+
+  inline bool isTransfer(ClCommand c) {
+    return c != ClCommand::Kernel;
+  }
+
+  struct ClTraceRecord {
+    std::string stage;
+    ClCommand command;
+    std::string kernel; // the name of the kernel function, empty for the transfers
+    cl_command_queue queue;
+    cl_device_id device;
+    int thread;
+    size_t bytes;
+    // steady clock, in nanoseconds
+    int64_t hostBegin, hostEnd;
+    // device clock, in nanoseconds
+    bool profiled = false;
+    cl_ulong queued = 0, submit = 0, start = 0, end = 0;
+
+    std::string name() const {
+      return kernel.empty() ? toString(command) : (std::string(toString(command)) + " " + kernel);
+    }
+  };
+
+  struct ClTrace {
+    static ClTrace & getInstance() {
+      static ClTrace t;
+      return t;
+    }
+
+    bool enabled() const { return isEnabled.load(std::memory_order_relaxed); }
+    void enable(bool b) { isEnabled = b; }
+
+    static int64_t hostNow() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // The labels of the 'ClTraceStage' objects alive in the current thread
+    static std::vector<std::string> & stages() {
+      thread_local std::vector<std::string> s;
+      return s;
+    }
+
+    // 'event' is released by the trace if 'ownsEvent', else it is retained.
+    void record(ClCommand command, cl_command_queue queue, cl_kernel kernel, size_t bytes,
+                int64_t hostBegin, int64_t hostEnd, cl_event event, bool ownsEvent) {
+      if(!ownsEvent) {
+        cl_int ret = clRetainEvent(event);
+        CHECK_CL_ERROR(ret);
+      }
+      std::string stage;
+      for(auto const & s : stages()) {
+        if(!stage.empty()) {
+          stage += '/';
+        }
+        stage += s;
+      }
+
+      std::lock_guard<std::mutex> l(mutex);
+      ClTraceRecord r;
+      r.stage = std::move(stage);
+      r.command = command;
+      if(kernel) {
+        r.kernel = kernelName(kernel);
+      }
+      r.queue = queue;
+      r.device = queueDevice(queue);
+      r.thread = threadIndex();
+      r.bytes = bytes;
+      r.hostBegin = hostBegin;
+      r.hostEnd = hostEnd;
+      records.push_back(std::move(r));
+      pending.emplace_back(event, records.size() - 1);
+      if(pending.size() >= maxPending) {
+        collect(false);
+      }
+    }
+
+    // Waits for the recorded commands and reads their timestamps.
+    void flush() {
+      std::lock_guard<std::mutex> l(mutex);
+      collect(true);
+    }
+
+    // Forgets the recorded commands (waiting for the pending ones).
+    void clear() {
+      std::lock_guard<std::mutex> l(mutex);
+      collect(true);
+      records.clear();
+    }
+
+    // The recorded commands, in the order of the API calls
+    std::vector<ClTraceRecord> getRecords() {
+      std::lock_guard<std::mutex> l(mutex);
+      collect(true);
+      return records;
+    }
+
+    void summary(std::ostream & os) {
+      auto const recs = getRecords();
+
+      struct Stats {
+        int count = 0;
+        double host = 0., launch = 0., wait = 0., exec = 0.;
+        size_t bytes = 0;
+      };
+      std::map<std::pair<std::string, std::string>, Stats> stats;
+      for(auto const & r : recs) {
+        auto & s = stats[{r.stage, r.name()}];
+        ++s.count;
+        s.host += r.hostEnd - r.hostBegin;
+        s.bytes += r.bytes;
+        if(r.profiled) {
+          s.launch += r.submit - r.queued;
+          s.wait += r.start - r.submit;
+          s.exec += r.end - r.start;
+        }
+      }
+      os << "stage | command | count | mean durations in us: api call, queued->submit, submit->start, start->end | GB/s" << std::endl;
+      for(auto const & [key, s] : stats) {
+        os << (key.first.empty() ? "-" : key.first) << " | " << key.second << " | " << s.count << " | "
+        << s.host / s.count / 1000. << ", " << s.launch / s.count / 1000. << ", "
+        << s.wait / s.count / 1000. << ", " << s.exec / s.count / 1000.;
+        if(s.bytes && s.exec > 0.) {
+          os << " | " << s.bytes / s.exec;
+        }
+        os << std::endl;
+      }
+
+      for(auto const & [device, d] : deviceActivities(recs)) {
+        if(d.span <= 0.) {
+          continue;
+        }
+        os << "device " << deviceIndex(device) << ", " << d.span / 1000. << " us: "
+        << "kernels " << 100. * d.kernels / d.span << "%, "
+        << "transfers " << 100. * d.transfers / d.span << "%, "
+        << "idle " << 100. * d.idle() / d.span << "%, "
+        << "overlap " << d.overlap() << " -> ";
+        if(d.kernels >= d.transfers && d.kernels >= d.idle()) {
+          os << "compute-bound";
+        }
+        else if(d.transfers >= d.idle()) {
+          os << "transfer-bound";
+        }
+        else {
+          os << "launch-bound";
+        }
+        os << std::endl;
+      }
+    }
+
+    // Writes the recorded commands in the trace event format (chrome://tracing, https://ui.perfetto.dev)
+    void writeChromeTrace(std::string const & path) {
+      auto const recs = getRecords();
+      std::ofstream out(path);
+      if(!out) {
+        throw std::runtime_error("cannot write the trace " + path);
+      }
+      int64_t origin = std::numeric_limits<int64_t>::max();
+      for(auto const & r : recs) {
+        origin = std::min(origin, r.hostBegin);
+      }
+      auto const offsets = deviceToHostOffsets(recs);
+      // in microseconds, relative to the first API call
+      auto host = [origin](int64_t t) { return (t - origin) / 1000.; };
+      auto device = [&](ClTraceRecord const & r, cl_ulong t) {
+        return host(static_cast<int64_t>(t) + offsets.at(r.device));
+      };
+
+      out.precision(15);
+      out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << std::endl;
+      bool first = true;
+      auto event = [&]() -> std::ostream & {
+        if(!first) {
+          out << "," << std::endl;
+        }
+        first = false;
+        return out;
+      };
+
+      event() << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"host\"}}";
+      std::map<cl_command_queue, int> queueIndices;
+      for(auto const & r : recs) {
+        if(!queueIndices.count(r.queue)) {
+          int const i = queueIndices.size();
+          queueIndices[r.queue] = i;
+          event() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << 1 + deviceIndex(r.device)
+          << ",\"tid\":" << i << ",\"args\":{\"name\":\"queue " << i << "\"}}";
+        }
+      }
+      for(auto const & [d, i] : devices) {
+        event() << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << 1 + i
+        << ",\"args\":{\"name\":\"device " << i << "\"}}";
+      }
+
+      for(size_t i=0; i<recs.size(); ++i) {
+        auto const & r = recs[i];
+        std::string const name = escape(r.name());
+        std::string const cat = isTransfer(r.command) ? "transfer" : "kernel";
+        std::string const stage = escape(r.stage);
+        event() << "{\"name\":\"" << name << "\",\"cat\":\"api\",\"ph\":\"X\",\"pid\":0,\"tid\":" << r.thread
+        << ",\"ts\":" << host(r.hostBegin) << ",\"dur\":" << (r.hostEnd - r.hostBegin) / 1000.
+        << ",\"args\":{\"stage\":\"" << stage << "\"}}";
+        if(!r.profiled) {
+          continue;
+        }
+        int const pid = 1 + deviceIndex(r.device);
+        int const tid = queueIndices[r.queue];
+        event() << "{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+        << ",\"ts\":" << device(r, r.start) << ",\"dur\":" << (r.end - r.start) / 1000.
+        << ",\"args\":{\"stage\":\"" << stage << "\",\"bytes\":" << r.bytes
+        << ",\"queued->submit (us)\":" << (r.submit - r.queued) / 1000.
+        << ",\"submit->start (us)\":" << (r.start - r.submit) / 1000. << "}}";
+        if(r.start == r.queued) {
+          continue;
+        }
+        event() << "{\"name\":\"" << name << "\",\"cat\":\"pending\",\"ph\":\"b\",\"id\":" << i << ",\"pid\":" << pid << ",\"tid\":" << tid
+        << ",\"ts\":" << device(r, r.queued) << "}";
+        event() << "{\"name\":\"" << name << "\",\"cat\":\"pending\",\"ph\":\"e\",\"id\":" << i << ",\"pid\":" << pid << ",\"tid\":" << tid
+        << ",\"ts\":" << device(r, r.start) << "}";
+      }
+      out << std::endl << "]}" << std::endl;
+    }
+
+  private:
+    ClTrace() {
+      const char * env = getenv("GPGPU_TRACE");
+      if(env && *env) {
+        exitTracePath = env;
+        isEnabled = true;
+      }
+    }
+
+    ~ClTrace() {
+      if(exitTracePath.empty()) {
+        return;
+      }
+      try {
+        writeChromeTrace(exitTracePath);
+        summary(std::cout);
+      }
+      catch(std::exception const & e) {
+        std::cerr << e.what() << std::endl;
+      }
+      std::lock_guard<std::mutex> l(mutex);
+      for(auto const & p : pending) {
+        clReleaseEvent(p.first);
+      }
+    }
+
+    static constexpr size_t maxPending = 1024;
+
+    std::atomic<bool> isEnabled{false};
+    std::string exitTracePath;
+
+    std::mutex mutex;
+    std::vector<ClTraceRecord> records;
+    // the events of the records whose timestamps have not been read yet
+    std::vector<std::pair<cl_event, size_t>> pending;
+    std::map<cl_kernel, std::string> kernelNames;
+    std::map<cl_command_queue, cl_device_id> queueDevices;
+    std::map<cl_device_id, int> devices;
+    std::map<std::thread::id, int> threads;
+
+    // Reads the timestamps of the pending commands that are complete (or of all of them, if 'wait').
+    void collect(bool wait) {
+      std::vector<std::pair<cl_event, size_t>> stillPending;
+      for(auto const & [e, i] : pending) {
+        if(wait) {
+          cl_int ret = clWaitForEvents(1, &e);
+          CHECK_CL_ERROR(ret);
+        }
+        else {
+          cl_int status;
+          cl_int ret = clGetEventInfo(e, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, NULL);
+          CHECK_CL_ERROR(ret);
+          if(status != CL_COMPLETE) {
+            stillPending.emplace_back(e, i);
+            continue;
+          }
+        }
+        auto & r = records[i];
+        // CL_PROFILING_INFO_NOT_AVAILABLE if the queue was not created with CL_QUEUE_PROFILING_ENABLE
+        r.profiled =
+        clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &r.queued, NULL) == CL_SUCCESS &&
+        clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &r.submit, NULL) == CL_SUCCESS &&
+        clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &r.start, NULL) == CL_SUCCESS &&
+        clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &r.end, NULL) == CL_SUCCESS;
+        if(r.profiled) {
+          // some drivers report a SUBMIT (or a QUEUED) later than the START
+          r.submit = std::min(r.submit, r.start);
+          r.queued = std::min(r.queued, r.submit);
+        }
+        cl_int ret = clReleaseEvent(e);
+        CHECK_CL_ERROR(ret);
+      }
+      pending.swap(stillPending);
+    }
+
+    std::string const & kernelName(cl_kernel kernel) {
+      auto it = kernelNames.find(kernel);
+      if(it == kernelNames.end()) {
+        size_t sz = 0;
+        std::string name;
+        if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &sz) == CL_SUCCESS && sz) {
+          std::vector<char> buf(sz);
+          if(clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, sz, buf.data(), NULL) == CL_SUCCESS) {
+            name = buf.data();
+          }
+        }
+        it = kernelNames.emplace(kernel, name).first;
+      }
+      return it->second;
+    }
+
+    cl_device_id queueDevice(cl_command_queue queue) {
+      auto it = queueDevices.find(queue);
+      if(it == queueDevices.end()) {
+        cl_device_id device = nullptr;
+        cl_int ret = clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(device), &device, NULL);
+        CHECK_CL_ERROR(ret);
+        it = queueDevices.emplace(queue, device).first;
+        devices.emplace(device, static_cast<int>(devices.size()));
+      }
+      return it->second;
+    }
+
+    int deviceIndex(cl_device_id device) const {
+      return devices.at(device);
+    }
+
+    int threadIndex() {
+      return threads.emplace(std::this_thread::get_id(), static_cast<int>(threads.size())).first->second;
+    }
+
+    // The time during which the device executes a kernel, a transfer, or anything, in nanoseconds
+    struct DeviceActivity {
+      double span = 0., kernels = 0., transfers = 0., busy = 0., sum = 0.;
+
+      double idle() const { return span - busy; }
+      // 1 when the commands never execute at the same time
+      double overlap() const { return busy > 0. ? sum / busy : 0.; }
+    };
+
+    // The length of the union of the intervals
+    static double unionLength(std::vector<std::pair<cl_ulong, cl_ulong>> intervals) {
+      std::sort(intervals.begin(), intervals.end());
+      double res = 0.;
+      cl_ulong begin = 0, end = 0;
+      bool any = false;
+      for(auto const & [b, e] : intervals) {
+        if(!any || b > end) {
+          res += end - begin;
+          begin = b;
+          end = e;
+          any = true;
+        }
+        else {
+          end = std::max(end, e);
+        }
+      }
+      return res + (end - begin);
+    }
+
+    static std::map<cl_device_id, DeviceActivity> deviceActivities(std::vector<ClTraceRecord> const & recs) {
+      std::map<cl_device_id, std::array<std::vector<std::pair<cl_ulong, cl_ulong>>, 2>> intervals;
+      std::map<cl_device_id, std::pair<cl_ulong, cl_ulong>> spans;
+      std::map<cl_device_id, DeviceActivity> res;
+      for(auto const & r : recs) {
+        if(!r.profiled) {
+          continue;
+        }
+        intervals[r.device][isTransfer(r.command)].emplace_back(r.start, r.end);
+        auto [it, inserted] = spans.emplace(r.device, std::make_pair(r.queued, r.end));
+        if(!inserted) {
+          it->second.first = std::min(it->second.first, r.queued);
+          it->second.second = std::max(it->second.second, r.end);
+        }
+        res[r.device].sum += r.end - r.start;
+      }
+      for(auto & [device, d] : res) {
+        auto const & i = intervals[device];
+        d.span = spans[device].second - spans[device].first;
+        d.kernels = unionLength(i[0]);
+        d.transfers = unionLength(i[1]);
+        auto all = i[0];
+        all.insert(all.end(), i[1].begin(), i[1].end());
+        d.busy = unionLength(all);
+      }
+      return res;
+    }
+
+    // For each device, the offset to add to the device timestamps to get host timestamps:
+    // the QUEUED timestamp of the API call of the shortest duration is assumed to be in its middle.
+    static std::map<cl_device_id, int64_t> deviceToHostOffsets(std::vector<ClTraceRecord> const & recs) {
+      std::map<cl_device_id, std::pair<int64_t, int64_t>> best; // device -> (duration, offset)
+      for(auto const & r : recs) {
+        if(!r.profiled) {
+          continue;
+        }
+        int64_t const duration = r.hostEnd - r.hostBegin;
+        int64_t const offset = (r.hostBegin + duration / 2) - static_cast<int64_t>(r.queued);
+        auto [it, inserted] = best.emplace(r.device, std::make_pair(duration, offset));
+        if(!inserted && duration < it->second.first) {
+          it->second = {duration, offset};
+        }
+      }
+      std::map<cl_device_id, int64_t> res;
+      for(auto const & [device, b] : best) {
+        res[device] = b.second;
+      }
+      return res;
+    }
+
+    static std::string escape(std::string const & s) {
+      std::string res;
+      for(char c : s) {
+        if(c == '"' || c == '\\') {
+          res += '\\';
+        }
+        res += c;
+      }
+      return res;
+    }
+
+    ClTrace(const ClTrace&) = delete;
+    ClTrace& operator=(const ClTrace&) = delete;
+    ClTrace(ClTrace&&) = delete;
+    ClTrace& operator=(ClTrace&&) = delete;
+  };
+
+  /*
+   Labels the commands enqueued by the current thread during its lifetime, in the trace:
+   the labels of nested stages are joined by '/'.
+   */
+  struct ClTraceStage {
+    ClTraceStage(std::string label) {
+      ClTrace::stages().push_back(std::move(label));
+    }
+    ~ClTraceStage() {
+      ClTrace::stages().pop_back();
+    }
+
+    ClTraceStage(const ClTraceStage&) = delete;
+    ClTraceStage& operator=(const ClTraceStage&) = delete;
+    ClTraceStage(ClTraceStage&&) = delete;
+    ClTraceStage& operator=(ClTraceStage&&) = delete;
+  };
+
+  namespace detail {
+    // Calls 'enqueue(event)', and records the command if the trace is enabled.
+    template<typename F>
+    cl_int tracedEnqueue(ClCommand command, cl_command_queue queue, cl_kernel kernel, size_t bytes,
+                         cl_event * event, F enqueue) {
+      auto & trace = ClTrace::getInstance();
+      if(!trace.enabled()) {
+        return enqueue(event);
+      }
+      // the trace needs an event, even if the caller doesn't
+      cl_event local = nullptr;
+      cl_event * e = event ? event : &local;
+      int64_t const begin = ClTrace::hostNow();
+      cl_int const ret = enqueue(e);
+      int64_t const end = ClTrace::hostNow();
+      if(ret == CL_SUCCESS) {
+        trace.record(command, queue, kernel, bytes, begin, end, *e, !event);
+      }
+      return ret;
+    }
+
+    inline size_t imageBytes(cl_mem image, const size_t * region) {
+      size_t elementSize = 0;
+      if(clGetImageInfo(image, CL_IMAGE_ELEMENT_SIZE, sizeof(elementSize), &elementSize, NULL) != CL_SUCCESS) {
+        return 0;
+      }
+      return elementSize * region[0] * region[1] * region[2];
+    }
+  } // NS detail
+
+  inline cl_int tracedEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel, cl_uint work_dim,
+                                           const size_t * global_work_offset, const size_t * global_work_size,
+                                           const size_t * local_work_size, cl_uint num_events_in_wait_list,
+                                           const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::Kernel, queue, kernel, 0, event, [&](cl_event * e) {
+      return clEnqueueNDRangeKernel(queue, kernel, work_dim, global_work_offset, global_work_size, local_work_size,
+                                    num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_write,
+                                         size_t offset, size_t size, const void * ptr, cl_uint num_events_in_wait_list,
+                                         const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::WriteBuffer, queue, nullptr, size, event, [&](cl_event * e) {
+      return clEnqueueWriteBuffer(queue, buffer, blocking_write, offset, size, ptr,
+                                  num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_read,
+                                        size_t offset, size_t size, void * ptr, cl_uint num_events_in_wait_list,
+                                        const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::ReadBuffer, queue, nullptr, size, event, [&](cl_event * e) {
+      return clEnqueueReadBuffer(queue, buffer, blocking_read, offset, size, ptr,
+                                 num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueCopyBuffer(cl_command_queue queue, cl_mem src_buffer, cl_mem dst_buffer,
+                                        size_t src_offset, size_t dst_offset, size_t size, cl_uint num_events_in_wait_list,
+                                        const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::CopyBuffer, queue, nullptr, size, event, [&](cl_event * e) {
+      return clEnqueueCopyBuffer(queue, src_buffer, dst_buffer, src_offset, dst_offset, size,
+                                 num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueFillBuffer(cl_command_queue queue, cl_mem buffer, const void * pattern, size_t pattern_size,
+                                        size_t offset, size_t size, cl_uint num_events_in_wait_list,
+                                        const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::FillBuffer, queue, nullptr, size, event, [&](cl_event * e) {
+      return clEnqueueFillBuffer(queue, buffer, pattern, pattern_size, offset, size,
+                                 num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline void * tracedEnqueueMapBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags map_flags,
+                                       size_t offset, size_t size, cl_uint num_events_in_wait_list,
+                                       const cl_event * event_wait_list, cl_event * event, cl_int * errcode_ret) {
+    void * res = nullptr;
+    cl_int const ret = detail::tracedEnqueue(ClCommand::MapBuffer, queue, nullptr, size, event, [&](cl_event * e) {
+      cl_int err;
+      res = clEnqueueMapBuffer(queue, buffer, blocking_map, map_flags, offset, size,
+                               num_events_in_wait_list, event_wait_list, e, &err);
+      return err;
+    });
+    if(errcode_ret) {
+      *errcode_ret = ret;
+    }
+    return res;
+  }
+
+  inline cl_int tracedEnqueueUnmapMemObject(cl_command_queue queue, cl_mem memobj, void * mapped_ptr,
+                                            cl_uint num_events_in_wait_list, const cl_event * event_wait_list,
+                                            cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::UnmapMemObject, queue, nullptr, 0, event, [&](cl_event * e) {
+      return clEnqueueUnmapMemObject(queue, memobj, mapped_ptr, num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueWriteImage(cl_command_queue queue, cl_mem image, cl_bool blocking_write,
+                                        const size_t * origin, const size_t * region, size_t input_row_pitch,
+                                        size_t input_slice_pitch, const void * ptr, cl_uint num_events_in_wait_list,
+                                        const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::WriteImage, queue, nullptr, detail::imageBytes(image, region), event, [&](cl_event * e) {
+      return clEnqueueWriteImage(queue, image, blocking_write, origin, region, input_row_pitch, input_slice_pitch, ptr,
+                                 num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline cl_int tracedEnqueueReadImage(cl_command_queue queue, cl_mem image, cl_bool blocking_read,
+                                       const size_t * origin, const size_t * region, size_t row_pitch,
+                                       size_t slice_pitch, void * ptr, cl_uint num_events_in_wait_list,
+                                       const cl_event * event_wait_list, cl_event * event) {
+    return detail::tracedEnqueue(ClCommand::ReadImage, queue, nullptr, detail::imageBytes(image, region), event, [&](cl_event * e) {
+      return clEnqueueReadImage(queue, image, blocking_read, origin, region, row_pitch, slice_pitch, ptr,
+                                num_events_in_wait_list, event_wait_list, e);
+    });
+  }
+
+  inline void * tracedEnqueueMapImage(cl_command_queue queue, cl_mem image, cl_bool blocking_map, cl_map_flags map_flags,
+                                      const size_t * origin, const size_t * region, size_t * image_row_pitch,
+                                      size_t * image_slice_pitch, cl_uint num_events_in_wait_list,
+                                      const cl_event * event_wait_list, cl_event * event, cl_int * errcode_ret) {
+    void * res = nullptr;
+    cl_int const ret = detail::tracedEnqueue(ClCommand::MapImage, queue, nullptr, detail::imageBytes(image, region), event, [&](cl_event * e) {
+      cl_int err;
+      res = clEnqueueMapImage(queue, image, blocking_map, map_flags, origin, region, image_row_pitch, image_slice_pitch,
+                              num_events_in_wait_list, event_wait_list, e, &err);
+      return err;
+    });
+    if(errcode_ret) {
+      *errcode_ret = ret;
+    }
+    return res;
+  }
+
+} // NS imajuscule
+
+// The sources included after this file enqueue their commands through the wrappers.
+#define clEnqueueNDRangeKernel imajuscule::tracedEnqueueNDRangeKernel
+#define clEnqueueWriteBuffer imajuscule::tracedEnqueueWriteBuffer
+#define clEnqueueReadBuffer imajuscule::tracedEnqueueReadBuffer
+#define clEnqueueCopyBuffer imajuscule::tracedEnqueueCopyBuffer
+#define clEnqueueFillBuffer imajuscule::tracedEnqueueFillBuffer
+#define clEnqueueMapBuffer imajuscule::tracedEnqueueMapBuffer
+#define clEnqueueUnmapMemObject imajuscule::tracedEnqueueUnmapMemObject
+#define clEnqueueWriteImage imajuscule::tracedEnqueueWriteImage
+#define clEnqueueReadImage imajuscule::tracedEnqueueReadImage
+#define clEnqueueMapImage imajuscule::tracedEnqueueMapImage
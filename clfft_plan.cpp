@@ -0,0 +1,186 @@
+/*
+ A 'ClFftRealPlan' computes ffts of real signals, and the matching inverse ffts, with clFFT
+ (https://github.com/clMathLibraries/clFFT): it has the interface of 'GpuRealFftPlan'
+ (and the same half-spectrum layout, N/2+1 interleaved bins), so that it can replace it
+ in the benchmarks, for example in a 'GpuConvolution' (see main_reverb_benchmark.cpp).
+
+ This file is compiled only when CMakeLists.txt finds the clFFT library (it then defines 'GPGPU_CLFFT').
+ */
+
+#include <clFFT.h>
+
+namespace imajuscule {
+
+  // clfftSetup must be called once before the first plan is created, and clfftTeardown after the last one is destroyed.
+  struct ClFftLibrary {
+    static ClFftLibrary & getInstance() {
+      static ClFftLibrary l;
+      return l;
+    }
+
+  private:
+    ClFftLibrary() {
+      clfftSetupData setupData;
+      CHECK_CL_ERROR(clfftInitSetupData(&setupData));
+      CHECK_CL_ERROR(clfftSetup(&setupData));
+    }
+    ~ClFftLibrary() {
+      clfftTeardown();
+    }
+
+    ClFftLibrary(const ClFftLibrary&) = delete;
+    ClFftLibrary& operator=(const ClFftLibrary&) = delete;
+    ClFftLibrary(ClFftLibrary&&) = delete;
+    ClFftLibrary& operator=(ClFftLibrary&&) = delete;
+  };
+
+  template<typename T>
+  struct ClFftRealPlan {
+    static_assert(std::is_same_v<T, float>, "the plans use single precision");
+
+    using Complex = std::complex<T>;
+
+    static int spectrumSize(int size) {
+      return size/2 + 1;
+    }
+
+    /*
+     'batch_.inputStride' is the distance (in reals) between consecutive signals,
+     'batch_.outputStride' is the distance (in bins) between consecutive spectrums.
+     'config' is ignored: clFFT chooses its kernels.
+     */
+    ClFftRealPlan(cl_context context,
+                  cl_device_id device_id,
+                  cl_command_queue command_queue,
+                  int size,
+                  GpuFftConfig const & config = {},
+                  GpuFftBatch batch_ = {}) :
+    command_queue(command_queue),
+    sz(size),
+    batch(batch_)
+    {
+      verify(is_power_of_two(size) && size >= 4);
+      if(!batch.inputStride) {
+        batch.inputStride = sz;
+      }
+      if(!batch.outputStride) {
+        batch.outputStride = spectrumSize(sz);
+      }
+      verify(batch.count >= 1);
+      verify(batch.inputStride >= sz && batch.outputStride >= spectrumSize(sz));
+
+      ClFftLibrary::getInstance();
+      forward_plan = makePlan(context, CLFFT_REAL, CLFFT_HERMITIAN_INTERLEAVED,
+                              batch.inputStride, batch.outputStride);
+      inverse_plan = makePlan(context, CLFFT_HERMITIAN_INTERLEAVED, CLFFT_REAL,
+                              batch.outputStride, batch.inputStride);
+      // Like 'GpuRealFftPlan', the inverse fft is not normalized.
+      CHECK_CL_ERROR(clfftSetPlanScale(inverse_plan, CLFFT_BACKWARD, 1.f));
+      for(auto plan : {forward_plan, inverse_plan}) {
+        CHECK_CL_ERROR(clfftBakePlan(plan, 1, &this->command_queue, NULL, NULL));
+      }
+
+      cl_int ret;
+      signal_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                                      signalElements() * sizeof(T), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      spectrum_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                                        spectrumElements() * sizeof(Complex), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+    }
+
+    ~ClFftRealPlan() {
+      cl_int ret = clReleaseMemObject(signal_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clReleaseMemObject(spectrum_mem_obj);
+      CHECK_CL_ERROR(ret);
+      for(auto * plan : {&forward_plan, &inverse_plan}) {
+        CHECK_CL_ERROR(clfftDestroyPlan(plan));
+      }
+    }
+
+    int size() const { return sz; }
+    GpuFftBatch const & getBatch() const { return batch; }
+
+    // The number of reals (resp. bins) of the signals (resp. spectrums) of the whole batch, including the strides
+    size_t signalElements() const { return (batch.count-1) * static_cast<size_t>(batch.inputStride) + sz; }
+    size_t spectrumElements() const { return (batch.count-1) * static_cast<size_t>(batch.outputStride) + spectrumSize(sz); }
+
+    cl_mem signalBuffer() const { return signal_mem_obj; }
+    cl_mem spectrumBuffer() const { return spectrum_mem_obj; }
+
+    void writeSignal(std::vector<T> const & signal) {
+      verify(signal.size() == signalElements());
+      cl_int ret = clEnqueueWriteBuffer(command_queue, signal_mem_obj, CL_TRUE, 0,
+                                        signal.size() * sizeof(T), signal.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    // Enqueues the fft of the signal that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueueForward() {
+      return enqueueTransform(forward_plan, CLFFT_FORWARD, signal_mem_obj, spectrum_mem_obj);
+    }
+
+    void readSpectrum(std::vector<Complex> & spectrum) {
+      spectrum.resize(spectrumElements());
+      cl_int ret = clEnqueueReadBuffer(command_queue, spectrum_mem_obj, CL_TRUE, 0,
+                                       spectrum.size() * sizeof(Complex), spectrum.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void forward(std::vector<T> const & signal, std::vector<Complex> & spectrum) {
+      writeSignal(signal);
+      cl_event event = enqueueForward();
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+      readSpectrum(spectrum);
+    }
+
+    // Enqueues the inverse fft (not normalized) of the spectrum that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueueInverse() {
+      return enqueueTransform(inverse_plan, CLFFT_BACKWARD, spectrum_mem_obj, signal_mem_obj);
+    }
+
+    // So that 'averageKernelDuration' can be used to measure the forward fft.
+    cl_event enqueue() {
+      return enqueueForward();
+    }
+
+  private:
+    cl_command_queue command_queue;
+    int sz;
+    GpuFftBatch batch;
+
+    clfftPlanHandle forward_plan, inverse_plan;
+    cl_mem signal_mem_obj, spectrum_mem_obj;
+
+    // The distances are in elements of the input (resp. output) layout.
+    clfftPlanHandle makePlan(cl_context context, clfftLayout in, clfftLayout out, int inputDistance, int outputDistance) {
+      clfftPlanHandle plan;
+      size_t const lengths[1] = {static_cast<size_t>(sz)};
+      CHECK_CL_ERROR(clfftCreateDefaultPlan(&plan, context, CLFFT_1D, lengths));
+      CHECK_CL_ERROR(clfftSetPlanPrecision(plan, CLFFT_SINGLE));
+      CHECK_CL_ERROR(clfftSetLayout(plan, in, out));
+      CHECK_CL_ERROR(clfftSetResultLocation(plan, CLFFT_OUTOFPLACE));
+      CHECK_CL_ERROR(clfftSetPlanBatchSize(plan, batch.count));
+      CHECK_CL_ERROR(clfftSetPlanDistance(plan, inputDistance, outputDistance));
+      return plan;
+    }
+
+    // (clFFT allocates its temporary buffer, if the plan needs one)
+    cl_event enqueueTransform(clfftPlanHandle plan, clfftDirection direction, cl_mem in, cl_mem out) {
+      cl_event event;
+      CHECK_CL_ERROR(clfftEnqueueTransform(plan, direction, 1, &command_queue, 0, NULL, &event,
+                                           &in, &out, NULL));
+      return event;
+    }
+
+    ClFftRealPlan(const ClFftRealPlan&) = delete;
+    ClFftRealPlan& operator=(const ClFftRealPlan&) = delete;
+    ClFftRealPlan(ClFftRealPlan&&) = delete;
+    ClFftRealPlan& operator=(ClFftRealPlan&&) = delete;
+  };
+
+} // NS imajuscule
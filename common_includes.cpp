@@ -0,0 +1,64 @@
+
+/*
+ The includes common to all executables (see main.cpp and main_benchmark.cpp):
+ the standard and OpenCL headers, and the sources of this project (unity build).
+ */
+
+#include <chrono>
+#include <complex>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <unordered_set>
+
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include "error_check.cpp"
+#include "cl_trace.cpp"
+
+#include "read_kernel_source.cpp"
+
+#include "math.cpp"
+#include "bitReverse.cpp"
+#include "rand.cpp"
+
+#include "cpu_fft.cpp"
+#include "cpu_fft_norecursion.cpp"
+
+#include "program_cache.cpp"
+#include "precision.cpp"
+#include "twiddles.cpp"
+#include "local_layout.cpp"
+#include "image_io.cpp"
+#include "stft.cpp"
+#include "subgroups.cpp"
+#include "kernel_generator.cpp"
+#include "tuning_db.cpp"
+#include "host_memory.cpp"
+#include "device_memory_pool.cpp"
+#include "gpu_fft_plan.cpp"
+#include "cpu_fft_simd.cpp"
+#include "thread_pool.cpp"
+#include "cpu_huge_fft_plan.cpp"
+#include "gpu_real_fft_plan.cpp"
+// (defined by CMakeLists.txt when the clFFT library is found)
+#ifdef GPGPU_CLFFT
+#include "clfft_plan.cpp"
+#endif
+#include "gpu_huge_fft_plan.cpp"
+#include "gpu_fft_pipeline.cpp"
+#include "gpu_devices.cpp"
+#include "gpu_multi_device_fft_plan.cpp"
+#include "gpu_convolution.cpp"
+#include "cpu_convolution.cpp"
+#include "gpu_stft.cpp"
+#include "gpu_streaming.cpp"
+#include "autotune.cpp"
+#include "fft_dispatcher.cpp"
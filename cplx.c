@@ -1,17 +1,61 @@
 
+/*
+ Complex numbers, and the access to the inputs and outputs in global memory.
+
+ The kernel selects the precision by defining PRECISION (replaced by the plan, see precision.cpp)
+ before including this file, else the computations and the storage use floats:
+
+ - PRECISION_DOUBLE computes and stores in double precision (needs cl_khr_fp64),
+ - PRECISION_HALF stores the inputs and outputs in half precision, and computes in float.
+
+ 'scalar' is the type of the computations. The global memory is accessed with 'loadReal',
+ 'loadCplx' and 'storeCplx', through pointers to REAL_STORAGE and CPLX_STORAGE
+ (which are moved by CPLX_STORAGE_OFFSET(n) to skip n complex numbers).
+ 'loadReal4', 'loadCplx2' and 'storeCplx2' access 16 (or 32) bytes at once with vload4 / vstore4,
+ and are used by the transfers between global and local memory ('loadCplxsToLocal', 'storeCplxsFromLocal' below,
+ 'loadRealsToBuffer', 'storeCplxsFromBuffer' in local_layout.c).
+
+ A 'struct cplx' has the memory layout of a float2 (double2 in double precision), the real part being x:
+ the vector types are used for the wide accesses to global memory, and the complex multiplication
+ uses multiply-adds (MULT_ADD).
+ */
+
+#define PRECISION_FLOAT  0
+#define PRECISION_DOUBLE 1
+#define PRECISION_HALF   2
+
+#ifndef PRECISION
+#define PRECISION PRECISION_FLOAT
+#endif
+
+#if PRECISION == PRECISION_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double scalar;
+typedef double4 scalar4;
+#define SQRT1_2 M_SQRT1_2
+// the double precision is used for its accuracy, so the multiply-adds are fused.
+#define MULT_ADD(a, b, c) fma(a, b, c)
+#else
+typedef float scalar;
+typedef float4 scalar4;
+#define SQRT1_2 M_SQRT1_2_F
+// 'mad' is fused when the device has a fast fma, else it is a multiplication and an addition.
+#define MULT_ADD(a, b, c) mad(a, b, c)
+#endif
+
 struct cplx {
-  float real;
-  float imag;
+  scalar real;
+  scalar imag;
 };
 
-inline struct cplx complexFromReal(float r) {
+inline struct cplx complexFromReal(scalar r) {
   return (struct cplx) {
     .real = r,
     .imag = 0.f
   };
 }
 
-inline struct cplx polar(float const theta) {
+inline struct cplx polar(scalar const theta) {
   struct cplx c;
   c.imag = sincos(theta,&c.real);
   return c;
@@ -19,8 +63,8 @@ inline struct cplx polar(float const theta) {
 
 inline struct cplx cplxMult(struct cplx const a, struct cplx const b) {
   return (struct cplx) {
-    .real = b.real * a.real - b.imag * a.imag,
-    .imag = b.real * a.imag + b.imag * a.real
+    .real = MULT_ADD(b.real, a.real, -b.imag * a.imag),
+    .imag = MULT_ADD(b.real, a.imag, b.imag * a.real)
   };
 }
 
@@ -38,27 +82,174 @@ inline struct cplx cplxAdd(struct cplx const a, struct cplx const b) {
   };
 }
 
-inline struct cplx cplxScalarMult(float const a, struct cplx const b) {
+inline struct cplx cplxScalarMult(scalar const a, struct cplx const b) {
   return (struct cplx) {
     .real = b.real * a,
     .imag = b.imag * a
   };
 }
 
-inline struct cplx cplxScalarSub(float const a, struct cplx const b) {
+inline struct cplx cplxScalarSub(scalar const a, struct cplx const b) {
   return (struct cplx) {
     .real = a - b.real,
     .imag = - b.imag
   };
 }
 
-inline struct cplx cplxScalarAdd(float const a, struct cplx const b) {
+inline struct cplx cplxScalarAdd(scalar const a, struct cplx const b) {
   return (struct cplx) {
     .real = a + b.real,
     .imag = b.imag
   };
 }
 
+inline struct cplx cplxConj(struct cplx const a) {
+  return (struct cplx) {
+    .real = a.real,
+    .imag = -a.imag
+  };
+}
+
+// returns a * i
+inline struct cplx cplxMultI(struct cplx const a) {
+  return (struct cplx) {
+    .real = -a.imag,
+    .imag = a.real
+  };
+}
+
+////////////////////////////////////////////////////////////////////
+// Access to the inputs and outputs in global memory
+////////////////////////////////////////////////////////////////////
+
+#if PRECISION == PRECISION_HALF
+
+#define REAL_STORAGE half
+#define CPLX_STORAGE half // the real and imaginary parts are interleaved
+// The offset of the n-th complex number, in CPLX_STORAGE elements
+#define CPLX_STORAGE_OFFSET(n) (2*(n))
+
+inline scalar loadReal(__global const half *p, int const i) {
+  return vload_half(i, p);
+}
+
+inline struct cplx loadCplx(__global const half *p, int const i) {
+  float2 const v = vload_half2(i, p);
+  struct cplx c;
+  c.real = v.x;
+  c.imag = v.y;
+  return c;
+}
+
+inline void storeCplx(__global half *p, int const i, struct cplx const c) {
+  float2 v;
+  v.x = c.real;
+  v.y = c.imag;
+  vstore_half2(v, i, p);
+}
+
+// the reals 4*i ... 4*i+3
+inline float4 loadReal4(__global const half *p, int const i) {
+  return vload_half4(i, p);
+}
+
+// stores the complex numbers 2*i and 2*i+1
+inline void storeCplx2(__global half *p, int const i, struct cplx const a, struct cplx const b) {
+  float4 v;
+  v.x = a.real;
+  v.y = a.imag;
+  v.z = b.real;
+  v.w = b.imag;
+  vstore_half4(v, i, p);
+}
+
+#else
+
+#define REAL_STORAGE scalar
+#define CPLX_STORAGE struct cplx
+#define CPLX_STORAGE_OFFSET(n) (n)
+
+inline scalar loadReal(__global const scalar *p, int const i) {
+  return p[i];
+}
+
+inline struct cplx loadCplx(__global const struct cplx *p, int const i) {
+  return p[i];
+}
+
+inline void storeCplx(__global struct cplx *p, int const i, struct cplx const c) {
+  p[i] = c;
+}
+
+// the reals 4*i ... 4*i+3
+inline scalar4 loadReal4(__global const scalar *p, int const i) {
+  return vload4(i, p);
+}
+
+// stores the complex numbers 2*i and 2*i+1
+inline void storeCplx2(__global struct cplx *p, int const i, struct cplx const a, struct cplx const b) {
+  scalar4 v;
+  v.x = a.real;
+  v.y = a.imag;
+  v.z = b.real;
+  v.w = b.imag;
+  vstore4(v, i, (__global scalar *)p);
+}
+
+#endif
+
+// The complex numbers 2*i and 2*i+1
+inline void loadCplx2(__global const CPLX_STORAGE *p, int const i, struct cplx *a, struct cplx *b) {
+  // the complex numbers 2*i and 2*i+1 are the reals 4*i ... 4*i+3
+  scalar4 const v = loadReal4((__global const REAL_STORAGE *)p, i);
+  a->real = v.x;
+  a->imag = v.y;
+  b->real = v.z;
+  b->imag = v.w;
+}
+
+////////////////////////////////////////////////////////////////////
+// Coalesced transfers between global memory and local memory, where each
+// of the work items of the dimension 0 transfers 'n' elements (a power of 2):
+// the global memory accesses of a work item are 16 (or 32) bytes wide
+// when 'n' allows it, and consecutive work items access consecutive addresses.
+////////////////////////////////////////////////////////////////////
+
+inline void loadCplxsToLocal(__global const CPLX_STORAGE *input, __local struct cplx *to, int const n) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 2) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      to[m] = loadCplx(input, m);
+    }
+    return;
+  }
+  for(int j=0; j<n/2; ++j) {
+    int const m = nItems * j + k;
+    struct cplx a, b;
+    loadCplx2(input, m, &a, &b);
+    to[2*m]   = a;
+    to[2*m+1] = b;
+  }
+}
+
+inline void storeCplxsFromLocal(__global CPLX_STORAGE *output, __local struct cplx const *from, int const n) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 2) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      storeCplx(output, m, from[m]);
+    }
+    return;
+  }
+  for(int j=0; j<n/2; ++j) {
+    int const m = nItems * j + k;
+    storeCplx2(output, m, from[2*m], from[2*m+1]);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 // Functions used when performing the butterfly on local memory
 ////////////////////////////////////////////////////////////////////
@@ -106,3 +297,97 @@ inline void butterfly_outofplace(int const idx,
   to[idxD+Ns] = cplxSub(fi, t);
   to[idxD]    = cplxAdd(fi, t);
 }
+
+
+////////////////////////////////////////////////////////////////////
+// Dfts on private memory, used by the higher radix kernels
+////////////////////////////////////////////////////////////////////
+
+// returns a * (-i)
+inline struct cplx cplxMultMinusI(struct cplx const a) {
+  return (struct cplx) {
+    .real = a.imag,
+    .imag = -a.real
+  };
+}
+
+inline void dft2(struct cplx *v) {
+  struct cplx const v0 = v[0];
+  v[0] = cplxAdd(v0, v[1]);
+  v[1] = cplxSub(v0, v[1]);
+}
+
+inline void dft4(struct cplx *v) {
+  struct cplx const a0 = cplxAdd(v[0], v[2]);
+  struct cplx const a1 = cplxSub(v[0], v[2]);
+  struct cplx const a2 = cplxAdd(v[1], v[3]);
+  struct cplx const a3 = cplxMultMinusI(cplxSub(v[1], v[3]));
+  v[0] = cplxAdd(a0, a2);
+  v[1] = cplxAdd(a1, a3);
+  v[2] = cplxSub(a0, a2);
+  v[3] = cplxSub(a1, a3);
+}
+
+inline void dft8(struct cplx *v) {
+  struct cplx e[4] = {v[0], v[2], v[4], v[6]};
+  struct cplx o[4] = {v[1], v[3], v[5], v[7]};
+  dft4(e);
+  dft4(o);
+  // o[k] *= exp(-i*pi*k/4)
+  o[1] = cplxScalarMult(SQRT1_2, (struct cplx) {
+    .real = o[1].real + o[1].imag,
+    .imag = o[1].imag - o[1].real
+  });
+  o[2] = cplxMultMinusI(o[2]);
+  o[3] = cplxScalarMult(SQRT1_2, (struct cplx) {
+    .real = o[3].imag - o[3].real,
+    .imag = -(o[3].real + o[3].imag)
+  });
+  for(int k=0; k<4; ++k) {
+    v[k]   = cplxAdd(e[k], o[k]);
+    v[k+4] = cplxSub(e[k], o[k]);
+  }
+}
+
+// 16 = 4 x 4: the dfts of the 4 columns, the twiddle factors, then the dfts of the 4 rows.
+inline void dft16(struct cplx *v) {
+  // exp(-2*i*pi*j/16)
+  scalar const C = 0.92387953251128674; // cos(pi/8)
+  scalar const S = 0.38268343236508978; // sin(pi/8)
+  struct cplx const w[10] = {
+    {1, 0}, {C, -S}, {SQRT1_2, -SQRT1_2}, {S, -C}, {0, -1},
+    {-S, -C}, {-SQRT1_2, -SQRT1_2}, {-C, -S}, {-1, 0}, {-C, S}
+  };
+  struct cplx c[4][4];
+  for(int n2=0; n2<4; ++n2) {
+    for(int n1=0; n1<4; ++n1) {
+      c[n2][n1] = v[4*n1 + n2];
+    }
+    dft4(c[n2]);
+    for(int k1=1; k1<4; ++k1) {
+      c[n2][k1] = cplxMult(c[n2][k1], w[n2*k1]);
+    }
+  }
+  for(int k1=0; k1<4; ++k1) {
+    struct cplx r[4] = {c[0][k1], c[1][k1], c[2][k1], c[3][k1]};
+    dft4(r);
+    for(int k2=0; k2<4; ++k2) {
+      v[k1 + 4*k2] = r[k2];
+    }
+  }
+}
+
+inline void dft(struct cplx *v, int const radix) {
+  if(radix == 16) {
+    dft16(v);
+  }
+  else if(radix == 8) {
+    dft8(v);
+  }
+  else if(radix == 4) {
+    dft4(v);
+  }
+  else {
+    dft2(v);
+  }
+}
@@ -0,0 +1,228 @@
+/*
+ A 'CpuConvolution' convolves a stream of blocks of 'blockSize' samples with an impulse response on the cpu,
+ with the uniformly partitioned overlap-save convolution of 'GpuConvolution' (see gpu_convolution.cpp),
+ so that the backends are compared for the same work (see main_reverb_benchmark.cpp).
+
+ The ffts of size 2*blockSize are computed by 'RealFft':
+
+ - 'ImjRealFft' uses the imajuscule fft ('Algo_' in cpu_fft.cpp),
+ - 'SimdRealFft' uses the vectorized passes of 'CpuFftPlan' (see cpu_fft_simd.cpp).
+
+ The spectrums of the delay line and of the partitions have N/2+1 bins (the other bins are
+ the conjugates), with separate real and imaginary parts so that the compiler vectorizes
+ the multiply-accumulate over the partitions.
+ */
+
+namespace imajuscule {
+
+  /*
+   The interface of 'RealFft':
+   - 'forward' computes the N bins ('re', 'im') of the fft of N reals,
+   - 'inverse' computes the N reals of the inverse fft (not normalized) of the N bins of the spectrum of a real signal.
+   */
+
+  struct ImjRealFft {
+    ImjRealFft(int size) :
+    sz(size),
+    context(size),
+    algo(context.get()),
+    input(size),
+    output(size),
+    bins(size)
+    {}
+
+    void forward(float const * signal, float * re, float * im) {
+      for(int i=0; i<sz; ++i) {
+        input[i] = signal[i];
+      }
+      algo.forward(input.begin(), bins, sz);
+      for(int k=0; k<sz; ++k) {
+        re[k] = bins[k].real();
+        im[k] = bins[k].imag();
+      }
+    }
+
+    void inverse(float const * re, float const * im, float * signal) {
+      for(int k=0; k<sz; ++k) {
+        bins[k] = {re[k], im[k]};
+      }
+      algo.inverse(bins, output, sz);
+      for(int i=0; i<sz; ++i) {
+        signal[i] = output[i].real();
+      }
+    }
+
+  private:
+    using Tag = imj::Tag;
+
+    int sz;
+    fft::ScopedContext_<Tag, float> context;
+    fft::Algo_<Tag, float> algo;
+    fft::RealSignal_<Tag, float>::type input, output;
+    fft::RealFBins_<Tag, float>::type bins;
+
+    ImjRealFft(const ImjRealFft&) = delete;
+    ImjRealFft& operator=(const ImjRealFft&) = delete;
+    ImjRealFft(ImjRealFft&&) = delete;
+    ImjRealFft& operator=(ImjRealFft&&) = delete;
+  };
+
+  struct SimdRealFft {
+    // 'isa' must be supported by the cpu (see 'cpuSupports').
+    SimdRealFft(int size, CpuIsa isa = bestCpuIsa()) :
+    passes(size, isa),
+    outIm(size),
+    workRe(size),
+    workIm(size)
+    {}
+
+    CpuIsa getIsa() const { return passes.getIsa(); }
+
+    void forward(float const * signal, float * re, float * im) {
+      passes.compute(signal, nullptr, re, im, workRe.data(), workIm.data());
+    }
+
+    // The inverse fft is the forward fft with the real and imaginary parts swapped, at the input and at the output.
+    void inverse(float const * re, float const * im, float * signal) {
+      passes.compute(im, re, outIm.data(), signal, workRe.data(), workIm.data());
+    }
+
+  private:
+    CpuFftPasses passes;
+    std::vector<float> outIm, workRe, workIm;
+
+    SimdRealFft(const SimdRealFft&) = delete;
+    SimdRealFft& operator=(const SimdRealFft&) = delete;
+    SimdRealFft(SimdRealFft&&) = delete;
+    SimdRealFft& operator=(SimdRealFft&&) = delete;
+  };
+
+  template<typename RealFft>
+  struct CpuConvolution {
+    // 'fftArgs' are passed to the constructor of 'RealFft', after the fft size.
+    template<typename... Args>
+    CpuConvolution(int blockSize,
+                   std::vector<float> const & impulseResponse,
+                   Args && ... fftArgs) :
+    blockSz(blockSize),
+    fftSz(2*blockSize),
+    nBins(blockSize+1),
+    nPartitions(std::max(1, static_cast<int>((impulseResponse.size() + blockSize - 1) / blockSize))),
+    fft(2*blockSize, std::forward<Args>(fftArgs)...),
+    history(fftSz),
+    signal(fftSz),
+    re(fftSz),
+    im(fftSz),
+    fdlRe(nPartitions * nBins),
+    fdlIm(nPartitions * nBins),
+    irRe(nPartitions * nBins),
+    irIm(nPartitions * nBins),
+    accRe(nBins),
+    accIm(nBins)
+    {
+      verify(is_power_of_two(blockSize) && blockSize >= 2);
+
+      // each partition is followed by 'blockSize' zeros.
+      for(int p=0; p<nPartitions; ++p) {
+        std::fill(signal.begin(), signal.end(), 0.f);
+        for(int i=0; i<blockSz && (p * blockSz + i) < static_cast<int>(impulseResponse.size()); ++i) {
+          signal[i] = impulseResponse[p * blockSz + i];
+        }
+        fft.forward(signal.data(), re.data(), im.data());
+        std::copy(re.begin(), re.begin() + nBins, irRe.begin() + p * nBins);
+        std::copy(im.begin(), im.begin() + nBins, irIm.begin() + p * nBins);
+      }
+      reset();
+    }
+
+    int getBlockSize() const { return blockSz; }
+    int getPartitionCount() const { return nPartitions; }
+
+    // Forgets the past input blocks.
+    void reset() {
+      std::fill(history.begin(), history.end(), 0.f);
+      std::fill(fdlRe.begin(), fdlRe.end(), 0.f);
+      std::fill(fdlIm.begin(), fdlIm.end(), 0.f);
+      cur = 0;
+      slot = 0;
+    }
+
+    // 'input' and 'output' have 'blockSize' samples.
+    void process(float const * input, float * output) {
+      std::copy(input, input + blockSz, history.begin() + cur * blockSz);
+
+      // the previous block followed by the current block
+      int const prevOffset = (1-cur) * blockSz;
+      for(int i=0; i<fftSz; ++i) {
+        signal[i] = history[(prevOffset + i) & (fftSz - 1)];
+      }
+      fft.forward(signal.data(), re.data(), im.data());
+
+      // the spectrum is pushed in the frequency-domain delay line, and multiplied-accumulated with the partitions.
+      std::copy(re.begin(), re.begin() + nBins, fdlRe.begin() + slot * nBins);
+      std::copy(im.begin(), im.begin() + nBins, fdlIm.begin() + slot * nBins);
+      std::fill(accRe.begin(), accRe.end(), 0.f);
+      std::fill(accIm.begin(), accIm.end(), 0.f);
+      for(int p=0, s=slot; p<nPartitions; ++p) {
+        multiplyAccumulate(fdlRe.data() + s * nBins, fdlIm.data() + s * nBins,
+                           irRe.data() + p * nBins, irIm.data() + p * nBins);
+        // the block delayed by 'p+1' blocks
+        s = (s == 0) ? (nPartitions-1) : (s-1);
+      }
+
+      for(int k=0; k<nBins; ++k) {
+        re[k] = accRe[k];
+        im[k] = accIm[k];
+      }
+      for(int k=nBins; k<fftSz; ++k) {
+        re[k] = accRe[fftSz-k];
+        im[k] = -accIm[fftSz-k];
+      }
+      fft.inverse(re.data(), im.data(), signal.data());
+
+      // the first block is aliased.
+      float const scale = 1.f / fftSz;
+      for(int i=0; i<blockSz; ++i) {
+        output[i] = scale * signal[blockSz + i];
+      }
+
+      cur = 1-cur;
+      slot = (slot+1) % nPartitions;
+    }
+
+    void process(std::vector<float> const & input, std::vector<float> & output) {
+      verify(input.size() == static_cast<size_t>(blockSz));
+      output.resize(blockSz);
+      process(input.data(), output.data());
+    }
+
+  private:
+    int blockSz, fftSz, nBins, nPartitions;
+    RealFft fft;
+
+    std::vector<float> history; // the 2 last input blocks
+    std::vector<float> signal, re, im;
+    std::vector<float> fdlRe, fdlIm; // the frequency-domain delay line: the spectrums of the 'nPartitions' last blocks
+    std::vector<float> irRe, irIm; // the spectrums of the partitions of the impulse response
+    std::vector<float> accRe, accIm;
+
+    int cur; // the position of the current block in 'history'
+    int slot; // the position of the current spectrum in 'fdlRe' / 'fdlIm'
+
+    void multiplyAccumulate(float const * __restrict xRe, float const * __restrict xIm,
+                            float const * __restrict hRe, float const * __restrict hIm) {
+      float * __restrict aRe = accRe.data();
+      float * __restrict aIm = accIm.data();
+      for(int k=0; k<nBins; ++k) {
+        aRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+        aIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+      }
+    }
+
+    CpuConvolution(const CpuConvolution&) = delete;
+    CpuConvolution& operator=(const CpuConvolution&) = delete;
+    CpuConvolution(CpuConvolution&&) = delete;
+    CpuConvolution& operator=(CpuConvolution&&) = delete;
+  };
+
+} // NS imajuscule
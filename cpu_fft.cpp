@@ -6,9 +6,19 @@
 namespace imajuscule {
   namespace fft {
     
+    template<typename T>
+    constexpr double machineEpsilon() {
+      if constexpr (std::is_same_v<T, cl_half>) {
+        return 0x1p-10; // cl_half is an integer type holding the bits of a half (see precision.cpp)
+      }
+      else {
+        return std::numeric_limits<T>::epsilon();
+      }
+    }
+
     template<typename T>
     constexpr double getFFTEpsilon(int N) {
-      return power_of_two_exponent(N) * std::numeric_limits<T>::epsilon(); // worst case error propagation is O(log N)
+      return power_of_two_exponent(N) * machineEpsilon<T>(); // worst case error propagation is O(log N)
     }
     
   }
@@ -124,7 +134,7 @@ namespace imajuscule {
 
   template<typename T>
   static std::complex<T> make_root_of_unity(unsigned int index, unsigned int size) {
-    return std::polar(1.f, -2 * static_cast<T>(M_PI) * index / size);
+    return std::polar(static_cast<T>(1), -2 * static_cast<T>(M_PI) * index / size);
   }
   
   template<typename T>
@@ -457,11 +467,11 @@ namespace imajuscule {
 } // NS imajuscule
 
 
-auto makeRefForwardFft(std::vector<float> const & v) {
+template<typename T>
+auto makeRefForwardFft(std::vector<T> const & v) {
   using namespace imajuscule;
   using namespace imajuscule::fft;
   using Tag = imj::Tag;
-  using T = float;
   
   using RealInput = typename RealSignal_<Tag, T>::type;
   using RealFBins = typename RealFBins_<Tag, T>::type;
@@ -89,11 +89,10 @@ auto cpu_fft_norecursion_stockham(std::vector<float> const & input, int maxLevel
   for(int i=1; i<maxLevel; i <<= 1) {
     for(int k = 0; k<Sz/2; k++) {
       std::complex<float> v[2];
-//      float angle = -2.f*M_PI*(float)(k%i)/(float)(2*i);
-      float angle = 0.f;
-      auto twiddle = std::polar(1.f,angle);
+      // exp(-2*i*pi*(k%i)/(2*i))
+      auto const w = twiddle[(k%i)*((Sz/2)/i)];
       v[0] = (*prev)[k];
-      v[1] = (*prev)[k+Sz/2] * twiddle;
+      v[1] = (*prev)[k+Sz/2] * w;
       auto v0 = v[0];
       v[0] += v[1];
       v[1] = v0 - v[1];
@@ -106,3 +105,84 @@ auto cpu_fft_norecursion_stockham(std::vector<float> const & input, int maxLevel
   
   return *prev;
 }
+
+/*
+ Describes the passes of a radix-R Stockham fft of size 2^log2Size:
+ 'nPasses' passes of radix 'radix', followed by one pass of radix 'lastRadix'
+ when the size is not a power of 'radix' ('lastRadix' is 1 otherwise).
+ */
+struct RadixPasses {
+  RadixPasses(int log2Size, int log2Radix) :
+  log2Radix(log2Radix),
+  radix(1 << log2Radix),
+  nPasses(log2Size / log2Radix),
+  log2LastRadix(log2Size % log2Radix),
+  lastRadix(1 << (log2Size % log2Radix))
+  {}
+
+  int log2Radix, radix;
+  int nPasses;
+  int log2LastRadix, lastRadix;
+};
+
+/*
+ Computes the (unnormalized, forward) dft of v[0] ... v[R-1] in place.
+ */
+template<typename T>
+void cpu_dft(std::complex<T> * v, int R) {
+  std::complex<T> tmp[16];
+  verify(R <= 16);
+  for(int k=0; k<R; ++k) {
+    tmp[k] = {};
+    for(int r=0; r<R; ++r) {
+      tmp[k] += v[r] * std::polar(T(1), static_cast<T>(-2. * M_PI * ((r*k) % R) / R));
+    }
+  }
+  std::copy(tmp, tmp+R, v);
+}
+
+/*
+ This is the cpu version of the radix-R gpu stockham kernel.
+
+ 'radix' is the radix of all passes except maybe the last one (see 'RadixPasses').
+ */
+auto cpu_fft_norecursion_stockham_radix(std::vector<float> const & input, int radix) {
+  using namespace imajuscule;
+  const int Sz = input.size(); // is assumed to be a power of 2
+  verify(is_power_of_two(Sz) && is_power_of_two(radix));
+
+  auto a=complexify(input);
+  decltype(a) b;
+  b.resize(input.size());
+  std::vector<std::complex<float>> * prev, *next;
+  prev = &a;
+  next = &b;
+
+  RadixPasses const passes(power_of_two_exponent(Sz), power_of_two_exponent(radix));
+
+  auto pass = [Sz, &prev, &next](int const Ns, int const R) {
+    for(int j = 0; j<Sz/R; j++) {
+      int const k = j % Ns;
+      std::complex<float> v[16];
+      for(int r=0; r<R; ++r) {
+        v[r] = (*prev)[j + r*(Sz/R)] * std::polar(1.f, static_cast<float>(-2. * M_PI * r * k / (Ns*R)));
+      }
+      cpu_dft(v, R);
+      int const idxD = (j/Ns)*Ns*R + k;
+      for(int r=0; r<R; ++r) {
+        (*next)[idxD + r*Ns] = v[r];
+      }
+    }
+    std::swap(prev,next);
+  };
+
+  int Ns = 1;
+  for(int p=0; p<passes.nPasses; ++p, Ns *= passes.radix) {
+    pass(Ns, passes.radix);
+  }
+  if(passes.lastRadix > 1) {
+    pass(Ns, passes.lastRadix);
+  }
+
+  return *prev;
+}
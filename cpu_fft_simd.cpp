@@ -0,0 +1,395 @@
+/*
+ A 'CpuFftPlan' computes the forward fft of real inputs on the cpu, with the interface
+ of 'GpuFftPlan' (see gpu_fft_plan.cpp): it is the cpu fallback, and the cpu baseline
+ of the benchmarks.
+
+ The complex numbers are stored with separate real and imaginary parts, so that
+ the passes are vectorized with the widest instruction set supported by the cpu,
+ which is selected at runtime (AVX-512, AVX2 + FMA, SSE or NEON, or scalar code):
+
+ - the first pass is a radix-W dft (W is the number of floats of a vector register),
+   computed as a product by the dft matrix so that the vectors are written contiguously,
+ - the next passes are radix-2 Stockham passes, vectorized over the butterflies,
+ - the twiddle factors are computed once per size (see twiddleTable).
+
+ The vectors use the vector extensions of gcc and clang, so the passes are written once
+ for all widths, and compiled for each instruction set with a 'target' attribute.
+ */
+
+#include <cstring>
+#include <mutex>
+
+namespace imajuscule {
+
+  enum class CpuIsa {
+    Scalar,
+    Sse,
+    Neon,
+    Avx2,
+    Avx512
+  };
+
+  const char * toString(CpuIsa isa) {
+    switch(isa) {
+      case CpuIsa::Scalar: return "scalar";
+      case CpuIsa::Sse: return "sse";
+      case CpuIsa::Neon: return "neon";
+      case CpuIsa::Avx2: return "avx2";
+      case CpuIsa::Avx512: return "avx512";
+    }
+    return "";
+  }
+
+  // The number of floats of a vector register
+  constexpr int simdWidth(CpuIsa isa) {
+    switch(isa) {
+      case CpuIsa::Sse:
+      case CpuIsa::Neon:
+        return 4;
+      case CpuIsa::Avx2:
+        return 8;
+      case CpuIsa::Avx512:
+        return 16;
+      default:
+        return 1;
+    }
+  }
+
+  // The next narrower instruction set supported by the cpus supporting 'isa'
+  constexpr CpuIsa narrower(CpuIsa isa) {
+    switch(isa) {
+      case CpuIsa::Avx512: return CpuIsa::Avx2;
+      case CpuIsa::Avx2: return CpuIsa::Sse;
+      default: return CpuIsa::Scalar;
+    }
+  }
+
+  bool cpuSupports(CpuIsa isa) {
+    switch(isa) {
+      case CpuIsa::Scalar:
+        return true;
+#if defined(__x86_64__) || defined(__i386__)
+      case CpuIsa::Sse:
+        return __builtin_cpu_supports("sse2");
+      case CpuIsa::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+      case CpuIsa::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#elif defined(__ARM_NEON)
+      case CpuIsa::Neon:
+        return true;
+#endif
+      default:
+        return false;
+    }
+  }
+
+  CpuIsa bestCpuIsa() {
+    for(auto isa : {CpuIsa::Avx512, CpuIsa::Avx2, CpuIsa::Neon, CpuIsa::Sse}) {
+      if(cpuSupports(isa)) {
+        return isa;
+      }
+    }
+    return CpuIsa::Scalar;
+  }
+
+  namespace simd {
+
+    template<int W>
+    struct Vec {
+      // (gcc ignores the attribute in an alias declaration)
+      typedef float type __attribute__((vector_size(W * sizeof(float))));
+    };
+    template<>
+    struct Vec<1> {
+      using type = float;
+    };
+
+    struct FftArgs {
+      int size;
+      // the inputs: 'inputIm' is null for real inputs.
+      float const * inputRe;
+      float const * inputIm;
+      // the first pass writes to 're[0]' / 'im[0]', then the passes ping pong between the two buffers.
+      float * re[2];
+      float * im[2];
+      // the dft matrix of the first pass (W x W)
+      float const * dftRe;
+      float const * dftIm;
+      // the twiddles of the radix-2 passes (see 'CpuFftTwiddles')
+      float const * twRe;
+      float const * twIm;
+    };
+
+    /*
+     The loads and stores use memcpy, which compiles to unaligned vector loads and stores.
+
+     This function must be inlined in the functions having the 'target' attribute,
+     so that it is compiled for their instruction set.
+     */
+    // The radix-W pass: y[b*W + r] = sum_s x[b + s*N/W] * exp(-2*i*pi*r*s/W)
+    template<int W, bool complexInput>
+    __attribute__((always_inline)) inline void firstPass(FftArgs const & a) {
+      using V = typename Vec<W>::type;
+      static_assert(sizeof(V) == W * sizeof(float));
+      constexpr size_t bytes = sizeof(V);
+      int const nBlocks = a.size / W;
+
+      for(int b=0; b<nBlocks; ++b) {
+        V accRe{}, accIm{};
+        for(int s=0; s<W; ++s) {
+          float const xRe = a.inputRe[b + s*nBlocks];
+          V cRe, cIm;
+          memcpy(&cRe, a.dftRe + s*W, bytes);
+          memcpy(&cIm, a.dftIm + s*W, bytes);
+          accRe += xRe * cRe;
+          accIm += xRe * cIm;
+          if constexpr (complexInput) {
+            float const xIm = a.inputIm[b + s*nBlocks];
+            accRe -= xIm * cIm;
+            accIm += xIm * cRe;
+          }
+        }
+        memcpy(a.re[0] + b*W, &accRe, bytes);
+        memcpy(a.im[0] + b*W, &accIm, bytes);
+      }
+    }
+
+    template<int W>
+    __attribute__((always_inline)) inline void fft(FftArgs const & a) {
+      using V = typename Vec<W>::type;
+      constexpr size_t bytes = sizeof(V);
+      int const N = a.size;
+
+      if(a.inputIm) {
+        firstPass<W, true>(a);
+      }
+      else {
+        firstPass<W, false>(a);
+      }
+
+      // The radix-2 passes, for sub-ffts of size Ns >= W
+      int const half = N/2;
+      int cur = 0;
+      for(int Ns = W; Ns < N; Ns *= 2, cur = 1-cur) {
+        float const * xRe = a.re[cur];
+        float const * xIm = a.im[cur];
+        float * yRe = a.re[1-cur];
+        float * yIm = a.im[1-cur];
+        float const * wRe = a.twRe + Ns;
+        float const * wIm = a.twIm + Ns;
+        for(int j0=0; j0<half; j0 += Ns) {
+          for(int k=0; k<Ns; k += W) {
+            V uRe, uIm, vRe, vIm, tRe, tIm;
+            memcpy(&uRe, xRe + j0 + k, bytes);
+            memcpy(&uIm, xIm + j0 + k, bytes);
+            memcpy(&vRe, xRe + half + j0 + k, bytes);
+            memcpy(&vIm, xIm + half + j0 + k, bytes);
+            memcpy(&tRe, wRe + k, bytes);
+            memcpy(&tIm, wIm + k, bytes);
+            V const mRe = vRe * tRe - vIm * tIm;
+            V const mIm = vRe * tIm + vIm * tRe;
+            V const sumRe = uRe + mRe, sumIm = uIm + mIm;
+            V const diffRe = uRe - mRe, diffIm = uIm - mIm;
+            memcpy(yRe + 2*j0 + k, &sumRe, bytes);
+            memcpy(yIm + 2*j0 + k, &sumIm, bytes);
+            memcpy(yRe + 2*j0 + Ns + k, &diffRe, bytes);
+            memcpy(yIm + 2*j0 + Ns + k, &diffIm, bytes);
+          }
+        }
+      }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx512f"))) void fftAvx512(FftArgs const & a) { fft<16>(a); }
+    __attribute__((target("avx2,fma"))) void fftAvx2(FftArgs const & a) { fft<8>(a); }
+#endif
+    // SSE2 and NEON are part of the baseline of x86-64 and arm64.
+    void fftVec4(FftArgs const & a) { fft<4>(a); }
+    void fftScalar(FftArgs const & a) { fft<1>(a); }
+
+    void fft(CpuIsa isa, FftArgs const & a) {
+      switch(isa) {
+#if defined(__x86_64__) || defined(__i386__)
+        case CpuIsa::Avx512: return fftAvx512(a);
+        case CpuIsa::Avx2: return fftAvx2(a);
+#endif
+        case CpuIsa::Sse:
+        case CpuIsa::Neon: return fftVec4(a);
+        default: return fftScalar(a);
+      }
+    }
+
+  } // NS simd
+
+  // The twiddles of the radix-2 passes of the ffts of size 'size':
+  // exp(-i*pi*k/Ns) is at index Ns + k, for k < Ns < size.
+  struct CpuFftTwiddles {
+    std::vector<float> re, im;
+
+    static CpuFftTwiddles const & get(int size) {
+      static std::mutex mutex;
+      static std::map<int, CpuFftTwiddles> tables;
+
+      std::lock_guard<std::mutex> l(mutex);
+      auto & t = tables[size];
+      if(t.re.empty()) {
+        auto const & table = twiddleTable<float>(size);
+        t.re.resize(size);
+        t.im.resize(size);
+        for(int Ns = 1; Ns < size; Ns *= 2) {
+          for(int k=0; k<Ns; ++k) {
+            // exp(-i*pi*k/Ns) = exp(-2*i*pi*(k*size/(2*Ns))/size)
+            auto const w = table[k * (size/(2*Ns))];
+            t.re[Ns + k] = w.real();
+            t.im[Ns + k] = w.imag();
+          }
+        }
+      }
+      return t;
+    }
+  };
+
+  /*
+   The passes of the ffts of a given size, with a given instruction set:
+   'CpuFftPlan' uses it for batches, and 'CpuHugeFftPlan' for the rows of the six-step algorithm.
+   */
+  struct CpuFftPasses {
+    // 'isa' must be supported by the cpu (see 'cpuSupports').
+    CpuFftPasses(int size, CpuIsa isa_) :
+    sz(size),
+    isa(isa_),
+    twiddles(CpuFftTwiddles::get(size))
+    {
+      verify(is_power_of_two(size) && size >= 1);
+      verify(cpuSupports(isa));
+
+      // The first pass needs at least one block of W elements.
+      while(simdWidth(isa) > sz) {
+        isa = narrower(isa);
+      }
+      int const W = simdWidth(isa);
+      auto const & table = twiddleTable<float>(W);
+      dftRe.resize(W*W);
+      dftIm.resize(W*W);
+      for(int s=0; s<W; ++s) {
+        for(int r=0; r<W; ++r) {
+          dftRe[s*W + r] = table[(r*s) % W].real();
+          dftIm[s*W + r] = table[(r*s) % W].imag();
+        }
+      }
+    }
+
+    int size() const { return sz; }
+    // The instruction set used by the passes
+    CpuIsa getIsa() const { return isa; }
+
+    /*
+     Computes the fft of 'size()' elements ('inIm' is null for real inputs).
+     'work' buffers have 'size()' elements, the inputs must not alias the outputs.
+     */
+    void compute(float const * inRe, float const * inIm, float * outRe, float * outIm, float * workRe, float * workIm) const {
+      int const nRadix2Passes = power_of_two_exponent(sz / simdWidth(isa));
+      simd::FftArgs args;
+      args.size = sz;
+      args.inputRe = inRe;
+      args.inputIm = inIm;
+      // the buffers are chosen so that the last pass writes to the output.
+      bool const even = (nRadix2Passes % 2) == 0;
+      args.re[0] = even ? outRe : workRe;
+      args.im[0] = even ? outIm : workIm;
+      args.re[1] = even ? workRe : outRe;
+      args.im[1] = even ? workIm : outIm;
+      args.dftRe = dftRe.data();
+      args.dftIm = dftIm.data();
+      args.twRe = twiddles.re.data();
+      args.twIm = twiddles.im.data();
+      simd::fft(isa, args);
+    }
+
+  private:
+    int sz;
+    CpuIsa isa;
+    CpuFftTwiddles const & twiddles;
+    std::vector<float> dftRe, dftIm;
+  };
+
+  template<typename T>
+  struct CpuFftPlan {
+    static_assert(std::is_same_v<T, float>, "the vectorized passes use floats");
+
+    using Complex = std::complex<T>;
+
+    // 'isa' must be supported by the cpu (see 'cpuSupports').
+    CpuFftPlan(int size, GpuFftBatch batch_ = {}, CpuIsa isa_ = bestCpuIsa()) :
+    sz(size),
+    batch(batch_),
+    passes(size, isa_)
+    {
+      verify(is_power_of_two(size) && size >= 2);
+      if(!batch.inputStride) {
+        batch.inputStride = sz;
+      }
+      if(!batch.outputStride) {
+        batch.outputStride = sz;
+      }
+      verify(batch.count >= 1);
+      verify(batch.inputStride >= sz && batch.outputStride >= sz);
+
+      input.resize(inputElements());
+      outputRe.resize(outputElements());
+      outputIm.resize(outputElements());
+      workRe.resize(sz);
+      workIm.resize(sz);
+    }
+
+    int size() const { return sz; }
+    GpuFftBatch const & getBatch() const { return batch; }
+    // The instruction set used by the passes
+    CpuIsa getIsa() const { return passes.getIsa(); }
+
+    size_t inputElements() const { return (batch.count-1) * static_cast<size_t>(batch.inputStride) + sz; }
+    size_t outputElements() const { return (batch.count-1) * static_cast<size_t>(batch.outputStride) + sz; }
+
+    void write(std::vector<T> const & in) {
+      verify(in.size() == inputElements());
+      std::copy(in.begin(), in.end(), input.begin());
+    }
+
+    // Computes the ffts of the input given to 'write'.
+    void compute() {
+      for(int b=0; b<batch.count; ++b) {
+        passes.compute(input.data() + b * static_cast<size_t>(batch.inputStride),
+                       nullptr,
+                       outputRe.data() + b * static_cast<size_t>(batch.outputStride),
+                       outputIm.data() + b * static_cast<size_t>(batch.outputStride),
+                       workRe.data(),
+                       workIm.data());
+      }
+    }
+
+    // The result of the last 'compute', with separate real and imaginary parts ('outputElements()' elements)
+    float const * outputReal() const { return outputRe.data(); }
+    float const * outputImag() const { return outputIm.data(); }
+
+    void read(std::vector<Complex> & output) const {
+      output.resize(outputElements());
+      for(size_t i=0; i<output.size(); ++i) {
+        output[i] = {outputRe[i], outputIm[i]};
+      }
+    }
+
+    void execute(std::vector<T> const & in, std::vector<Complex> & output) {
+      write(in);
+      compute();
+      read(output);
+    }
+
+  private:
+    int sz;
+    GpuFftBatch batch;
+    CpuFftPasses passes;
+    std::vector<float> input, outputRe, outputIm, workRe, workIm;
+  };
+
+} // NS imajuscule
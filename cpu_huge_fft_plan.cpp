@@ -0,0 +1,170 @@
+/*
+ A 'CpuHugeFftPlan' computes the forward fft of real inputs of huge sizes on the cpu,
+ with the interface of 'GpuHugeFftPlan' (see gpu_huge_fft_plan.cpp): it is the reference
+ of the huge gpu ffts, and their fallback when there is no capable gpu.
+
+ The fft of size N = N1 * N2 (N2 = 2^ceil(log2(N)/2)) is decomposed like on the gpu
+ (the "six-step" variant of the four-step algorithm):
+
+   1. transpose the N1 x N2 input matrix
+   2. N2 ffts of size N1
+   3. transpose, and multiply by the twiddle factors exp(-2*i*pi*n2*k1/N)
+   4. N1 ffts of size N2
+   5. transpose
+
+ so that instead of streaming the whole array through the caches at every radix-2 pass,
+ each row fft works in the L2 cache (the rows have less than 2^14 elements up to N = 2^28),
+ and the transposes are done by tiles that fit in the L1 cache.
+
+ The rows and the tiles are distributed on the cores with a 'ThreadPool' (see thread_pool.cpp),
+ and the row ffts use the vectorized passes of cpu_fft_simd.cpp.
+ */
+
+namespace imajuscule {
+
+  template<typename T>
+  struct CpuHugeFftPlan {
+    static_assert(std::is_same_v<T, float>, "the vectorized passes use floats");
+
+    using Complex = std::complex<T>;
+
+    // 'isa' must be supported by the cpu (see 'cpuSupports').
+    CpuHugeFftPlan(int size, ThreadPool & pool_ = ThreadPool::instance(), CpuIsa isa = bestCpuIsa()) :
+    sz(size),
+    N2(1 << ((power_of_two_exponent(size) + 1) / 2)),
+    N1(size / N2),
+    pool(pool_),
+    rows1(N1, isa),
+    rows2(N2, isa)
+    {
+      verify(is_power_of_two(size) && size >= 2);
+
+      input.resize(sz);
+      for(int i=0; i<2; ++i) {
+        re[i].resize(sz);
+        im[i].resize(sz);
+      }
+
+      // exp(-2*i*pi*m/N) = exp(-2*i*pi*(m/N2)*N2/N) * exp(-2*i*pi*(m%N2)/N), computed in double precision
+      // (two tables of sqrt(N) elements, instead of one of N elements)
+      for(int i=0; i<N2; ++i) {
+        twiddlesLow.push_back(std::polar(1., -2. * M_PI * i / sz));
+      }
+      for(int i=0; i<N1; ++i) {
+        twiddlesHigh.push_back(std::polar(1., -2. * M_PI * i * N2 / sz));
+      }
+    }
+
+    int size() const { return sz; }
+    // The instruction set used by the row ffts
+    CpuIsa getIsa() const { return rows2.getIsa(); }
+
+    void write(std::vector<T> const & in) {
+      verify(in.size() == static_cast<size_t>(sz));
+      std::copy(in.begin(), in.end(), input.begin());
+    }
+
+    // Computes the fft of the input given to 'write'.
+    void compute() {
+      // 1. input (N1 x N2) -> re[0] (N2 x N1)
+      transpose(N1, N2, input.data(), nullptr, re[0].data(), nullptr, false);
+      // 2. re[0] -> re[1], im[1]
+      rowFfts(rows1, N2, re[0].data(), nullptr, re[1].data(), im[1].data());
+      // 3. re[1], im[1] (N2 x N1) -> re[0], im[0] (N1 x N2)
+      transpose(N2, N1, re[1].data(), im[1].data(), re[0].data(), im[0].data(), true);
+      // 4. re[0], im[0] -> re[1], im[1]
+      rowFfts(rows2, N1, re[0].data(), im[0].data(), re[1].data(), im[1].data());
+      // 5. re[1], im[1] (N1 x N2) -> re[0], im[0] (N2 x N1)
+      transpose(N1, N2, re[1].data(), im[1].data(), re[0].data(), im[0].data(), false);
+    }
+
+    // The result of the last 'compute', with separate real and imaginary parts ('size()' elements)
+    float const * outputReal() const { return re[0].data(); }
+    float const * outputImag() const { return im[0].data(); }
+
+    void read(std::vector<Complex> & output) const {
+      output.resize(sz);
+      pool.parallelFor(sz, copyGrain, [&](int begin, int end) {
+        for(int i=begin; i<end; ++i) {
+          output[i] = {re[0][i], im[0][i]};
+        }
+      });
+    }
+
+    void execute(std::vector<T> const & in, std::vector<Complex> & output) {
+      write(in);
+      compute();
+      read(output);
+    }
+
+  private:
+    static constexpr int tileSize = 32;
+    // The number of elements of a task, so that the tasks are much longer than their scheduling
+    static constexpr int copyGrain = 1 << 14;
+
+    int sz, N2, N1;
+    ThreadPool & pool;
+    CpuFftPasses rows1, rows2;
+    std::vector<float> input;
+    std::vector<float> re[2], im[2];
+    std::vector<std::complex<double>> twiddlesLow, twiddlesHigh;
+
+    /*
+     Transposes the 'nRows' x 'nCols' matrix 'in' to 'out' ('inIm' and 'outIm' are null for real matrices).
+     When 'twiddle' is true, out[c][r] = in[r][c] * exp(-2*i*pi*r*c/N).
+     */
+    void transpose(int nRows, int nCols,
+                   float const * inRe, float const * inIm,
+                   float * outRe, float * outIm,
+                   bool twiddle) const {
+      int const tileRows = std::min(tileSize, nRows);
+      int const tileCols = std::min(tileSize, nCols);
+      int const nTileRows = nRows / tileRows;
+      int const grain = std::max(1, copyGrain / (tileRows * nCols));
+      pool.parallelFor(nTileRows, grain, [&](int begin, int end) {
+        for(int r0 = begin * tileRows; r0 < end * tileRows; r0 += tileRows) {
+          for(int c0 = 0; c0 < nCols; c0 += tileCols) {
+            for(int c = c0; c < c0 + tileCols; ++c) {
+              for(int r = r0; r < r0 + tileRows; ++r) {
+                size_t const from = r * static_cast<size_t>(nCols) + c;
+                size_t const to = c * static_cast<size_t>(nRows) + r;
+                if(!twiddle) {
+                  outRe[to] = inRe[from];
+                  if(outIm) {
+                    outIm[to] = inIm[from];
+                  }
+                  continue;
+                }
+                size_t const m = static_cast<size_t>(r) * c;
+                auto const & h = twiddlesHigh[m / N2];
+                auto const & l = twiddlesLow[m % N2];
+                double const wRe = h.real() * l.real() - h.imag() * l.imag();
+                double const wIm = h.real() * l.imag() + h.imag() * l.real();
+                outRe[to] = static_cast<float>(inRe[from] * wRe - inIm[from] * wIm);
+                outIm[to] = static_cast<float>(inRe[from] * wIm + inIm[from] * wRe);
+              }
+            }
+          }
+        }
+      });
+    }
+
+    // The ffts of the 'nRows' rows of 'in' ('inIm' is null for real inputs)
+    void rowFfts(CpuFftPasses const & passes, int nRows,
+                 float const * inRe, float const * inIm,
+                 float * outRe, float * outIm) const {
+      int const n = passes.size();
+      pool.parallelFor(nRows, std::max(1, copyGrain / n), [&](int begin, int end) {
+        thread_local std::vector<float> workRe, workIm;
+        workRe.resize(std::max<size_t>(workRe.size(), n));
+        workIm.resize(std::max<size_t>(workIm.size(), n));
+        for(int r = begin; r < end; ++r) {
+          size_t const offset = r * static_cast<size_t>(n);
+          passes.compute(inRe + offset, inIm ? inIm + offset : nullptr, outRe + offset, outIm + offset,
+                         workRe.data(), workIm.data());
+        }
+      });
+    }
+  };
+
+} // NS imajuscule
@@ -0,0 +1,197 @@
+/*
+ A 'DeviceMemoryPool' hands out the device buffers of the plans as sub-buffers ('clCreateSubBuffer')
+ of a few big allocations (the chunks), so that creating and destroying plans (when sweeping the sizes,
+ or in batched and streaming workloads) doesn't allocate device memory, which is slow and fragments
+ the memory of the device:
+
+ - the slices are aligned on CL_DEVICE_MEM_BASE_ADDR_ALIGN (the alignment of the origin of sub-buffers),
+ - a slice is taken from the first free range of a chunk that is big enough, else a new chunk is allocated,
+   and the free ranges are coalesced when the slices are released,
+ - the pool reports its current and peak usage, and the memory it can still hand out, to size the batches.
+
+ The plans take their device buffers from the pool given to their constructor, if any
+ (with 'GpuMemoryMode::ZeroCopy', the buffers use host memory, so they don't come from the pool).
+ */
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace imajuscule {
+
+  struct DeviceMemoryPool {
+    static constexpr size_t defaultChunkBytes = 64 << 20;
+
+    DeviceMemoryPool(cl_context context, cl_device_id device_id, size_t chunkBytes = defaultChunkBytes) :
+    context(context)
+    {
+      cl_uint alignBits;
+      cl_int ret = clGetDeviceInfo(device_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(alignBits), &alignBits, NULL);
+      CHECK_CL_ERROR(ret);
+      align = std::max<size_t>(1, alignBits / 8);
+      ret = clGetDeviceInfo(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc), &maxAlloc, NULL);
+      CHECK_CL_ERROR(ret);
+      ret = clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem), &globalMem, NULL);
+      CHECK_CL_ERROR(ret);
+      chunkSz = std::min<size_t>(roundUp(chunkBytes), maxAlloc);
+    }
+
+    // All the slices should have been released: the remaining ones are reported, and released with the chunks.
+    ~DeviceMemoryPool() {
+      if(!slices.empty()) {
+        std::cerr << "DeviceMemoryPool: " << slices.size() << " slice(s) of " << used << " bytes were not released" << std::endl;
+      }
+      for(auto const & [mem, s] : slices) {
+        LOG_CL_ERROR(clReleaseMemObject(mem));
+      }
+      for(auto const & c : chunks) {
+        LOG_CL_ERROR(clReleaseMemObject(c->mem));
+      }
+    }
+
+    /*
+     Returns a buffer of 'bytes' bytes, which must be released with 'release'.
+     'access' is CL_MEM_READ_WRITE, CL_MEM_READ_ONLY or CL_MEM_WRITE_ONLY.
+
+     Throws std::runtime_error if the buffer is bigger than CL_DEVICE_MAX_MEM_ALLOC_SIZE.
+     */
+    cl_mem allocate(size_t bytes, cl_mem_flags access = CL_MEM_READ_WRITE) {
+      verify(bytes > 0);
+      size_t const sz = roundUp(bytes);
+      if(sz > maxAlloc) {
+        throw std::runtime_error("the buffer is bigger than CL_DEVICE_MAX_MEM_ALLOC_SIZE");
+      }
+      std::lock_guard<std::mutex> l(mutex);
+
+      Chunk * chunk = nullptr;
+      size_t offset = 0;
+      for(auto & c : chunks) {
+        for(auto it = c->free.begin(); it != c->free.end(); ++it) {
+          if(it->second >= sz) {
+            chunk = c.get();
+            offset = it->first;
+            size_t const remaining = it->second - sz;
+            c->free.erase(it);
+            if(remaining) {
+              c->free.emplace(offset + sz, remaining);
+            }
+            break;
+          }
+        }
+        if(chunk) {
+          break;
+        }
+      }
+      if(!chunk) {
+        chunk = newChunk(std::max(sz, chunkSz));
+        offset = 0;
+        if(chunk->size > sz) {
+          chunk->free.emplace(sz, chunk->size - sz);
+        }
+      }
+
+      cl_buffer_region const region{offset, bytes};
+      cl_int ret;
+      cl_mem const mem = clCreateSubBuffer(chunk->mem, access, CL_BUFFER_CREATE_TYPE_REGION, &region, &ret);
+      CHECK_CL_ERROR(ret);
+      slices[mem] = Slice{chunk, offset, sz};
+      used += sz;
+      peak = std::max(peak, used);
+      return mem;
+    }
+
+    // (called by the destructors of the plans, so the errors are reported instead of thrown)
+    void release(cl_mem mem) {
+      std::lock_guard<std::mutex> l(mutex);
+      auto it = slices.find(mem);
+      if(it == slices.end()) {
+        std::cerr << "DeviceMemoryPool: released a buffer that is not a slice of the pool" << std::endl;
+        return;
+      }
+      Slice const s = it->second;
+      slices.erase(it);
+      LOG_CL_ERROR(clReleaseMemObject(mem));
+      used -= s.size;
+
+      // coalesce with the adjacent free ranges
+      auto & free = s.chunk->free;
+      auto next = free.emplace(s.offset, s.size).first;
+      if(auto after = std::next(next); after != free.end() && next->first + next->second == after->first) {
+        next->second += after->second;
+        free.erase(after);
+      }
+      if(next != free.begin()) {
+        auto before = std::prev(next);
+        if(before->first + before->second == next->first) {
+          before->second += next->second;
+          free.erase(next);
+        }
+      }
+    }
+
+    // Releases the chunks that have no slice.
+    void trim() {
+      std::lock_guard<std::mutex> l(mutex);
+      chunks.erase(std::remove_if(chunks.begin(), chunks.end(), [this](auto const & c) {
+        if(c->free.size() != 1 || c->free.begin()->second != c->size) {
+          return false;
+        }
+        reserved -= c->size;
+        cl_int ret = clReleaseMemObject(c->mem);
+        CHECK_CL_ERROR(ret);
+        return true;
+      }), chunks.end());
+    }
+
+    size_t alignment() const { return align; }
+    int countChunks() const { return chunks.size(); }
+    // The bytes of the slices (rounded up to the alignment)
+    size_t usedBytes() const { return used; }
+    size_t peakBytes() const { return peak; }
+    // The bytes of the chunks
+    size_t reservedBytes() const { return reserved; }
+    // The free bytes of the chunks, and the global memory of the device that the pool has not allocated
+    // (the allocations made outside of the pool are not known).
+    size_t availableBytes() const { return (reserved - used) + (globalMem > reserved ? (globalMem - reserved) : 0); }
+
+  private:
+    struct Chunk {
+      cl_mem mem;
+      size_t size;
+      std::map<size_t, size_t> free; // offset -> size
+    };
+    struct Slice {
+      Chunk * chunk;
+      size_t offset, size;
+    };
+
+    cl_context context;
+    size_t align;
+    cl_ulong maxAlloc, globalMem;
+    size_t chunkSz;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::map<cl_mem, Slice> slices;
+    size_t used = 0, peak = 0, reserved = 0;
+
+    size_t roundUp(size_t bytes) const {
+      return ((bytes + align - 1) / align) * align;
+    }
+
+    Chunk * newChunk(size_t bytes) {
+      cl_int ret;
+      cl_mem const mem = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      chunks.push_back(std::make_unique<Chunk>(Chunk{mem, bytes, {}}));
+      reserved += bytes;
+      return chunks.back().get();
+    }
+
+    DeviceMemoryPool(const DeviceMemoryPool&) = delete;
+    DeviceMemoryPool& operator=(const DeviceMemoryPool&) = delete;
+    DeviceMemoryPool(DeviceMemoryPool&&) = delete;
+    DeviceMemoryPool& operator=(DeviceMemoryPool&&) = delete;
+  };
+
+} // NS imajuscule
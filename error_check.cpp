@@ -14,6 +14,13 @@ void CHECK_CL_ERROR(int res) {
   fprintf(stderr, "OpenCL Error %d\n", res);
   kill();
 }
+// For the destructors, which must not throw.
+void LOG_CL_ERROR(int res) {
+  if(res==CL_SUCCESS) {
+    return;
+  }
+  fprintf(stderr, "OpenCL Error %d (ignored)\n", res);
+}
 
 void verify(bool b) {
   if(b) {
@@ -23,7 +30,7 @@ void verify(bool b) {
 }
 
 template<typename T>
-bool close(T const & a, T const & b, float epsilon) {
+bool close(T const & a, T const & b, double epsilon) {
   
   auto range = std::abs(a) + std::abs(b);
   if(range == 0.f) {
@@ -41,7 +48,7 @@ bool close(T const & a, T const & b, float epsilon) {
 
 template<typename T>
 std::vector<std::pair<std::pair<int, int>, bool>>
-equalRanges(std::vector<T> const & a, std::vector<T> const & b, float epsilon) {
+equalRanges(std::vector<T> const & a, std::vector<T> const & b, double epsilon) {
   verify(a.size() == b.size());
   
   std::vector<std::pair<std::pair<int, int>, bool>> ranges;
@@ -106,7 +113,7 @@ struct correspondance {
 
 template<typename T>
 std::vector<correspondance>
-correspondances(std::vector<T> const & a, std::vector<T> const & b, int min_correspondance_length, float epsilon) {
+correspondances(std::vector<T> const & a, std::vector<T> const & b, int min_correspondance_length, double epsilon) {
   std::vector<correspondance> res;
   std::unordered_set<int> b_used;
   b_used.reserve(b.size());
@@ -155,7 +162,7 @@ correspondances(std::vector<T> const & a, std::vector<T> const & b, int min_corr
 }
 
 template<typename T>
-void verifyVectorsAreEqual(std::vector<T> const & a, std::vector<T> const & b, float epsilon = 1e-5) {
+void verifyVectorsAreEqual(std::vector<T> const & a, std::vector<T> const & b, double epsilon = 1e-5) {
   verify(a.size() == b.size());
   
   
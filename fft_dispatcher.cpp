@@ -0,0 +1,308 @@
+/*
+ A 'FftDispatcher' computes batches of forward ffts of real inputs on the backend that is the fastest
+ for their size and batch count: small ffts are faster on the cpu, because the transfers and the kernel
+ launch take tens of microseconds, big batches are faster on the gpu.
+
+ - the end-to-end durations (transfers included) of both backends are measured once per (size, batch count),
+   when 'calibrate' is called or at the first 'execute', and stored in the tuning db (see tuning_db.cpp),
+   so the next runs on the same machine read them,
+ - with 'FftDispatch::Split', a batch is split between the cpu and the gpu in proportion to their throughputs
+   (so a batch that is much faster on one backend is not split): the cpu computes its part
+   while the gpu computes the other part.
+
+ The cpu backend is 'CpuFftPlan' (or 'CpuHugeFftPlan' for the huge sizes), the gpu backend is 'GpuFftPlan'
+ (or 'GpuHugeFftPlan' for the sizes that don't fit in local memory).
+ */
+
+namespace imajuscule {
+
+  enum class FftBackend {
+    Cpu,
+    Gpu
+  };
+
+  const char * toString(FftBackend b) {
+    switch(b) {
+      case FftBackend::Cpu: return "cpu";
+      case FftBackend::Gpu: return "gpu";
+    }
+    return "";
+  }
+
+  enum class FftDispatch {
+    // Each batch runs on the fastest backend.
+    Fastest,
+    // A batch can be split between both backends.
+    Split
+  };
+
+  // The end-to-end durations of a (size, batch count) on each backend, in nanoseconds
+  struct BackendDurations {
+    double cpu, gpu;
+
+    FftBackend fastest() const { return (cpu <= gpu) ? FftBackend::Cpu : FftBackend::Gpu; }
+
+    // The number of ffts of a batch of 'batchCount' ffts computed on the cpu, so that both backends finish
+    // at the same time, assuming the durations are proportional to the counts.
+    int cpuShare(int batchCount) const {
+      if(!std::isfinite(gpu)) {
+        return batchCount;
+      }
+      return static_cast<int>(std::lround(batchCount * gpu / (cpu + gpu)));
+    }
+  };
+
+  namespace detail {
+
+    // The ffts of a dense batch ('start' and 'finish' are split so that both backends can run concurrently)
+    struct DispatchedPlan {
+      virtual ~DispatchedPlan() = default;
+
+      // Starts the ffts of the batch: the gpu plans return once the transfers and the kernels are enqueued
+      // ('input' must stay valid until 'finish'), the cpu plans once the ffts are computed.
+      virtual void start(std::vector<float> const & input) = 0;
+      // Waits for the ffts and copies their result.
+      virtual void finish(std::vector<std::complex<float>> & output) = 0;
+
+      void execute(std::vector<float> const & input, std::vector<std::complex<float>> & output) {
+        start(input);
+        finish(output);
+      }
+    };
+
+    struct CpuDispatchedPlan : public DispatchedPlan {
+      // the multi-threaded plan is used for single ffts of at least this size
+      static constexpr int hugeSize = 1 << 15;
+
+      CpuDispatchedPlan(int size, int batchCount) {
+        if(batchCount == 1 && size >= hugeSize) {
+          huge = std::make_unique<CpuHugeFftPlan<float>>(size);
+        }
+        else {
+          GpuFftBatch batch;
+          batch.count = batchCount;
+          plan = std::make_unique<CpuFftPlan<float>>(size, batch);
+        }
+      }
+
+      void start(std::vector<float> const & input) override {
+        if(huge) {
+          huge->write(input);
+          huge->compute();
+        }
+        else {
+          plan->write(input);
+          plan->compute();
+        }
+      }
+
+      void finish(std::vector<std::complex<float>> & output) override {
+        if(huge) {
+          huge->read(output);
+        }
+        else {
+          plan->read(output);
+        }
+      }
+
+    private:
+      std::unique_ptr<CpuFftPlan<float>> plan;
+      std::unique_ptr<CpuHugeFftPlan<float>> huge;
+    };
+
+    struct GpuDispatchedPlan : public DispatchedPlan {
+      // Throws std::runtime_error if the device doesn't support the size or the batch count.
+      GpuDispatchedPlan(cl_context context, cl_device_id device_id, cl_command_queue command_queue,
+                        int size, int batchCount) :
+      command_queue(command_queue),
+      sz(size),
+      count(batchCount)
+      {
+        if(GpuFftPlan<float>::fitsInLocalMemory(device_id, size, FftAlgo::Stockham)) {
+          GpuFftBatch batch;
+          batch.count = batchCount;
+          plan = std::make_unique<GpuFftPlan<float>>(context, device_id, command_queue, size, FftAlgo::Stockham,
+                                                     std::string{}, GpuFftConfig{}, batch);
+        }
+        else {
+          huge = std::make_unique<GpuHugeFftPlan<float>>(context, device_id, command_queue, size);
+        }
+      }
+
+      void start(std::vector<float> const & input) override {
+        if(huge) {
+          // The huge plan doesn't support batches, the ffts are enqueued one after the other, without blocking:
+          // 'input' stays valid until 'finish'.
+          hugeOutput.resize(input.size());
+          std::vector<cl_event> kernels;
+          for(int b=0; b<count; ++b) {
+            size_t const offset = b * static_cast<size_t>(sz);
+            events.push_back(huge->enqueueWrite(input.data() + offset));
+            huge->enqueue(kernels);
+            events.insert(events.end(), kernels.begin(), kernels.end());
+            reads.push_back(huge->enqueueRead(hugeOutput.data() + offset));
+          }
+        }
+        else {
+          plan->write(input);
+          events.push_back(plan->enqueue());
+        }
+        // so that the kernels run while the host computes the cpu part of the batch
+        cl_int ret = clFlush(command_queue);
+        CHECK_CL_ERROR(ret);
+      }
+
+      void finish(std::vector<std::complex<float>> & output) override {
+        if(huge) {
+          cl_int ret = clWaitForEvents(reads.size(), reads.data());
+          CHECK_CL_ERROR(ret);
+          events.insert(events.end(), reads.begin(), reads.end());
+          reads.clear();
+        }
+        for(auto e : events) {
+          cl_int ret = clReleaseEvent(e);
+          CHECK_CL_ERROR(ret);
+        }
+        events.clear();
+        if(huge) {
+          output = hugeOutput;
+          return;
+        }
+        // the read is blocking, and the queue is in-order so it waits for the kernel.
+        plan->read(output);
+      }
+
+    private:
+      cl_command_queue command_queue;
+      int sz, count;
+      std::unique_ptr<GpuFftPlan<float>> plan;
+      std::unique_ptr<GpuHugeFftPlan<float>> huge;
+      std::vector<std::complex<float>> hugeOutput;
+      // the commands enqueued by 'start', and the reads of the huge plan, released by 'finish'
+      std::vector<cl_event> events, reads;
+    };
+
+  } // NS detail
+
+  struct FftDispatcher {
+    FftDispatcher(cl_context context,
+                  cl_device_id device_id,
+                  cl_command_queue command_queue,
+                  FftDispatch dispatch = FftDispatch::Fastest) :
+    context(context),
+    device_id(device_id),
+    command_queue(command_queue),
+    device(deviceInfoString(device_id, CL_DEVICE_NAME)),
+    dispatch(dispatch)
+    {}
+
+    // Measures (or reads from the tuning db) the durations of the (size, batch count) pairs,
+    // so that the measurements are not done by 'execute'.
+    void calibrate(std::vector<int> const & sizes, std::vector<int> const & batchCounts) {
+      for(int size : sizes) {
+        for(int batchCount : batchCounts) {
+          durations(size, batchCount);
+        }
+      }
+    }
+
+    BackendDurations const & durations(int size, int batchCount) {
+      verify(is_power_of_two(size) && size >= 2 && batchCount >= 1);
+      auto it = measured.find({size, batchCount});
+      if(it != measured.end()) {
+        return it->second;
+      }
+      BackendDurations d;
+      d.cpu = duration(FftBackend::Cpu, size, batchCount);
+      d.gpu = duration(FftBackend::Gpu, size, batchCount);
+      return measured[{size, batchCount}] = d;
+    }
+
+    FftBackend backendFor(int size, int batchCount) {
+      return durations(size, batchCount).fastest();
+    }
+
+    /*
+     Computes the ffts of the 'batchCount' inputs of 'size' reals, stored contiguously in 'input',
+     without padding ('output' receives 'batchCount * size' complex numbers).
+     */
+    void execute(int size, int batchCount, std::vector<float> const & input, std::vector<std::complex<float>> & output) {
+      verify(input.size() == static_cast<size_t>(size) * batchCount);
+      auto const & d = durations(size, batchCount);
+      int const cpuCount = (dispatch == FftDispatch::Split) ? d.cpuShare(batchCount) :
+                                                              ((d.fastest() == FftBackend::Cpu) ? batchCount : 0);
+      if(cpuCount == 0 || cpuCount == batchCount) {
+        auto const backend = cpuCount ? FftBackend::Cpu : FftBackend::Gpu;
+        getPlan(backend, size, batchCount).execute(input, output);
+        return;
+      }
+
+      auto & gpu = getPlan(FftBackend::Gpu, size, batchCount - cpuCount);
+      auto & cpu = getPlan(FftBackend::Cpu, size, cpuCount);
+      auto const cpuBegin = input.begin() + (batchCount - cpuCount) * static_cast<size_t>(size);
+      gpuInput.assign(input.begin(), cpuBegin);
+      cpuInput.assign(cpuBegin, input.end());
+      gpu.start(gpuInput);
+      cpu.start(cpuInput);
+      gpu.finish(gpuOutput);
+      cpu.finish(cpuOutput);
+      output.resize(input.size());
+      std::copy(gpuOutput.begin(), gpuOutput.end(), output.begin());
+      std::copy(cpuOutput.begin(), cpuOutput.end(), output.begin() + gpuOutput.size());
+    }
+
+  private:
+
+    cl_context context;
+    cl_device_id device_id;
+    cl_command_queue command_queue;
+    std::string device;
+    FftDispatch dispatch;
+
+    using Key = std::pair<int, int>; // size, batch count
+    std::map<Key, BackendDurations> measured;
+    std::map<std::tuple<FftBackend, int, int>, std::unique_ptr<detail::DispatchedPlan>> plans;
+    std::vector<float> gpuInput, cpuInput;
+    std::vector<std::complex<float>> gpuOutput, cpuOutput;
+
+    // The variant of the entries of the tuning db
+    static std::string variant(FftBackend backend, int batchCount) {
+      return std::string("dispatch_") + toString(backend) + "_batch" + std::to_string(batchCount);
+    }
+
+    detail::DispatchedPlan & getPlan(FftBackend backend, int size, int batchCount) {
+      auto & p = plans[{backend, size, batchCount}];
+      if(!p) {
+        if(backend == FftBackend::Cpu) {
+          p = std::make_unique<detail::CpuDispatchedPlan>(size, batchCount);
+        }
+        else {
+          p = std::make_unique<detail::GpuDispatchedPlan>(context, device_id, command_queue, size, batchCount);
+        }
+      }
+      return *p;
+    }
+
+    // The median end-to-end duration, in nanoseconds.
+    // The backends that don't support the size or the batch count have an infinite duration.
+    double duration(FftBackend backend, int size, int batchCount) {
+      try {
+        return measuredDuration(device, variant(backend, batchCount), size, [&]() {
+          auto & plan = getPlan(backend, size, batchCount);
+          // The input values have no influence on the durations.
+          std::vector<float> input(static_cast<size_t>(size) * batchCount);
+          for(size_t i=0; i<input.size(); ++i) {
+            input[i] = std::sin(static_cast<float>(i));
+          }
+          return [&plan, input = std::move(input), output = std::vector<std::complex<float>>{}]() mutable {
+            plan.execute(input, output);
+          };
+        });
+      }
+      catch(std::runtime_error const & e) {
+        return std::numeric_limits<double>::infinity();
+      }
+    }
+  };
+
+} // NS imajuscule
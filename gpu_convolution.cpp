@@ -0,0 +1,246 @@
+/*
+ A 'GpuConvolution' convolves a stream of blocks of 'blockSize' samples with an impulse response,
+ using a uniformly partitioned overlap-save convolution where every stage runs on the device:
+
+ - the impulse response is split in partitions of 'blockSize' samples, whose spectrums
+   (ffts of size 2*blockSize) are computed once and kept on the device,
+ - for every block, the previous block and the current block are transformed (forward real fft),
+ - the spectrum is pushed in a frequency-domain delay line kept on the device, and multiplied-accumulated
+   with the spectrums of the partitions (see 'spectral_mac' in vector_partitioned_convolution.cl),
+ - the result is transformed back (inverse real fft) and its last block is the output.
+
+ The only transfers between the host and the device are the input block and the output block.
+
+ The real ffts are computed by 'RealFft', a 'GpuRealFftPlan' by default ('ClFftRealPlan' uses clFFT instead,
+ see clfft_plan.cpp).
+ */
+
+namespace imajuscule {
+
+  constexpr auto convolutionKernelFile = "vector_partitioned_convolution.cl";
+
+  template<typename T, typename RealFft = GpuRealFftPlan<T>>
+  struct GpuConvolution {
+    static_assert(std::is_same_v<T, float>, "only float kernels exist for now");
+
+    using Complex = std::complex<T>;
+
+    GpuConvolution(cl_context context,
+                   cl_device_id device_id,
+                   cl_command_queue command_queue,
+                   int blockSize,
+                   std::vector<T> const & impulseResponse) :
+    command_queue(command_queue),
+    blockSz(blockSize),
+    nPartitions(std::max(1, static_cast<int>((impulseResponse.size() + blockSize - 1) / blockSize))),
+    fft(context, device_id, command_queue, 2*blockSize)
+    {
+      verify(is_power_of_two(blockSize) && blockSize >= 2);
+      int const fftSz = fft.size();
+      nBins = RealFft::spectrumSize(fftSz);
+
+      program = buildProgram(context, device_id, read_kernel(convolutionKernelFile));
+      cl_int ret;
+      input_kernel = clCreateKernel(program, "overlap_save_input", &ret);
+      CHECK_CL_ERROR(ret);
+      mac_kernel = clCreateKernel(program, "spectral_mac", &ret);
+      CHECK_CL_ERROR(ret);
+      output_kernel = clCreateKernel(program, "overlap_save_output", &ret);
+      CHECK_CL_ERROR(ret);
+
+      history_mem_obj = clCreateBuffer(context, CL_MEM_READ_ONLY,
+                                       fftSz * sizeof(T), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      output_mem_obj = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                      blockSz * sizeof(T), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      fdl_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                                   nPartitions * nBins * sizeof(Complex), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      ir_mem_obj = clCreateBuffer(context, CL_MEM_READ_ONLY,
+                                  nPartitions * nBins * sizeof(Complex), NULL, &ret);
+      CHECK_CL_ERROR(ret);
+
+      computeImpulseResponseSpectrums(context, device_id, impulseResponse);
+
+      cl_mem signal_mem_obj = fft.signalBuffer();
+      cl_mem spectrum_mem_obj = fft.spectrumBuffer();
+      T const scale = static_cast<T>(1) / fftSz;
+
+      ret = clSetKernelArg(input_kernel, 0, sizeof(cl_mem), (void *)&history_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(input_kernel, 1, sizeof(cl_mem), (void *)&signal_mem_obj);
+      CHECK_CL_ERROR(ret);
+
+      ret = clSetKernelArg(mac_kernel, 0, sizeof(cl_mem), (void *)&spectrum_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(mac_kernel, 1, sizeof(cl_mem), (void *)&fdl_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(mac_kernel, 2, sizeof(cl_mem), (void *)&ir_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(mac_kernel, 3, sizeof(int), (void *)&nPartitions);
+      CHECK_CL_ERROR(ret);
+
+      ret = clSetKernelArg(output_kernel, 0, sizeof(cl_mem), (void *)&signal_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(output_kernel, 1, sizeof(cl_mem), (void *)&output_mem_obj);
+      CHECK_CL_ERROR(ret);
+      ret = clSetKernelArg(output_kernel, 2, sizeof(T), (void *)&scale);
+      CHECK_CL_ERROR(ret);
+
+      reset();
+    }
+
+    ~GpuConvolution() {
+      for(cl_mem m : {history_mem_obj, output_mem_obj, fdl_mem_obj, ir_mem_obj}) {
+        cl_int ret = clReleaseMemObject(m);
+        CHECK_CL_ERROR(ret);
+      }
+      for(cl_kernel k : {input_kernel, mac_kernel, output_kernel}) {
+        cl_int ret = clReleaseKernel(k);
+        CHECK_CL_ERROR(ret);
+      }
+      cl_int ret = clReleaseProgram(program);
+      CHECK_CL_ERROR(ret);
+    }
+
+    int getBlockSize() const { return blockSz; }
+    int getPartitionCount() const { return nPartitions; }
+
+    // Forgets the past input blocks.
+    void reset() {
+      T const zero = 0;
+      cl_int ret = clEnqueueFillBuffer(command_queue, history_mem_obj, &zero, sizeof(zero), 0,
+                                       fft.size() * sizeof(T), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+      ret = clEnqueueFillBuffer(command_queue, fdl_mem_obj, &zero, sizeof(zero), 0,
+                                nPartitions * nBins * sizeof(Complex), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+      cur = 0;
+      slot = 0;
+    }
+
+    /*
+     Enqueues the copy of the block to the device, and all the stages of the convolution, without blocking
+     ('input' must stay valid until the returned event is complete).
+     The stages are ordered by the (in-order) command queue.
+     The returned event (of the last stage) should be released by the caller, and so should
+     the event of the copy, if 'write' is not null.
+     */
+    cl_event enqueueBlock(T const * input, cl_event * write = nullptr) {
+      cl_int ret = clEnqueueWriteBuffer(command_queue, history_mem_obj, CL_FALSE, cur * blockSz * sizeof(T),
+                                        blockSz * sizeof(T), input, 0, NULL, write);
+      CHECK_CL_ERROR(ret);
+
+      int const prevOffset = (1-cur) * blockSz;
+      ret = clSetKernelArg(input_kernel, 2, sizeof(int), (void *)&prevOffset);
+      CHECK_CL_ERROR(ret);
+      enqueue1D(input_kernel, fft.size());
+
+      releaseEvent(fft.enqueueForward());
+
+      ret = clSetKernelArg(mac_kernel, 4, sizeof(int), (void *)&slot);
+      CHECK_CL_ERROR(ret);
+      enqueue1D(mac_kernel, nBins);
+
+      releaseEvent(fft.enqueueInverse());
+
+      cl_event event;
+      size_t const global_item_size = blockSz;
+      ret = clEnqueueNDRangeKernel(command_queue, output_kernel, 1, NULL,
+                                   &global_item_size, NULL,
+                                   0, NULL, &event);
+      CHECK_CL_ERROR(ret);
+
+      cur = 1-cur;
+      slot = (slot+1) % nPartitions;
+      return event;
+    }
+
+    // Enqueues the copy of the output of the last block from the device, once the events of 'waitList' are complete.
+    // The returned event should be released by the caller.
+    cl_event enqueueReadOutput(T * output, std::vector<cl_event> const & waitList) {
+      cl_event event;
+      cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_FALSE, 0,
+                                       blockSz * sizeof(T), output,
+                                       waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    // Copies the output of the last block from the device.
+    void readOutput(T * output) {
+      cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                       blockSz * sizeof(T), output, 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void process(std::vector<T> const & input, std::vector<T> & output) {
+      verify(input.size() == static_cast<size_t>(blockSz));
+      output.resize(blockSz);
+      releaseEvent(enqueueBlock(input.data()));
+      // the read is blocking, and the queue is in-order so it waits for the kernels.
+      readOutput(output.data());
+    }
+
+  private:
+    cl_command_queue command_queue;
+    int blockSz;
+    int nPartitions;
+    int nBins;
+    RealFft fft;
+
+    cl_program program;
+    cl_kernel input_kernel, mac_kernel, output_kernel;
+
+    cl_mem history_mem_obj; // the 2 last input blocks
+    cl_mem output_mem_obj;
+    cl_mem fdl_mem_obj; // the frequency-domain delay line: the spectrums of the 'nPartitions' last blocks
+    cl_mem ir_mem_obj; // the spectrums of the partitions of the impulse response
+
+    int cur; // the position of the current block in 'history_mem_obj'
+    int slot; // the position of the current spectrum in 'fdl_mem_obj'
+
+    // The spectrums of the partitions are computed with a batch of ffts.
+    void computeImpulseResponseSpectrums(cl_context context,
+                                         cl_device_id device_id,
+                                         std::vector<T> const & impulseResponse) {
+      GpuFftBatch batch;
+      batch.count = nPartitions;
+      RealFft irFft(context, device_id, command_queue, fft.size(), {}, batch);
+
+      // each partition is followed by 'blockSize' zeros.
+      std::vector<T> partitions(irFft.signalElements(), 0);
+      for(size_t i=0; i<impulseResponse.size(); ++i) {
+        partitions[(i / blockSz) * fft.size() + (i % blockSz)] = impulseResponse[i];
+      }
+      irFft.writeSignal(partitions);
+      releaseEvent(irFft.enqueueForward());
+
+      cl_int ret = clEnqueueCopyBuffer(command_queue, irFft.spectrumBuffer(), ir_mem_obj, 0, 0,
+                                       nPartitions * nBins * sizeof(Complex), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+      // 'irFft' releases its buffers when going out of scope.
+      ret = clFinish(command_queue);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void enqueue1D(cl_kernel kernel, size_t global_item_size) {
+      cl_int ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL,
+                                          &global_item_size, NULL,
+                                          0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    static void releaseEvent(cl_event event) {
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+    }
+
+    GpuConvolution(const GpuConvolution&) = delete;
+    GpuConvolution& operator=(const GpuConvolution&) = delete;
+    GpuConvolution(GpuConvolution&&) = delete;
+    GpuConvolution& operator=(GpuConvolution&&) = delete;
+  };
+
+} // NS imajuscule
@@ -0,0 +1,72 @@
+/*
+ Enumeration of the OpenCL devices of all platforms.
+
+ A 'GpuDevice' owns a context and a command queue (with profiling enabled) for one device,
+ so that each device has its own plans, compiled programs (the program cache is keyed by the device,
+ see program_cache.cpp) and tuning db entries (keyed by the device name, see tuning_db.cpp).
+ */
+
+namespace imajuscule {
+
+  struct GpuDevice {
+    GpuDevice(cl_platform_id platform_id, cl_device_id device_id) :
+    platform_id(platform_id),
+    device_id(device_id)
+    {
+      cl_int ret;
+      context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+      CHECK_CL_ERROR(ret);
+    }
+
+    ~GpuDevice() {
+      cl_int ret = clFinish(command_queue);
+      CHECK_CL_ERROR(ret);
+      ret = clReleaseCommandQueue(command_queue);
+      CHECK_CL_ERROR(ret);
+      ret = clReleaseContext(context);
+      CHECK_CL_ERROR(ret);
+    }
+
+    std::string name() const { return deviceInfoString(device_id, CL_DEVICE_NAME); }
+
+    cl_platform_id const platform_id;
+    cl_device_id const device_id;
+    cl_context context;
+    cl_command_queue command_queue;
+
+    GpuDevice(const GpuDevice&) = delete;
+    GpuDevice& operator=(const GpuDevice&) = delete;
+    GpuDevice(GpuDevice&&) = delete;
+    GpuDevice& operator=(GpuDevice&&) = delete;
+  };
+
+  // The devices of type 'type' of all platforms, in the order of the platforms.
+  std::vector<std::unique_ptr<GpuDevice>> enumerateDevices(cl_device_type type = CL_DEVICE_TYPE_GPU) {
+    cl_uint nPlatforms;
+    cl_int ret = clGetPlatformIDs(0, NULL, &nPlatforms);
+    CHECK_CL_ERROR(ret);
+    std::vector<cl_platform_id> platforms(nPlatforms);
+    ret = clGetPlatformIDs(nPlatforms, platforms.data(), NULL);
+    CHECK_CL_ERROR(ret);
+
+    std::vector<std::unique_ptr<GpuDevice>> devices;
+    for(auto platform_id : platforms) {
+      cl_uint nDevices;
+      ret = clGetDeviceIDs(platform_id, type, 0, NULL, &nDevices);
+      if(ret == CL_DEVICE_NOT_FOUND) {
+        continue;
+      }
+      CHECK_CL_ERROR(ret);
+      std::vector<cl_device_id> ids(nDevices);
+      ret = clGetDeviceIDs(platform_id, type, nDevices, ids.data(), NULL);
+      CHECK_CL_ERROR(ret);
+      for(auto device_id : ids) {
+        devices.push_back(std::make_unique<GpuDevice>(platform_id, device_id));
+      }
+    }
+    return devices;
+  }
+
+} // NS imajuscule
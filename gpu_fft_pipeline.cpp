@@ -0,0 +1,160 @@
+/*
+ A 'GpuFftPipeline' computes a stream of ffts of the same size, overlapping the transfers
+ to the device, the kernels and the transfers from the device:
+
+ - it owns 'nInFlight' sets of device buffers (one 'GpuFftPlan' per set),
+ - the uploads, the kernels and the downloads are enqueued on 3 different command queues,
+   and synchronized with event wait lists.
+
+ So while the fft of block N is computed, block N+1 is uploaded and the result of block N-1
+ is downloaded.
+ */
+
+namespace imajuscule {
+
+  template<typename T>
+  struct GpuFftPipeline {
+    using Plan = GpuFftPlan<T>;
+    using Complex = typename Plan::Complex;
+
+    GpuFftPipeline(cl_context context,
+                   cl_device_id device_id,
+                   int size,
+                   FftAlgo algo,
+                   std::string const & kernel_file = {},
+                   GpuFftConfig config = {},
+                   int nInFlight = 2) {
+      verify(nInFlight >= 1);
+      for(auto & q : queues) {
+        cl_int ret;
+        q = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+        CHECK_CL_ERROR(ret);
+      }
+      slots.resize(nInFlight);
+      for(auto & s : slots) {
+        // When the program cache is enabled, the program is compiled only once.
+        // The transfers use the memory of the caller, so the plans don't need staging buffers.
+        s.plan = std::make_unique<Plan>(context, device_id, queues[Compute], size, algo, kernel_file, config,
+                                        GpuFftBatch{}, GpuMemoryMode::Copy);
+      }
+    }
+
+    ~GpuFftPipeline() {
+      finish();
+      for(auto & s : slots) {
+        s.releaseEvents();
+      }
+      slots.clear();
+      for(auto q : queues) {
+        cl_int ret = clReleaseCommandQueue(q);
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+    int size() const { return slots[0].plan->size(); }
+    int countInFlight() const { return slots.size(); }
+    Plan const & getPlan() const { return *slots[0].plan; }
+
+    /*
+     Enqueues the fft of 'input' (of 'inputElements()' elements), whose result will be written
+     to 'output' (of 'outputElements()' elements).
+
+     'input' and 'output' must stay valid until the result is available, i.e. after 'finish()'
+     or after 'countInFlight()' more calls to 'submit'.
+     */
+    void submit(T const * input, Complex * output) {
+      Slot & s = slots[next];
+      next = (next + 1) % slots.size();
+
+      // The result of the previous fft of this slot must be on the host before we reuse the slot
+      // (the device side dependencies are handled by the wait lists, but this bounds
+      // the number of in-flight ffts).
+      if(s.read) {
+        cl_int ret = clWaitForEvents(1, &s.read);
+        CHECK_CL_ERROR(ret);
+      }
+
+      // The upload overwrites the input buffer, so it waits for the previous kernel of this slot.
+      cl_event const write = s.plan->enqueueWrite(queues[Upload], input, waitList({s.kernel}));
+      // The kernel overwrites the output buffer, so it waits for the previous download of this slot.
+      cl_event const kernel = s.plan->enqueue(queues[Compute], waitList({write, s.read}));
+      cl_event const read = s.plan->enqueueRead(queues[Download], output, waitList({kernel}));
+
+      s.releaseEvents();
+      s.write = write;
+      s.kernel = kernel;
+      s.read = read;
+
+      // Submit the commands to the device now, so that they start as early as possible.
+      for(auto q : queues) {
+        cl_int ret = clFlush(q);
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+    void submit(std::vector<T> const & input, std::vector<Complex> & output) {
+      verify(input.size() == getPlan().inputElements());
+      output.resize(getPlan().outputElements());
+      submit(input.data(), output.data());
+    }
+
+    // Waits until all the submitted ffts are available on the host.
+    void finish() {
+      for(auto q : queues) {
+        cl_int ret = clFinish(q);
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+    // The kernel duration of the last fft of each slot, in nanoseconds.
+    // All submitted ffts must be finished.
+    std::vector<cl_ulong> lastKernelDurations() const {
+      std::vector<cl_ulong> res;
+      for(auto const & s : slots) {
+        if(s.kernel) {
+          res.push_back(commandDuration(s.kernel));
+        }
+      }
+      return res;
+    }
+
+  private:
+    enum QueueIdx { Upload, Compute, Download, NQueues };
+
+    struct Slot {
+      std::unique_ptr<Plan> plan;
+      // The events of the last fft of this slot
+      cl_event write = 0, kernel = 0, read = 0;
+
+      void releaseEvents() {
+        for(cl_event * e : {&write, &kernel, &read}) {
+          if(*e) {
+            cl_int ret = clReleaseEvent(*e);
+            CHECK_CL_ERROR(ret);
+            *e = 0;
+          }
+        }
+      }
+    };
+
+    cl_command_queue queues[NQueues];
+    std::vector<Slot> slots;
+    int next = 0;
+
+    static std::vector<cl_event> waitList(std::initializer_list<cl_event> events) {
+      std::vector<cl_event> res;
+      for(auto e : events) {
+        if(e) {
+          res.push_back(e);
+        }
+      }
+      return res;
+    }
+
+    GpuFftPipeline(const GpuFftPipeline&) = delete;
+    GpuFftPipeline& operator=(const GpuFftPipeline&) = delete;
+    GpuFftPipeline(GpuFftPipeline&&) = delete;
+    GpuFftPipeline& operator=(GpuFftPipeline&&) = delete;
+  };
+
+} // NS imajuscule
@@ -0,0 +1,1025 @@
+/*
+ A 'GpuFftPlan' owns everything needed to compute ffts of a given size on the gpu:
+ the compiled program and kernel, the local memory sizing and the device buffers.
+
+ These are created once, in the constructor, and reused by every fft,
+ so that running many ffts of the same size doesn't pay the setup cost again.
+ */
+
+#include <functional>
+#include <memory>
+
+namespace imajuscule {
+
+  enum class FftAlgo {
+    // Stockham radix-2, the input is in natural order.
+    Stockham,
+    // Stockham radix-4 and radix-8, the input is in natural order.
+    // When the size is not a power of the radix, the last pass has a lower radix.
+    StockhamRadix4,
+    StockhamRadix8,
+    // Stockham radix-8 and radix-16, with the dfts in private memory: each work item computes one dft per pass,
+    // and the local memory is used only to exchange the results between the passes.
+    // The size must be >= the radix.
+    StockhamRegisters8,
+    StockhamRegisters16,
+    // Stockham radix-2, the input is in natural order: the kernel is generated for the size
+    // and the configuration of the plan (see kernel_generator.cpp).
+    StockhamGenerated,
+    // Cooley-Tukey radix-2, the input is expected to be bit-reversed.
+    CooleyTukey,
+    // Cooley-Tukey radix-2, the input is in natural order:
+    // the kernel bit-reverses the addresses when it loads the input to local memory.
+    CooleyTukeyNaturalOrder
+  };
+
+  constexpr bool isStockham(FftAlgo algo) {
+    return algo != FftAlgo::CooleyTukey && algo != FftAlgo::CooleyTukeyNaturalOrder;
+  }
+
+  constexpr bool expectsBitReversedInput(FftAlgo algo) {
+    return algo == FftAlgo::CooleyTukey;
+  }
+
+  // The kernels where the number of butterflies per thread is fixed by the radix
+  constexpr bool usesRegisters(FftAlgo algo) {
+    return algo == FftAlgo::StockhamRegisters8 || algo == FftAlgo::StockhamRegisters16;
+  }
+
+  constexpr int log2Radix(FftAlgo algo) {
+    switch(algo) {
+      case FftAlgo::StockhamRadix4:
+        return 2;
+      case FftAlgo::StockhamRadix8:
+      case FftAlgo::StockhamRegisters8:
+        return 3;
+      case FftAlgo::StockhamRegisters16:
+        return 4;
+      default:
+        return 1;
+    }
+  }
+
+  constexpr const char * defaultKernelFile(FftAlgo algo) {
+    switch(algo) {
+      case FftAlgo::Stockham:
+        return "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles.cl";
+      case FftAlgo::StockhamRadix4:
+      case FftAlgo::StockhamRadix8:
+        return "vector_fft_floats_stockham_multi_local_coalesce_twiddles_radix.cl";
+      case FftAlgo::StockhamRegisters8:
+      case FftAlgo::StockhamRegisters16:
+        return "vector_fft_floats_stockham_registers_twiddles_radix.cl";
+      case FftAlgo::StockhamGenerated:
+        return "kernel_generator.cpp";
+      case FftAlgo::CooleyTukey:
+      case FftAlgo::CooleyTukeyNaturalOrder:
+        return "vector_fft_floats_multi_local_coalesce_shifts_twiddles.cl";
+    }
+    return nullptr;
+  }
+
+  const char * toString(FftAlgo algo) {
+    switch(algo) {
+      case FftAlgo::Stockham: return "stockham";
+      case FftAlgo::StockhamRadix4: return "stockham_radix4";
+      case FftAlgo::StockhamRadix8: return "stockham_radix8";
+      case FftAlgo::StockhamRegisters8: return "stockham_registers8";
+      case FftAlgo::StockhamRegisters16: return "stockham_registers16";
+      case FftAlgo::StockhamGenerated: return "stockham_generated";
+      case FftAlgo::CooleyTukey: return "cooley_tukey";
+      case FftAlgo::CooleyTukeyNaturalOrder: return "cooley_tukey_natural_order";
+    }
+    return "";
+  }
+
+  // The variant of the entries of the tuning db (see tuning_db.cpp): several algorithms share a kernel file,
+  // with different costs and constraints, and the best configuration (and the supported twiddle storages)
+  // depend on the precision ('FftPrecision::name()'), so they are tuned separately.
+  std::string tuningVariant(FftAlgo algo, std::string const & kernel_file, const char * precision) {
+    return std::string(toString(algo)) + "/" + precision + "/" + kernel_file;
+  }
+
+  // The number of complex numbers of local memory needed by the kernel, per input element.
+  constexpr int localMemoryFactor(FftAlgo algo) {
+    // the Stockham kernels ping pong between two buffers, except the ones computing in private memory.
+    return (isStockham(algo) && !usesRegisters(algo)) ? 2 : 1;
+  }
+
+  std::string const & buildOptions() {
+    // -cl-fast-relaxed-math makes the twiddle fators computation a little faster
+    // but a little less accurate too.
+    static const std::string options = std::string("-I ") + src_root() +
+    " -cl-denorms-are-zero -cl-strict-aliasing -cl-fast-relaxed-math";
+    return options;
+  }
+
+  // Uses the binary from the program cache when possible,
+  // else compiles the source and stores the binary in the cache.
+  cl_program buildProgram(cl_context context, cl_device_id device_id, std::string const & src,
+                          std::string const & options = buildOptions()) {
+    auto const & cache = ProgramCache::getInstance();
+    std::string cache_file;
+    if(cache.enabled()) {
+      cache_file = cache.path(device_id, src, options);
+      if(cl_program program = cache.load(context, device_id, cache_file, options)) {
+        return program;
+      }
+    }
+
+    size_t const source_size = src.size();
+    const char * source = src.data();
+    cl_int ret;
+
+    // Create a program from the kernel source
+    cl_program program = clCreateProgramWithSource(context, 1,
+                                                   &source, &source_size, &ret);
+    CHECK_CL_ERROR(ret);
+
+    // Build the program
+    ret = clBuildProgram(program, 1, &device_id, options.c_str(), NULL, NULL);
+    if(ret != CL_SUCCESS) {
+      LOG_CL_ERROR(clReleaseProgram(program));
+    }
+    CHECK_CL_ERROR(ret);
+
+    if(cache.enabled()) {
+      cache.store(program, cache_file);
+    }
+    return program;
+  }
+
+  // Returns the duration of the command associated to the event, in nanoseconds.
+  // The command queue must have been created with CL_QUEUE_PROFILING_ENABLE.
+  cl_ulong commandDuration(cl_event event) {
+    cl_ulong time_start, time_end;
+    cl_int ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+    CHECK_CL_ERROR(ret);
+    ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+    CHECK_CL_ERROR(ret);
+    return time_end - time_start;
+  }
+
+  /*
+   Describes a batch of independent ffts of the same size, computed by a single kernel launch.
+
+   The strides are the distances (in elements) between the inputs (resp. the outputs)
+   of consecutive ffts of the batch. 0 means that the ffts are contiguous.
+   The inputs of out-of-place ffts can overlap (an input stride smaller than the size),
+   for example the frames of a short-time Fourier transform (see gpu_stft.cpp).
+   */
+  struct GpuFftBatch {
+    int count = 1;
+    int inputStride = 0;
+    int outputStride = 0;
+  };
+
+  enum class GpuFftPlacement {
+    // The input and the output have their own device buffer.
+    OutOfPlace,
+    // The input and the output share a device buffer, the input is overwritten by the fft.
+    InPlace
+  };
+
+  /*
+   The program of an fft kernel file (or of a generated kernel), specialized for ffts of size 'size'.
+
+   If 'forcedButterfliesPerThread' is 0, the minimum number of butterflies per thread
+   allowed by the device is used. The kernels computing in private memory have radix/2
+   butterflies per thread.
+   */
+  template<typename T>
+  struct FftProgram {
+    FftProgram(cl_context context,
+               cl_device_id device_id,
+               std::string const & kernel_src,
+               int const size,
+               FftAlgo const algo,
+               GpuFftBatch const & batch,
+               int forcedButterfliesPerThread,
+               std::vector<std::string> const & kernel_names = {"kernel_func"},
+               std::string const & build_options = buildOptions()) :
+    FftProgram(context, device_id, [&kernel_src](int) { return kernel_src; },
+               size, algo, batch, forcedButterfliesPerThread, kernel_names, build_options)
+    {}
+
+    // 'kernel_src' returns the source of the kernel for a number of butterflies per thread
+    // (see kernel_generator.cpp).
+    FftProgram(cl_context context,
+               cl_device_id device_id,
+               std::function<std::string(int)> const & kernel_src,
+               int const size,
+               FftAlgo const algo,
+               GpuFftBatch const & batch,
+               int forcedButterfliesPerThread,
+               std::vector<std::string> const & kernel_names = {"kernel_func"},
+               std::string const & build_options = buildOptions()) {
+      int const nButterflies = size/2;
+      if(usesRegisters(algo)) {
+        int const n = (1 << log2Radix(algo)) / 2;
+        if(n > nButterflies || (forcedButterfliesPerThread && forcedButterfliesPerThread != n)) {
+          throw std::runtime_error("the number of butterflies per thread must be radix/2, <= size/2");
+        }
+        forcedButterfliesPerThread = n;
+      }
+      if(forcedButterfliesPerThread &&
+         (!is_power_of_two(forcedButterfliesPerThread) || forcedButterfliesPerThread > nButterflies)) {
+        throw std::runtime_error("the number of butterflies per thread must be a power of 2, <= size/2");
+      }
+
+      char buf[256];
+      memset(buf, 0, sizeof(buf));
+      snprintf(buf, sizeof(buf), "%a", (T)(-M_PI/nButterflies));
+
+      RadixPasses const passes(power_of_two_exponent(size), log2Radix(algo));
+
+      // the destructor doesn't run when the constructor throws.
+      try {
+        for(nButterfliesPerThread = forcedButterfliesPerThread ? forcedButterfliesPerThread : 1;;) {
+          std::string const batch_src = ReplaceString(ReplaceString(ReplaceString(kernel_src(nButterfliesPerThread),
+                                                                                  "replace_INPUT_STRIDE",
+                                                                                  std::to_string(batch.inputStride)),
+                                                                    "replace_OUTPUT_STRIDE",
+                                                                    std::to_string(batch.outputStride)),
+                                                      "replace_BIT_REVERSE_INPUT",
+                                                      std::to_string(algo == FftAlgo::CooleyTukeyNaturalOrder ? 1 : 0));
+
+          // only used by the higher radix kernels
+          std::string const radix_src = ReplaceString(ReplaceString(ReplaceString(ReplaceString(ReplaceString(batch_src,
+                                                                                                              "replace_LOG2_RADIX",
+                                                                                                              std::to_string(passes.log2Radix)),
+                                                                                                "replace_RADIX",
+                                                                                                std::to_string(passes.radix)),
+                                                                                  "replace_N_RADIX_PASSES",
+                                                                                  std::to_string(passes.nPasses)),
+                                                                    "replace_LOG2_LAST_RADIX",
+                                                                    std::to_string(passes.log2LastRadix)),
+                                                      "replace_LAST_RADIX",
+                                                      std::to_string(passes.lastRadix));
+
+          std::string const replaced_str = ReplaceString(ReplaceString(ReplaceString(ReplaceString(radix_src,
+                                                                                                   "replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES",
+                                                                                                   buf),
+                                                                                     "replace_N_GLOBAL_BUTTERFLIES",
+                                                                                     std::to_string(nButterflies)),
+                                                                       "replace_LOG2_N_GLOBAL_BUTTERFLIES",
+                                                                       std::to_string(power_of_two_exponent(nButterflies))),
+                                                         "replace_N_LOCAL_BUTTERFLIES",
+                                                         std::to_string(nButterfliesPerThread));
+          program = buildProgram(context, device_id, replaced_str, build_options);
+
+          // Create the OpenCL kernels
+          size_t workgroup_max_sz = std::numeric_limits<size_t>::max();
+          for(auto const & name : kernel_names) {
+            cl_int ret;
+            cl_kernel const k = clCreateKernel(program, name.c_str(), &ret);
+            CHECK_CL_ERROR(ret);
+            kernels.push_back(k);
+
+            size_t kernel_workgroup_max_sz;
+            ret = clGetKernelWorkGroupInfo(kernels.back(),
+                                           device_id,
+                                           CL_KERNEL_WORK_GROUP_SIZE,
+                                           sizeof(kernel_workgroup_max_sz), &kernel_workgroup_max_sz, NULL);
+            CHECK_CL_ERROR(ret);
+            workgroup_max_sz = std::min(workgroup_max_sz, kernel_workgroup_max_sz);
+          }
+
+          if(static_cast<size_t>(nButterflies) > nButterfliesPerThread * workgroup_max_sz) {
+            release();
+            if(forcedButterfliesPerThread) {
+              throw std::runtime_error("the workgroup would be too big for the device");
+            }
+            // To estimate the next value of 'nButterfliesPerThread',
+            // we make the reasonnable assumption that "work group max size"
+            // won't be bigger if we increase 'nButterfliesPerThread':
+            nButterfliesPerThread = nButterflies / workgroup_max_sz;
+            continue;
+          }
+          break;
+        }
+      }
+      catch(...) {
+        release();
+        throw;
+      }
+    }
+
+    ~FftProgram() {
+      release();
+    }
+
+    cl_program program = 0;
+    std::vector<cl_kernel> kernels;
+    int nButterfliesPerThread;
+
+  private:
+    // (the errors are logged, so that the destructor doesn't throw)
+    void release() {
+      for(auto k : kernels) {
+        LOG_CL_ERROR(clReleaseKernel(k));
+      }
+      kernels.clear();
+      if(program) {
+        LOG_CL_ERROR(clReleaseProgram(program));
+        program = 0;
+      }
+    }
+
+    FftProgram(const FftProgram&) = delete;
+    FftProgram& operator=(const FftProgram&) = delete;
+    FftProgram(FftProgram&&) = delete;
+    FftProgram& operator=(FftProgram&&) = delete;
+  };
+
+  cl_ulong deviceLocalMemorySize(cl_device_id device_id) {
+    cl_ulong local_mem_sz;
+    cl_int ret = clGetDeviceInfo(device_id,
+                                 CL_DEVICE_LOCAL_MEM_SIZE,
+                                 sizeof(local_mem_sz), &local_mem_sz, NULL);
+    CHECK_CL_ERROR(ret);
+    return local_mem_sz;
+  }
+
+  // Returns the autotuned configuration for this kernel variant, if any, else 'config'.
+  // An explicit twiddle storage, local memory layout, io storage or sub-group shuffles option in 'config' is kept.
+  GpuFftConfig tunedConfig(cl_device_id device_id, std::string const & variant, int size, GpuFftConfig config) {
+    if(config.automatic()) {
+      if(auto * e = TuningDb::getInstance().find(deviceInfoString(device_id, CL_DEVICE_NAME), variant, size)) {
+        TwiddleStorage const twiddles = config.twiddles;
+        LocalLayout const layout = config.layout;
+        IoStorage const io = config.io;
+        SubgroupShuffles const shuffles = config.shuffles;
+        config = e->config;
+        if(twiddles != TwiddleStorage::Auto) {
+          config.twiddles = twiddles;
+        }
+        if(layout != LocalLayout::Auto) {
+          config.layout = layout;
+        }
+        if(io != IoStorage::Auto) {
+          config.io = io;
+        }
+        if(shuffles != SubgroupShuffles::Auto) {
+          config.shuffles = shuffles;
+        }
+      }
+    }
+    return config;
+  }
+
+  /*
+   Computes the forward fft of real inputs of size 'size' (a power of 2),
+   or a batch of such ffts.
+
+   The inputs and outputs are transferred according to the memory mode
+   (see host_memory.cpp), by default zero-copy buffers on devices sharing the memory
+   with the host, and pinned staging buffers otherwise.
+
+   The computations are done in 'T' (float or double), and the inputs and outputs are stored
+   in device memory as 'S' (see precision.cpp). The kernels that don't specialize 'PRECISION'
+   (see cplx.c) support floats only.
+
+   With 'GpuFftPlacement::InPlace', there is a single device buffer: the reals of the input
+   of an fft are in the first half of the memory of its output (so the input stride is twice
+   the output stride), which is safe because the kernels read the whole input to local memory
+   before writing the output. Only the default kernels (see 'defaultKernelFile') are supported.
+
+   With a 'DeviceMemoryPool' (see device_memory_pool.cpp), the device buffers are sub-buffers of the pool.
+
+   With 'IoStorage::Images' (see image_io.cpp), the inputs and outputs are in images instead of buffers,
+   when the device, the kernel and the plan support it.
+
+   With 'StftProcessing' (see stft.cpp), the kernel multiplies the inputs by a window, and can write the magnitudes
+   or the powers of the bins instead of the spectrum. Only the kernels using 'loadInput' and 'storeOutput'
+   (see image_io.c) support it.
+
+   With 'SubgroupShuffles' (see subgroups.cpp), the first stages of the kernels that support it are computed
+   with sub-group shuffles, when the device supports them.
+   */
+  template<typename T, typename S = T>
+  struct GpuFftPlan {
+    using Precision = FftPrecision<T, S>;
+    using Complex = std::complex<T>;
+    // The type of the complex numbers of the output, in device memory
+    using StorageCplx = StorageComplex<S>;
+
+    static size_t localMemoryNeeds(int size, FftAlgo algo, LocalLayout layout = LocalLayout::Interleaved) {
+      // the computations are done in 'T'
+      return localMemoryFactor(algo) * localLayoutElements(layout, size) * sizeof(Complex);
+    }
+
+    static bool fitsInLocalMemory(cl_device_id device_id, int size, FftAlgo algo, LocalLayout layout = LocalLayout::Interleaved) {
+      return localMemoryNeeds(size, algo, layout) <= deviceLocalMemorySize(device_id);
+    }
+
+    GpuFftPlan(cl_context context,
+               cl_device_id device_id,
+               cl_command_queue command_queue,
+               int size,
+               FftAlgo algo,
+               std::string const & kernel_file = {},
+               GpuFftConfig config = {},
+               GpuFftBatch batch_ = {},
+               GpuMemoryMode memory_mode = GpuMemoryMode::Auto,
+               GpuFftPlacement placement_ = GpuFftPlacement::OutOfPlace,
+               DeviceMemoryPool * pool_ = nullptr,
+               StftProcessing<T> const & stft = {}) :
+    device_id(device_id),
+    command_queue(command_queue),
+    sz(size),
+    algorithm(algo),
+    variant(kernel_file.empty() ? defaultKernelFile(algo) : kernel_file),
+    batch(batch_),
+    memoryMode(resolveMemoryMode(device_id, memory_mode)),
+    placement(placement_),
+    spectrumOutput(stft.output),
+    // the zero-copy buffers use host memory
+    pool((memoryMode == GpuMemoryMode::ZeroCopy) ? nullptr : pool_)
+    {
+      verify(is_power_of_two(size) && size >= 2);
+      // the magnitudes and powers are written 4 at a time
+      verify(spectrumOutput == SpectrumOutput::Complex || size >= 4);
+      verify(stft.window.empty() || stft.window.size() == static_cast<size_t>(size));
+      if(!batch.outputStride) {
+        batch.outputStride = outputSize();
+      }
+      if(placement == GpuFftPlacement::InPlace) {
+        if(variant != defaultKernelFile(algo)) {
+          throw std::runtime_error("in-place ffts are supported by the default kernels only");
+        }
+        verify(!batch.inputStride || batch.inputStride == 2*batch.outputStride);
+        batch.inputStride = 2*batch.outputStride;
+      }
+      if(!batch.inputStride) {
+        batch.inputStride = sz;
+      }
+      verify(batch.count >= 1);
+      verify(batch.inputStride >= 1 && batch.outputStride >= outputSize());
+      // the output of an in-place fft would overwrite the input of the next one
+      verify(placement == GpuFftPlacement::OutOfPlace || batch.inputStride >= sz);
+
+      config = tunedConfig(device_id, tuningVariant(algo, variant, Precision::name()), sz, config);
+      if(!fitsInLocalMemory(device_id, size, algo, config.layout)) {
+        throw std::runtime_error("not enough local memory on the device");
+      }
+      // The kernels compute the whole fft in a single workgroup.
+      if(config.nWorkgroups != 1) {
+        throw std::runtime_error("this kernel uses a single workgroup");
+      }
+
+      Precision::checkDevice(device_id);
+      bool const generated = (algo == FftAlgo::StockhamGenerated);
+      if(generated && variant != defaultKernelFile(algo)) {
+        throw std::runtime_error("the generated kernels have no kernel file");
+      }
+      // (the generated sources have the same tokens for any number of butterflies per thread)
+      std::string const kernel_src = generated ? generateStockhamKernel<T>(sz, 1, config.generator) : read_kernel(variant);
+      if(batch.count > 1 && kernel_src.find("replace_INPUT_STRIDE") == std::string::npos) {
+        throw std::runtime_error("this kernel doesn't support batches");
+      }
+      if(algo == FftAlgo::CooleyTukeyNaturalOrder && kernel_src.find("replace_BIT_REVERSE_INPUT") == std::string::npos) {
+        throw std::runtime_error("this kernel expects a bit-reversed input");
+      }
+      if(stft.enabled() && !kernelSupportsStft(kernel_src)) {
+        throw std::runtime_error("this kernel doesn't support windows and spectrum outputs");
+      }
+      localLayout = resolveLocalLayout(config.layout, kernel_src);
+      ioStorage = resolveIoStorage(config.io, kernel_src);
+      if(ioStorage == IoStorage::Images) {
+        // the images are not sub-buffers
+        pool = nullptr;
+      }
+      subgroupShuffles = resolveSubgroupShuffles(config.shuffles, kernel_src);
+      twiddleStorage = resolveTwiddleStorage(config.twiddles, kernel_src);
+      if(twiddleStorage != TwiddleStorage::OnTheFly) {
+        // The radix-2 kernels use the twiddles of the first half circle only.
+        int const nTwiddles = (log2Radix(algo) == 1) ? sz/2 : sz;
+        twiddles = std::make_unique<GpuTwiddles<T>>(context, device_id, sz, nTwiddles, twiddleStorage);
+      }
+      generatorOptions = config.generator;
+      bool const readWriteImage = (ioStorage == IoStorage::Images) && (placement == GpuFftPlacement::InPlace);
+      bool const windowed = !stft.window.empty();
+      auto const specialize = [this, readWriteImage, windowed](std::string const & src) {
+        std::string const layout_src = specializeLocalLayout(ReplaceString(src,
+                                                                           "replace_TWIDDLE_STORAGE",
+                                                                           std::to_string(kernelTwiddleStorage(twiddleStorage))),
+                                                             localLayout);
+        std::string const io_src = specializeImageIo(layout_src, ioStorage, readWriteImage, image_width);
+        std::string const stft_src = specializeStft(io_src, windowed, spectrumOutput);
+        return Precision::specialize(specializeSubgroupShuffles(stft_src, subgroupShuffles));
+      };
+      bool const openCL2 = readWriteImage || (subgroupShuffles == SubgroupExtension::Khr);
+      std::string const build_options = openCL2 ? (buildOptions() + openCL2BuildOptions) : buildOptions();
+      if(generated) {
+        program = std::make_unique<FftProgram<T>>(context, device_id,
+                                                  [this, &specialize](int nButterfliesPerThread) {
+                                                    return specialize(generateStockhamKernel<T>(sz, nButterfliesPerThread, generatorOptions));
+                                                  },
+                                                  sz, algo, batch, config.nButterfliesPerThread,
+                                                  std::vector<std::string>{"kernel_func"}, build_options);
+      }
+      else {
+        program = std::make_unique<FftProgram<T>>(context, device_id, specialize(kernel_src),
+                                                  sz, algo, batch, config.nButterfliesPerThread,
+                                                  std::vector<std::string>{"kernel_func"}, build_options);
+      }
+      kernel = program->kernels[0];
+
+      // the destructor doesn't run when the constructor throws.
+      try {
+        createBuffers(context);
+        setKernelArgs(context, stft);
+      }
+      catch(...) {
+        release();
+        throw;
+      }
+
+      // The first dimension of the NDRange is used for the items of an fft,
+      // the second one selects the fft in the batch.
+      global_item_size[0] = sz/(2*program->nButterfliesPerThread);
+      global_item_size[1] = batch.count;
+      local_item_size[0] = global_item_size[0];
+      local_item_size[1] = 1;
+    }
+
+    ~GpuFftPlan() {
+      release();
+    }
+
+    int size() const { return sz; }
+    FftAlgo algo() const { return algorithm; }
+    std::string const & getVariant() const { return variant; }
+    GpuFftBatch const & getBatch() const { return batch; }
+    // The resolved memory mode (never 'Auto')
+    GpuMemoryMode getMemoryMode() const { return memoryMode; }
+    GpuFftPlacement getPlacement() const { return placement; }
+    // The resolved twiddle storage (never 'Auto')
+    TwiddleStorage getTwiddleStorage() const { return twiddleStorage; }
+    // The options of the generated kernel (only used by 'FftAlgo::StockhamGenerated')
+    GeneratedKernelOptions const & getGeneratorOptions() const { return generatorOptions; }
+    LocalLayout getLocalLayout() const { return localLayout; }
+    // The resolved io storage (never 'Auto')
+    IoStorage getIoStorage() const { return ioStorage; }
+    SpectrumOutput getSpectrumOutput() const { return spectrumOutput; }
+    // The resolved sub-group shuffles option (never 'Auto')
+    SubgroupShuffles getSubgroupShuffles() const {
+      return (subgroupShuffles == SubgroupExtension::None) ? SubgroupShuffles::Off : SubgroupShuffles::On;
+    }
+    // The shuffle functions used by the kernel
+    SubgroupExtension getSubgroupExtension() const { return subgroupShuffles; }
+    int getButterfliesPerThread() const { return program->nButterfliesPerThread; }
+    // The number of work items used per fft
+    size_t getGlobalSize() const { return global_item_size[0]; }
+    size_t getLocalSize() const { return local_item_size[0]; }
+
+    // The number of complex numbers of the output of an fft: with a magnitude or power output,
+    // the values of the bins are packed two per complex number (see stft.cpp).
+    int outputSize() const { return (spectrumOutput == SpectrumOutput::Complex) ? sz : sz/2; }
+
+    // The number of elements of the input (resp. output) of the whole batch, including the strides
+    size_t inputElements() const { return (batch.count-1) * static_cast<size_t>(batch.inputStride) + sz; }
+    size_t outputElements() const { return (batch.count-1) * static_cast<size_t>(batch.outputStride) + outputSize(); }
+
+    // The size of the buffers of the inputs and outputs, in device memory (or in host memory, with 'ZeroCopy')
+    size_t bufferBytes() const {
+      size_t const output_bytes = outputElements() * sizeof(StorageCplx);
+      return (placement == GpuFftPlacement::InPlace) ? output_bytes : (inputElements() * sizeof(S) + output_bytes);
+    }
+
+    // Copies the input to the device.
+    // If the algorithm is 'CooleyTukey', the input should be bit-reversed (see 'CooleyTukeyNaturalOrder').
+    void write(std::vector<T> const & input) {
+      verify(input.size() == inputElements());
+      if(memoryMode == GpuMemoryMode::Copy) {
+        S const * data;
+        if constexpr (std::is_same_v<S, T>) {
+          data = input.data();
+        }
+        else {
+          staging_input.resize(input.size());
+          std::transform(input.begin(), input.end(), staging_input.begin(), toStorage<S, T>);
+          data = staging_input.data();
+        }
+        if(ioStorage == IoStorage::Images) {
+          releaseEvent(enqueueWriteTiledImage(command_queue, input_mem_obj, CL_TRUE, image_width, inputPixels(), data, {}));
+          return;
+        }
+        cl_int ret = clEnqueueWriteBuffer(command_queue, input_mem_obj, CL_TRUE, 0,
+                                          input.size() * sizeof(S), data, 0, NULL, NULL);
+        CHECK_CL_ERROR(ret);
+        return;
+      }
+      std::transform(input.begin(), input.end(), mapInput(), toStorage<S, T>);
+      unmapInput();
+    }
+
+    /*
+     Returns the host memory where the input of the next fft should be written
+     ('inputElements()' elements, in the storage type), then 'unmapInput()' must be called before 'enqueue()'.
+
+     With 'ZeroCopy', it is the memory of the device buffer, with 'Pinned' it is
+     the pinned staging buffer, which 'unmapInput()' transfers to the device.
+     */
+    S * mapInput() {
+      if(memoryMode == GpuMemoryMode::Pinned) {
+        return pinned_input;
+      }
+      if(ioStorage == IoStorage::Images) {
+        mapped_input = static_cast<S *>(mapTiledImage(command_queue, input_mem_obj, CL_MAP_WRITE_INVALIDATE_REGION,
+                                                      image_width, inputPixels()));
+        return mapped_input;
+      }
+      cl_int ret;
+      mapped_input = static_cast<S *>(clEnqueueMapBuffer(command_queue, input_mem_obj, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                                                         0, inputElements() * sizeof(S), 0, NULL, NULL, &ret));
+      CHECK_CL_ERROR(ret);
+      return mapped_input;
+    }
+
+    void unmapInput() {
+      cl_int ret;
+      if(memoryMode == GpuMemoryMode::Pinned) {
+        if(ioStorage == IoStorage::Images) {
+          releaseEvent(enqueueWriteTiledImage(command_queue, input_mem_obj, CL_TRUE, image_width, inputPixels(), pinned_input, {}));
+          return;
+        }
+        ret = clEnqueueWriteBuffer(command_queue, input_mem_obj, CL_TRUE, 0,
+                                   inputElements() * sizeof(S), pinned_input, 0, NULL, NULL);
+      }
+      else {
+        ret = clEnqueueUnmapMemObject(command_queue, input_mem_obj, mapped_input, 0, NULL, NULL);
+        mapped_input = nullptr;
+      }
+      CHECK_CL_ERROR(ret);
+    }
+
+    // Enqueues the fft of the input that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueue() {
+      return enqueue(command_queue, {});
+    }
+
+    // Copies the result of the last fft from the device.
+    void read(std::vector<Complex> & output) {
+      output.resize(outputElements());
+      if(memoryMode == GpuMemoryMode::Copy) {
+        if(ioStorage == IoStorage::Images) {
+          // (the images are used when 'S' is 'T')
+          releaseEvent(enqueueReadTiledImage(command_queue, output_mem_obj, CL_TRUE, image_width, outputPixels(), output.data(), {}));
+          return;
+        }
+        if constexpr (std::is_same_v<S, T>) {
+          cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                           output.size() * sizeof(StorageCplx), output.data(), 0, NULL, NULL);
+          CHECK_CL_ERROR(ret);
+        }
+        else {
+          staging_output.resize(output.size());
+          cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                           output.size() * sizeof(StorageCplx), staging_output.data(), 0, NULL, NULL);
+          CHECK_CL_ERROR(ret);
+          std::transform(staging_output.begin(), staging_output.end(), output.begin(), fromStorage<T, S>);
+        }
+        return;
+      }
+      StorageCplx const * res = mapOutput();
+      std::transform(res, res + output.size(), output.begin(), fromStorage<T, S>);
+      unmapOutput();
+    }
+
+    /*
+     Waits for the last fft and returns the host memory containing its result
+     ('outputElements()' elements, in the storage type), which is valid until 'unmapOutput()' is called.
+     */
+    StorageCplx const * mapOutput() {
+      cl_int ret;
+      if(memoryMode == GpuMemoryMode::Pinned) {
+        if(ioStorage == IoStorage::Images) {
+          releaseEvent(enqueueReadTiledImage(command_queue, output_mem_obj, CL_TRUE, image_width, outputPixels(), pinned_output, {}));
+          return pinned_output;
+        }
+        ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                  outputElements() * sizeof(StorageCplx), pinned_output, 0, NULL, NULL);
+        CHECK_CL_ERROR(ret);
+        return pinned_output;
+      }
+      if(ioStorage == IoStorage::Images) {
+        mapped_output = static_cast<StorageCplx *>(mapTiledImage(command_queue, output_mem_obj, CL_MAP_READ,
+                                                                 image_width, outputPixels()));
+        return mapped_output;
+      }
+      mapped_output = static_cast<StorageCplx *>(clEnqueueMapBuffer(command_queue, output_mem_obj, CL_TRUE, CL_MAP_READ,
+                                                                0, outputElements() * sizeof(StorageCplx), 0, NULL, NULL, &ret));
+      CHECK_CL_ERROR(ret);
+      return mapped_output;
+    }
+
+    void unmapOutput() {
+      if(memoryMode == GpuMemoryMode::Pinned) {
+        return;
+      }
+      cl_int ret = clEnqueueUnmapMemObject(command_queue, output_mem_obj, mapped_output, 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+      mapped_output = nullptr;
+    }
+
+    // Non-blocking variants of 'write', 'enqueue' and 'read', used for pipelined execution
+    // (see gpu_fft_pipeline.cpp): the command is enqueued on 'queue', and starts
+    // once the events of 'waitList' are complete.
+    // The host memory must stay valid until the command is complete.
+    // The returned event should be released by the caller.
+
+    cl_event enqueueWrite(cl_command_queue queue, S const * input, std::vector<cl_event> const & waitList) {
+      if(ioStorage == IoStorage::Images) {
+        return enqueueWriteTiledImage(queue, input_mem_obj, CL_FALSE, image_width, inputPixels(), input, waitList);
+      }
+      cl_event event;
+      cl_int ret = clEnqueueWriteBuffer(queue, input_mem_obj, CL_FALSE, 0,
+                                        inputElements() * sizeof(S), input,
+                                        waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    cl_event enqueue(cl_command_queue queue, std::vector<cl_event> const & waitList) {
+      cl_event event;
+      cl_int ret = clEnqueueNDRangeKernel(queue, kernel, 2, NULL,
+                                          global_item_size,
+                                          local_item_size,
+                                          waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    cl_event enqueueRead(cl_command_queue queue, StorageCplx * output, std::vector<cl_event> const & waitList) {
+      if(ioStorage == IoStorage::Images) {
+        return enqueueReadTiledImage(queue, output_mem_obj, CL_FALSE, image_width, outputPixels(), output, waitList);
+      }
+      cl_event event;
+      cl_int ret = clEnqueueReadBuffer(queue, output_mem_obj, CL_FALSE, 0,
+                                       outputElements() * sizeof(StorageCplx), output,
+                                       waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    void execute(std::vector<T> const & input, std::vector<Complex> & output) {
+      write(input);
+      cl_event event = enqueue();
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+      // the read is blocking, and the queue is in-order so it waits for the kernel.
+      read(output);
+    }
+
+  private:
+    cl_device_id device_id;
+    cl_command_queue command_queue;
+    int sz;
+    FftAlgo algorithm;
+    std::string variant; // the kernel file
+    GpuFftBatch batch;
+    GpuMemoryMode memoryMode;
+    GpuFftPlacement placement;
+    SpectrumOutput spectrumOutput;
+    TwiddleStorage twiddleStorage;
+    GeneratedKernelOptions generatorOptions;
+    LocalLayout localLayout;
+    IoStorage ioStorage;
+    SubgroupExtension subgroupShuffles;
+    // The number of pixels per row of the images (0 with 'IoStorage::Buffers')
+    size_t image_width = 0;
+    // The device buffers are sub-buffers of the pool, if not null.
+    DeviceMemoryPool * pool;
+
+    // null when the twiddles are computed on the fly
+    std::unique_ptr<GpuTwiddles<T>> twiddles;
+    std::unique_ptr<FftProgram<T>> program;
+    cl_kernel kernel;
+    size_t global_item_size[2], local_item_size[2];
+
+    cl_mem input_mem_obj = 0, output_mem_obj = 0;
+    // 0 when the inputs are not windowed
+    cl_mem window_mem_obj = 0;
+
+    // ZeroCopy: the host memory of the device buffers
+    page_aligned_vector<S> host_input;
+    page_aligned_vector<StorageCplx> host_output;
+    S * mapped_input = nullptr;
+    StorageCplx * mapped_output = nullptr;
+
+    // Pinned: the staging buffers, mapped during the lifetime of the plan
+    cl_mem pinned_input_mem_obj = 0, pinned_output_mem_obj = 0;
+    S * pinned_input = nullptr;
+    StorageCplx * pinned_output = nullptr;
+
+    // Copy: the conversions, when the storage type is not 'T'
+    std::vector<S> staging_input;
+    std::vector<StorageCplx> staging_output;
+
+    // With images, the pixels of the input (resp. output) of the whole batch
+    size_t inputPixels() const { return inputElements() / realsPerPixel; }
+    size_t outputPixels() const { return outputElements() / cplxsPerPixel; }
+
+    // Images when they are requested, and supported by the device, the kernel and the plan, else buffers.
+    IoStorage resolveIoStorage(IoStorage requested, std::string const & kernel_src) {
+      if(requested != IoStorage::Images) {
+        return IoStorage::Buffers;
+      }
+      // the pixels contain 4 floats, and the inputs and outputs of the ffts of the batch start and end on a pixel boundary
+      // (so 'inputPixels()' and 'outputPixels()' don't truncate, and the small sizes use the buffers)
+      if(!std::is_same_v<T, float> || !std::is_same_v<S, float> || !kernelSupportsImageIo(kernel_src) ||
+         sz % realsPerPixel || outputSize() % cplxsPerPixel ||
+         batch.inputStride % realsPerPixel || batch.outputStride % cplxsPerPixel) {
+        return IoStorage::Buffers;
+      }
+      ImageIoSupport const support = imageIoSupport(device_id);
+      if(!support.images || (placement == GpuFftPlacement::InPlace && !support.readWrite)) {
+        return IoStorage::Buffers;
+      }
+      image_width = imageWidth(support, std::max(inputPixels(), outputPixels()));
+      return image_width ? IoStorage::Images : IoStorage::Buffers;
+    }
+
+    // The shuffles of the device, unless they are disabled or the kernel doesn't support them.
+    SubgroupExtension resolveSubgroupShuffles(SubgroupShuffles requested, std::string const & kernel_src) const {
+      if(requested == SubgroupShuffles::Off || !kernelSupportsSubgroupShuffles(kernel_src)) {
+        return SubgroupExtension::None;
+      }
+      return subgroupExtension(device_id);
+    }
+
+    static void releaseEvent(cl_event event) {
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+    }
+
+    cl_mem createDeviceBuffer(cl_context context, cl_mem_flags flags, size_t bytes) {
+      if(pool) {
+        return pool->allocate(bytes, flags);
+      }
+      cl_int ret;
+      cl_mem mem = clCreateBuffer(context, flags, bytes, NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      return mem;
+    }
+
+    // 'mem' is a buffer created by 'createBuffers'
+    void releaseDeviceBuffer(cl_mem mem) {
+      if(pool) {
+        pool->release(mem);
+        return;
+      }
+      LOG_CL_ERROR(clReleaseMemObject(mem));
+    }
+
+    void createBuffers(cl_context context) {
+      size_t const input_bytes = inputElements() * sizeof(S);
+      size_t const output_bytes = outputElements() * sizeof(StorageCplx);
+      cl_int ret;
+      if(ioStorage == IoStorage::Images) {
+        createImages(context);
+      }
+      else if(placement == GpuFftPlacement::InPlace) {
+        // the input elements are at the beginning of the output elements
+        verify(input_bytes <= output_bytes);
+        if(memoryMode == GpuMemoryMode::ZeroCopy) {
+          host_output.resize(outputElements());
+          output_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
+                                          output_bytes, host_output.data(), &ret);
+          CHECK_CL_ERROR(ret);
+        }
+        else {
+          output_mem_obj = createDeviceBuffer(context, CL_MEM_READ_WRITE, output_bytes);
+        }
+        input_mem_obj = output_mem_obj;
+      }
+      else if(memoryMode == GpuMemoryMode::ZeroCopy) {
+        host_input.resize(inputElements());
+        host_output.resize(outputElements());
+        input_mem_obj = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+                                       input_bytes, host_input.data(), &ret);
+        CHECK_CL_ERROR(ret);
+        output_mem_obj = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
+                                        output_bytes, host_output.data(), &ret);
+        CHECK_CL_ERROR(ret);
+        return;
+      }
+      else {
+        input_mem_obj = createDeviceBuffer(context, CL_MEM_READ_ONLY, input_bytes);
+        output_mem_obj = createDeviceBuffer(context, CL_MEM_WRITE_ONLY, output_bytes);
+      }
+
+      if(memoryMode == GpuMemoryMode::Pinned) {
+        pinned_input_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+                                              input_bytes, NULL, &ret);
+        CHECK_CL_ERROR(ret);
+        pinned_output_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+                                               output_bytes, NULL, &ret);
+        CHECK_CL_ERROR(ret);
+        pinned_input = static_cast<S *>(clEnqueueMapBuffer(command_queue, pinned_input_mem_obj, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                                           0, input_bytes, 0, NULL, NULL, &ret));
+        CHECK_CL_ERROR(ret);
+        pinned_output = static_cast<StorageCplx *>(clEnqueueMapBuffer(command_queue, pinned_output_mem_obj, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                                                  0, output_bytes, 0, NULL, NULL, &ret));
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+    // The rows of the images have 'image_width' pixels, with 'ZeroCopy' the host memory has whole rows.
+    void createImages(cl_context context) {
+      bool const zeroCopy = (memoryMode == GpuMemoryMode::ZeroCopy);
+      cl_mem_flags const host_flags = zeroCopy ? CL_MEM_USE_HOST_PTR : 0;
+      if(zeroCopy) {
+        host_output.resize(image_width * imageRows(image_width, outputPixels()) * cplxsPerPixel);
+      }
+      if(placement == GpuFftPlacement::InPlace) {
+        // the input pixels are at the beginning of the output pixels
+        output_mem_obj = createTiledImage(context, CL_MEM_READ_WRITE | host_flags, image_width, outputPixels(),
+                                          zeroCopy ? host_output.data() : NULL);
+        input_mem_obj = output_mem_obj;
+        return;
+      }
+      if(zeroCopy) {
+        host_input.resize(image_width * imageRows(image_width, inputPixels()) * realsPerPixel);
+      }
+      input_mem_obj = createTiledImage(context, CL_MEM_READ_ONLY | host_flags, image_width, inputPixels(),
+                                       zeroCopy ? host_input.data() : NULL);
+      output_mem_obj = createTiledImage(context, CL_MEM_WRITE_ONLY | host_flags, image_width, outputPixels(),
+                                        zeroCopy ? host_output.data() : NULL);
+    }
+
+    // The arguments of the kernel never change, so we set them once.
+    void setKernelArgs(cl_context context, StftProcessing<T> const & stft) {
+      size_t const local_mem_bytes = localMemoryNeeds(sz, algorithm, localLayout);
+      cl_int ret;
+      if(isStockham(algorithm)) {
+        ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&input_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&output_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, 2, local_mem_bytes, NULL); // local memory
+        CHECK_CL_ERROR(ret);
+      }
+      else {
+        ret = clSetKernelArg(kernel, 0, local_mem_bytes, NULL); // local memory
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&input_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, 2, sizeof(cl_mem), (void *)&output_mem_obj);
+        CHECK_CL_ERROR(ret);
+      }
+      if(twiddles) {
+        // the table is the last argument (see twiddles.c)
+        ret = clSetKernelArg(kernel, 3, sizeof(cl_mem), (void *)&twiddles->getMemObject());
+        CHECK_CL_ERROR(ret);
+      }
+      if(!stft.window.empty()) {
+        // the window follows the twiddles (see stft.c)
+        window_mem_obj = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                        sz * sizeof(T), const_cast<T *>(stft.window.data()), &ret);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, twiddles ? 4 : 3, sizeof(cl_mem), (void *)&window_mem_obj);
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+    // Releases the buffers that were created, in the destructor or when the constructor fails
+    // (the errors are logged, so that the destructor doesn't throw).
+    void release() {
+      if(pinned_input) {
+        LOG_CL_ERROR(clEnqueueUnmapMemObject(command_queue, pinned_input_mem_obj, pinned_input, 0, NULL, NULL));
+        pinned_input = nullptr;
+      }
+      if(pinned_output) {
+        LOG_CL_ERROR(clEnqueueUnmapMemObject(command_queue, pinned_output_mem_obj, pinned_output, 0, NULL, NULL));
+        pinned_output = nullptr;
+      }
+      if(pinned_input_mem_obj || pinned_output_mem_obj) {
+        // the buffers are released once they are unmapped
+        LOG_CL_ERROR(clFinish(command_queue));
+      }
+      for(auto * mem : {&pinned_input_mem_obj, &pinned_output_mem_obj, &window_mem_obj}) {
+        if(*mem) {
+          LOG_CL_ERROR(clReleaseMemObject(*mem));
+          *mem = 0;
+        }
+      }
+      if(output_mem_obj && output_mem_obj != input_mem_obj) {
+        releaseDeviceBuffer(output_mem_obj);
+      }
+      if(input_mem_obj) {
+        releaseDeviceBuffer(input_mem_obj);
+      }
+      input_mem_obj = output_mem_obj = 0;
+    }
+
+    GpuFftPlan(const GpuFftPlan&) = delete;
+    GpuFftPlan& operator=(const GpuFftPlan&) = delete;
+    GpuFftPlan(GpuFftPlan&&) = delete;
+    GpuFftPlan& operator=(GpuFftPlan&&) = delete;
+  };
+
+} // NS imajuscule
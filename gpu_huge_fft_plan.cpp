@@ -0,0 +1,368 @@
+/*
+ A 'GpuHugeFftPlan' computes the forward fft of real inputs whose size is too big
+ for the single-workgroup kernels (see vector_fft_floats_stockham_huge_fourstep.cl).
+
+ The fft of size N = N1 * N2, where N2 is the biggest size that fits in local memory,
+ is decomposed in (the "six-step" variant of the four-step algorithm):
+
+   1. transpose the N1 x N2 input matrix
+   2. N2 ffts of size N1 (recursively decomposed if N1 doesn't fit in local memory)
+   3. transpose, and multiply by the twiddle factors exp(-2*i*pi*n2*k1/N)
+   4. N1 ffts of size N2
+   5. transpose
+
+ All steps ping pong between two device buffers, so the size is only limited by
+ CL_DEVICE_MAX_MEM_ALLOC_SIZE.
+
+ With 'GpuFftPlacement::InPlace', the input is written in the buffer that receives the output
+ (it is converted to complex numbers in the other buffer by the first step), so the input buffer
+ is not needed: the plan uses 4 instead of 5 reals of device memory per input element.
+
+ The ffts of step 2 and 4 use the local memory layout 'layout' (see local_layout.cpp):
+ 'LocalLayout::Auto' is 'LocalLayout::Interleaved', since these ffts are not autotuned.
+
+ The computations are done in 'T', and the buffers contain 'S' (see precision.cpp):
+ double precision reduces the error of long transforms, and half storage halves
+ the memory traffic of the steps, which are bandwidth-bound.
+ */
+
+namespace imajuscule {
+
+  constexpr auto hugeFftKernelFile = "vector_fft_floats_stockham_huge_fourstep.cl";
+
+  template<typename T, typename S = T>
+  struct GpuHugeFftPlan {
+    using Precision = FftPrecision<T, S>;
+    using Complex = std::complex<T>;
+    using StorageCplx = StorageComplex<S>;
+
+    // The biggest fft size that fits in the local memory of the device.
+    static int maxLocalSize(cl_device_id device_id, LocalLayout layout = LocalLayout::Interleaved) {
+      int sz = 2;
+      while(GpuFftPlan<T, S>::fitsInLocalMemory(device_id, 2*sz, FftAlgo::Stockham, layout)) {
+        sz *= 2;
+      }
+      return sz;
+    }
+
+    static cl_ulong maxAllocSize(cl_device_id device_id) {
+      cl_ulong sz;
+      cl_int ret = clGetDeviceInfo(device_id,
+                                   CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+                                   sizeof(sz), &sz, NULL);
+      CHECK_CL_ERROR(ret);
+      return sz;
+    }
+
+    static bool fitsInGlobalMemory(cl_device_id device_id, int size) {
+      return size * sizeof(StorageCplx) <= maxAllocSize(device_id);
+    }
+
+    GpuHugeFftPlan(cl_context context,
+                   cl_device_id device_id,
+                   cl_command_queue command_queue,
+                   int size,
+                   GpuFftPlacement placement_ = GpuFftPlacement::OutOfPlace,
+                   DeviceMemoryPool * pool_ = nullptr,
+                   LocalLayout layout = LocalLayout::Auto) :
+    context(context),
+    device_id(device_id),
+    command_queue(command_queue),
+    sz(size),
+    localLayout(resolveLocalLayout(layout, read_kernel(hugeFftKernelFile))),
+    localSize(maxLocalSize(device_id, localLayout)),
+    placement(placement_),
+    pool(pool_)
+    {
+      verify(is_power_of_two(size) && size >= 2);
+      if(!fitsInGlobalMemory(device_id, size)) {
+        throw std::runtime_error("the fft doesn't fit in a device buffer");
+      }
+      Precision::checkDevice(device_id);
+
+      // the destructor doesn't run when the constructor throws
+      // (for example when the pool can't hand out a buffer after the first ones).
+      try {
+        for(auto & b : buffers) {
+          b = createDeviceBuffer(CL_MEM_READ_WRITE, sz * sizeof(StorageCplx));
+        }
+        if(placement == GpuFftPlacement::InPlace) {
+          // 'decompose' writes the result in buffers[1]
+          input_mem_obj = buffers[1];
+        }
+        else {
+          input_mem_obj = createDeviceBuffer(CL_MEM_READ_ONLY, sz * sizeof(S));
+        }
+
+        steps.push_back(copyStep(input_mem_obj, buffers[0]));
+        output_mem_obj = decompose(sz, 1, buffers[0], buffers[1]);
+      }
+      catch(...) {
+        release();
+        throw;
+      }
+    }
+
+    ~GpuHugeFftPlan() {
+      release();
+    }
+
+    int size() const { return sz; }
+    GpuFftPlacement getPlacement() const { return placement; }
+    LocalLayout getLocalLayout() const { return localLayout; }
+
+    // The size of the device buffers
+    size_t bufferBytes() const {
+      size_t const bytes = 2 * static_cast<size_t>(sz) * sizeof(StorageCplx);
+      return (placement == GpuFftPlacement::InPlace) ? bytes : (bytes + sz * sizeof(S));
+    }
+
+    // The number of kernels enqueued by 'enqueue'
+    int countKernels() const { return steps.size(); }
+
+    void write(std::vector<T> const & input) {
+      verify(input.size() == static_cast<size_t>(sz));
+      S const * data;
+      if constexpr (std::is_same_v<S, T>) {
+        data = input.data();
+      }
+      else {
+        staging_input.resize(input.size());
+        std::transform(input.begin(), input.end(), staging_input.begin(), toStorage<S, T>);
+        data = staging_input.data();
+      }
+      cl_int ret = clEnqueueWriteBuffer(command_queue, input_mem_obj, CL_TRUE, 0,
+                                        input.size() * sizeof(S), data, 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    // Enqueues the fft of the input that is on the device.
+    // 'events' receives the events of the kernels, they should be released by the caller.
+    void enqueue(std::vector<cl_event> & events) {
+      events.clear();
+      for(auto & s : steps) {
+        cl_kernel const kernel = s.program->kernels[s.kernel];
+        cl_int ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&s.from);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&s.to);
+        CHECK_CL_ERROR(ret);
+        if(s.kernel == TransposeKernel) {
+          ret = clSetKernelArg(kernel, 2, sizeof(T), (void *)&s.minus_two_pi_over_n);
+          CHECK_CL_ERROR(ret);
+        }
+        else if(s.kernel == RowFftsKernel) {
+          ret = clSetKernelArg(kernel, 2, s.local_mem_bytes, NULL); // local memory
+          CHECK_CL_ERROR(ret);
+        }
+        cl_event event;
+        ret = clEnqueueNDRangeKernel(command_queue, kernel, 3, NULL,
+                                     s.global_item_size,
+                                     s.local_item_size,
+                                     0, NULL, &event);
+        CHECK_CL_ERROR(ret);
+        events.push_back(event);
+      }
+    }
+
+    void read(std::vector<Complex> & output) {
+      output.resize(sz);
+      if constexpr (std::is_same_v<S, T>) {
+        cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                         output.size() * sizeof(Complex), output.data(), 0, NULL, NULL);
+        CHECK_CL_ERROR(ret);
+      }
+      else {
+        staging_output.resize(sz);
+        cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_TRUE, 0,
+                                         staging_output.size() * sizeof(StorageCplx), staging_output.data(), 0, NULL, NULL);
+        CHECK_CL_ERROR(ret);
+        std::transform(staging_output.begin(), staging_output.end(), output.begin(), fromStorage<T, S>);
+      }
+    }
+
+    // Non-blocking variants of 'write' and 'read': the host memory must stay valid until the command is complete,
+    // and the commands are ordered by the queue of the plan (so the next write waits for the previous read).
+    // The returned event should be released by the caller.
+
+    cl_event enqueueWrite(S const * input) {
+      cl_event event;
+      cl_int ret = clEnqueueWriteBuffer(command_queue, input_mem_obj, CL_FALSE, 0,
+                                        sz * sizeof(S), input, 0, NULL, &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    cl_event enqueueRead(StorageCplx * output) {
+      cl_event event;
+      cl_int ret = clEnqueueReadBuffer(command_queue, output_mem_obj, CL_FALSE, 0,
+                                       sz * sizeof(StorageCplx), output, 0, NULL, &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    void execute(std::vector<T> const & input, std::vector<Complex> & output) {
+      write(input);
+      std::vector<cl_event> events;
+      enqueue(events);
+      for(auto e : events) {
+        cl_int ret = clReleaseEvent(e);
+        CHECK_CL_ERROR(ret);
+      }
+      // the read is blocking, and the queue is in-order so it waits for the kernels.
+      read(output);
+    }
+
+  private:
+    // the kernels of a program, in the order of the names given in 'getProgram'
+    enum KernelIdx { RealToComplexKernel, TransposeKernel, RowFftsKernel };
+
+    struct Step {
+      FftProgram<T> * program;
+      KernelIdx kernel;
+      cl_mem from, to;
+      T minus_two_pi_over_n = 0;
+      size_t local_mem_bytes = 0;
+      size_t global_item_size[3] = {1, 1, 1};
+      size_t local_item_size[3] = {1, 1, 1};
+    };
+
+    cl_context context;
+    cl_device_id device_id;
+    cl_command_queue command_queue;
+    int sz;
+    LocalLayout localLayout;
+    int localSize;
+    GpuFftPlacement placement;
+    // The device buffers are sub-buffers of the pool, if not null.
+    DeviceMemoryPool * pool;
+
+    // The programs, by fft size
+    std::map<int, std::unique_ptr<FftProgram<T>>> programs;
+    std::vector<Step> steps;
+
+    cl_mem input_mem_obj = 0, output_mem_obj = 0;
+    cl_mem buffers[2] = {0, 0};
+
+    // The conversions, when the storage type is not 'T'
+    std::vector<S> staging_input;
+    std::vector<StorageCplx> staging_output;
+
+    FftProgram<T> & getProgram(int size) {
+      auto & p = programs[size];
+      if(!p) {
+        GpuFftBatch batch;
+        batch.inputStride = size;
+        batch.outputStride = size;
+        std::string const src = Precision::specialize(specializeLocalLayout(read_kernel(hugeFftKernelFile), localLayout));
+        p = std::make_unique<FftProgram<T>>(context, device_id, src,
+                                            size, FftAlgo::Stockham, batch, 0,
+                                            std::vector<std::string>{"real_to_complex", "transpose", "row_ffts"});
+      }
+      return *p;
+    }
+
+    // The program used for the kernels that don't depend on the fft size.
+    FftProgram<T> & anyProgram() {
+      return getProgram(std::min(sz, localSize));
+    }
+
+    Step copyStep(cl_mem from, cl_mem to) {
+      Step s;
+      s.program = &anyProgram();
+      s.kernel = RealToComplexKernel;
+      s.from = from;
+      s.to = to;
+      s.global_item_size[0] = sz;
+      s.local_item_size[0] = std::min(sz, 64);
+      return s;
+    }
+
+    Step transposeStep(int rows, int cols, int batchCount, cl_mem from, cl_mem to, bool twiddle) {
+      Step s;
+      s.program = &anyProgram();
+      s.kernel = TransposeKernel;
+      s.from = from;
+      s.to = to;
+      if(twiddle) {
+        s.minus_two_pi_over_n = static_cast<T>(-2. * M_PI / (static_cast<double>(rows) * cols));
+      }
+      int const tile_dim = std::min({16, rows, cols});
+      s.global_item_size[0] = cols;
+      s.global_item_size[1] = rows;
+      s.global_item_size[2] = batchCount;
+      s.local_item_size[0] = tile_dim;
+      s.local_item_size[1] = tile_dim;
+      return s;
+    }
+
+    Step rowFftsStep(int size, int batchCount, cl_mem from, cl_mem to) {
+      Step s;
+      s.program = &getProgram(size);
+      s.kernel = RowFftsKernel;
+      s.from = from;
+      s.to = to;
+      s.local_mem_bytes = GpuFftPlan<T, S>::localMemoryNeeds(size, FftAlgo::Stockham, localLayout);
+      s.global_item_size[0] = size/(2*s.program->nButterfliesPerThread);
+      s.global_item_size[1] = batchCount;
+      s.local_item_size[0] = s.global_item_size[0];
+      return s;
+    }
+
+    cl_mem createDeviceBuffer(cl_mem_flags flags, size_t bytes) {
+      if(pool) {
+        return pool->allocate(bytes, flags);
+      }
+      cl_int ret;
+      cl_mem mem = clCreateBuffer(context, flags, bytes, NULL, &ret);
+      CHECK_CL_ERROR(ret);
+      return mem;
+    }
+
+    void releaseDeviceBuffer(cl_mem mem) {
+      if(pool) {
+        pool->release(mem);
+        return;
+      }
+      LOG_CL_ERROR(clReleaseMemObject(mem));
+    }
+
+    // Releases the buffers that were created, in the destructor or when the constructor fails
+    // (the errors are logged, so that the destructor doesn't throw).
+    void release() {
+      if(input_mem_obj && input_mem_obj != buffers[1]) {
+        releaseDeviceBuffer(input_mem_obj);
+      }
+      for(auto & b : buffers) {
+        if(b) {
+          releaseDeviceBuffer(b);
+        }
+        b = 0;
+      }
+      input_mem_obj = output_mem_obj = 0;
+    }
+
+    // Adds the steps computing 'batchCount' ffts of size 'size', from 'a' (which is overwritten)
+    // to 'b', and returns the buffer containing the result.
+    cl_mem decompose(int size, int batchCount, cl_mem a, cl_mem b) {
+      if(size <= localSize) {
+        steps.push_back(rowFftsStep(size, batchCount, a, b));
+        return b;
+      }
+      int const n2 = localSize;
+      int const n1 = size / n2;
+      steps.push_back(transposeStep(n1, n2, batchCount, a, b, false));
+      cl_mem const res = decompose(n1, batchCount * n2, b, a);
+      verify(res == a);
+      steps.push_back(transposeStep(n2, n1, batchCount, a, b, true));
+      steps.push_back(rowFftsStep(n2, batchCount * n1, b, a));
+      steps.push_back(transposeStep(n1, n2, batchCount, a, b, false));
+      return b;
+    }
+
+    GpuHugeFftPlan(const GpuHugeFftPlan&) = delete;
+    GpuHugeFftPlan& operator=(const GpuHugeFftPlan&) = delete;
+    GpuHugeFftPlan(GpuHugeFftPlan&&) = delete;
+    GpuHugeFftPlan& operator=(GpuHugeFftPlan&&) = delete;
+  };
+
+} // NS imajuscule
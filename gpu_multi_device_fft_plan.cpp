@@ -0,0 +1,142 @@
+/*
+ A 'MultiDeviceFftPlan' computes a batch of ffts on several devices (see gpu_devices.cpp):
+ the batch is split in shards, one per device, in proportion to the throughputs of the devices.
+
+ - the throughput of a device is measured once (the end-to-end duration of the whole batch on the device,
+   transfers included), and stored in the tuning db, keyed by the device name (identical devices share it),
+ - 'execute' enqueues the transfers and the kernel of every shard on the queue of its device
+   without blocking, so that the devices work concurrently, then waits for all of them.
+ */
+
+namespace imajuscule {
+
+  template<typename T>
+  struct MultiDeviceFftPlan {
+    using Plan = GpuFftPlan<T>;
+    using Complex = typename Plan::Complex;
+
+    struct Shard {
+      GpuDevice * device;
+      // The ffts [first, first + count) of the batch
+      int first, count;
+      // The number of ffts per second
+      double throughput;
+      std::unique_ptr<Plan> plan;
+    };
+
+    // Throws std::runtime_error if no device supports the size and the batch count.
+    MultiDeviceFftPlan(std::vector<GpuDevice *> const & devices,
+                       int size,
+                       int batchCount,
+                       FftAlgo algo = FftAlgo::Stockham) :
+    sz(size),
+    count(batchCount)
+    {
+      verify(batchCount >= 1);
+      double totalThroughput = 0.;
+      for(auto * d : devices) {
+        auto plan = makePlan(*d, algo, batchCount);
+        if(!plan) {
+          continue;
+        }
+        double const throughput = measureThroughput(*d, *plan, algo);
+        totalThroughput += throughput;
+        shards.push_back({d, 0, 0, throughput, std::move(plan)});
+      }
+      if(shards.empty()) {
+        throw std::runtime_error("no device supports this fft");
+      }
+
+      // The rounding error goes to the fastest device.
+      auto fastest = std::max_element(shards.begin(), shards.end(), [](auto const & a, auto const & b) {
+        return a.throughput < b.throughput;
+      });
+      int assigned = 0;
+      for(auto & s : shards) {
+        s.count = static_cast<int>(batchCount * (s.throughput / totalThroughput));
+        assigned += s.count;
+      }
+      fastest->count += batchCount - assigned;
+
+      // The devices with no ffts are removed, the others get a plan for their shard.
+      shards.erase(std::remove_if(shards.begin(), shards.end(), [](auto const & s) { return s.count == 0; }),
+                   shards.end());
+      int first = 0;
+      for(auto & s : shards) {
+        s.first = first;
+        first += s.count;
+        if(s.count != batchCount) {
+          s.plan = makePlan(*s.device, algo, s.count);
+          verify(s.plan != nullptr);
+        }
+      }
+    }
+
+    int size() const { return sz; }
+    int batchCount() const { return count; }
+    std::vector<Shard> const & getShards() const { return shards; }
+
+    size_t inputElements() const { return static_cast<size_t>(count) * sz; }
+    size_t outputElements() const { return static_cast<size_t>(count) * sz; }
+
+    // Computes the ffts of the batch, whose inputs are stored contiguously in 'input'.
+    void execute(std::vector<T> const & input, std::vector<Complex> & output) {
+      verify(input.size() == inputElements());
+      output.resize(outputElements());
+      std::vector<cl_event> events, reads;
+      for(auto & s : shards) {
+        size_t const offset = static_cast<size_t>(s.first) * sz;
+        cl_command_queue const queue = s.device->command_queue;
+        cl_event const write = s.plan->enqueueWrite(queue, input.data() + offset, {});
+        cl_event const kernel = s.plan->enqueue(queue, {write});
+        cl_event const read = s.plan->enqueueRead(queue, output.data() + offset, {kernel});
+        events.push_back(write);
+        events.push_back(kernel);
+        reads.push_back(read);
+        cl_int ret = clFlush(queue);
+        CHECK_CL_ERROR(ret);
+      }
+      cl_int ret = clWaitForEvents(reads.size(), reads.data());
+      CHECK_CL_ERROR(ret);
+      events.insert(events.end(), reads.begin(), reads.end());
+      for(auto e : events) {
+        ret = clReleaseEvent(e);
+        CHECK_CL_ERROR(ret);
+      }
+    }
+
+  private:
+    int sz, count;
+    std::vector<Shard> shards;
+
+    // Returns nullptr if the device doesn't support the size or the batch count.
+    std::unique_ptr<Plan> makePlan(GpuDevice & d, FftAlgo algo, int batchCount) const {
+      GpuFftBatch batch;
+      batch.count = batchCount;
+      try {
+        // The transfers use the memory of the caller, so the plans don't need staging buffers.
+        return std::make_unique<Plan>(d.context, d.device_id, d.command_queue, sz, algo, std::string{}, GpuFftConfig{},
+                                      batch, GpuMemoryMode::Copy);
+      }
+      catch(std::runtime_error const & e) {
+        return {};
+      }
+    }
+
+    double measureThroughput(GpuDevice & d, Plan & plan, FftAlgo algo) const {
+      std::string const variant = std::string("multi_device_") + defaultKernelFile(algo) + "_batch" + std::to_string(count);
+      double const duration = measuredDuration(d.name(), variant, sz, [&]() {
+        // The input values have no influence on the durations.
+        std::vector<T> input(inputElements());
+        for(size_t i=0; i<input.size(); ++i) {
+          input[i] = std::sin(static_cast<T>(i));
+        }
+        return [&plan, input = std::move(input), output = std::vector<Complex>{}]() mutable {
+          plan.execute(input, output);
+        };
+      });
+      return count / (duration * 1e-9);
+    }
+  };
+
+} // NS imajuscule
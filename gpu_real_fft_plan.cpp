@@ -0,0 +1,247 @@
+/*
+ A 'GpuRealFftPlan' computes ffts of real signals of size N, and the matching inverse ffts,
+ by packing the N reals as N/2 complex numbers (see
+ vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles_real.cl).
+
+ Compared to 'GpuFftPlan', it needs half the butterflies and half the local memory.
+ The local memory layout ('GpuFftConfig::layout', see local_layout.cpp) is an option, like for 'GpuFftPlan'.
+
+ The spectrum has the half-spectrum layout: the N/2+1 first bins (from the DC bin
+ to the Nyquist bin), the other bins being the conjugates of these.
+ */
+
+namespace imajuscule {
+
+  constexpr auto realFftKernelFile = "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles_real.cl";
+
+  template<typename T>
+  struct GpuRealFftPlan {
+    static_assert(std::is_same_v<T, float>, "only float kernels exist for now");
+
+    using Complex = std::complex<T>;
+
+    // the Stockham kernel ping pongs between two buffers of N/2 complex numbers.
+    static size_t localMemoryNeeds(int size, LocalLayout layout = LocalLayout::Interleaved) {
+      return 2 * localLayoutElements(layout, size/2) * sizeof(Complex);
+    }
+
+    static bool fitsInLocalMemory(cl_device_id device_id, int size, LocalLayout layout = LocalLayout::Interleaved) {
+      return localMemoryNeeds(size, layout) <= deviceLocalMemorySize(device_id);
+    }
+
+    static int spectrumSize(int size) {
+      return size/2 + 1;
+    }
+
+    // The variant of the entries of the tuning db (see 'autotuneRealFft' in autotune.cpp)
+    static std::string tuningDbVariant() {
+      return tuningVariant(FftAlgo::Stockham, realFftKernelFile, FftPrecision<T, T>::name());
+    }
+
+    /*
+     'batch_.inputStride' is the distance (in reals) between consecutive signals,
+     'batch_.outputStride' is the distance (in bins) between consecutive spectrums.
+     */
+    GpuRealFftPlan(cl_context context,
+                   cl_device_id device_id,
+                   cl_command_queue command_queue,
+                   int size,
+                   GpuFftConfig config = {},
+                   GpuFftBatch batch_ = {}) :
+    command_queue(command_queue),
+    sz(size),
+    batch(batch_)
+    {
+      verify(is_power_of_two(size) && size >= 4);
+      if(!batch.inputStride) {
+        batch.inputStride = sz;
+      }
+      if(!batch.outputStride) {
+        batch.outputStride = spectrumSize(sz);
+      }
+      verify(batch.count >= 1);
+      verify(batch.inputStride >= sz && batch.outputStride >= spectrumSize(sz));
+
+      config = tunedConfig(device_id, tuningDbVariant(), sz, config);
+      // The kernels compute the whole fft in a single workgroup.
+      if(config.nWorkgroups != 1) {
+        throw std::runtime_error("this kernel uses a single workgroup");
+      }
+      std::string const kernel_src = read_kernel(realFftKernelFile);
+      localLayout = resolveLocalLayout(config.layout, kernel_src);
+      if(!fitsInLocalMemory(device_id, size, localLayout)) {
+        throw std::runtime_error("not enough local memory on the device");
+      }
+
+      // The kernels are specialized for the complex fft of size N/2.
+      program = std::make_unique<FftProgram<T>>(context, device_id, specializeLocalLayout(kernel_src, localLayout),
+                                                sz/2, FftAlgo::Stockham, batch, config.nButterfliesPerThread,
+                                                std::vector<std::string>{"kernel_func", "kernel_inverse"});
+      forward_kernel = program->kernels[0];
+      inverse_kernel = program->kernels[1];
+
+      // the destructor doesn't run when the constructor throws.
+      try {
+        cl_int ret;
+        signal_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                                        signalElements() * sizeof(T), NULL, &ret);
+        CHECK_CL_ERROR(ret);
+        spectrum_mem_obj = clCreateBuffer(context, CL_MEM_READ_WRITE,
+                                          spectrumElements() * sizeof(Complex), NULL, &ret);
+        CHECK_CL_ERROR(ret);
+
+        // The arguments of the kernels never change, so we set them once.
+        size_t const local_mem_bytes = localMemoryNeeds(sz, localLayout);
+        ret = clSetKernelArg(forward_kernel, 0, sizeof(cl_mem), (void *)&signal_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(forward_kernel, 1, sizeof(cl_mem), (void *)&spectrum_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(forward_kernel, 2, local_mem_bytes, NULL); // local memory
+        CHECK_CL_ERROR(ret);
+
+        ret = clSetKernelArg(inverse_kernel, 0, sizeof(cl_mem), (void *)&spectrum_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(inverse_kernel, 1, sizeof(cl_mem), (void *)&signal_mem_obj);
+        CHECK_CL_ERROR(ret);
+        ret = clSetKernelArg(inverse_kernel, 2, local_mem_bytes, NULL); // local memory
+        CHECK_CL_ERROR(ret);
+      }
+      catch(...) {
+        release();
+        throw;
+      }
+
+      // The first dimension of the NDRange is used for the items of an fft,
+      // the second one selects the fft in the batch.
+      global_item_size[0] = sz/(4*program->nButterfliesPerThread);
+      global_item_size[1] = batch.count;
+      local_item_size[0] = global_item_size[0];
+      local_item_size[1] = 1;
+    }
+
+    ~GpuRealFftPlan() {
+      release();
+    }
+
+    int size() const { return sz; }
+    GpuFftBatch const & getBatch() const { return batch; }
+    int getButterfliesPerThread() const { return program->nButterfliesPerThread; }
+    LocalLayout getLocalLayout() const { return localLayout; }
+    // The number of work items used per fft
+    size_t getGlobalSize() const { return global_item_size[0]; }
+    size_t getLocalSize() const { return local_item_size[0]; }
+
+    // The number of reals (resp. bins) of the signals (resp. spectrums) of the whole batch, including the strides
+    size_t signalElements() const { return (batch.count-1) * static_cast<size_t>(batch.inputStride) + sz; }
+    size_t spectrumElements() const { return (batch.count-1) * static_cast<size_t>(batch.outputStride) + spectrumSize(sz); }
+
+    // The device buffers, so that other kernels can consume (resp. produce) the spectrums (resp. signals)
+    // without a round-trip to the host.
+    cl_mem signalBuffer() const { return signal_mem_obj; }
+    cl_mem spectrumBuffer() const { return spectrum_mem_obj; }
+
+    // Forward fft
+
+    void writeSignal(std::vector<T> const & signal) {
+      verify(signal.size() == signalElements());
+      cl_int ret = clEnqueueWriteBuffer(command_queue, signal_mem_obj, CL_TRUE, 0,
+                                        signal.size() * sizeof(T), signal.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    // Enqueues the fft of the signal that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueueForward() {
+      return enqueueKernel(forward_kernel);
+    }
+
+    void readSpectrum(std::vector<Complex> & spectrum) {
+      spectrum.resize(spectrumElements());
+      cl_int ret = clEnqueueReadBuffer(command_queue, spectrum_mem_obj, CL_TRUE, 0,
+                                       spectrum.size() * sizeof(Complex), spectrum.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void forward(std::vector<T> const & signal, std::vector<Complex> & spectrum) {
+      writeSignal(signal);
+      cl_event event = enqueueForward();
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+      // the read is blocking, and the queue is in-order so it waits for the kernel.
+      readSpectrum(spectrum);
+    }
+
+    // Inverse fft (not normalized: inverse(forward(x)) = N * x)
+
+    void writeSpectrum(std::vector<Complex> const & spectrum) {
+      verify(spectrum.size() == spectrumElements());
+      cl_int ret = clEnqueueWriteBuffer(command_queue, spectrum_mem_obj, CL_TRUE, 0,
+                                        spectrum.size() * sizeof(Complex), spectrum.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    // Enqueues the inverse fft of the spectrum that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueueInverse() {
+      return enqueueKernel(inverse_kernel);
+    }
+
+    void readSignal(std::vector<T> & signal) {
+      signal.resize(signalElements());
+      cl_int ret = clEnqueueReadBuffer(command_queue, signal_mem_obj, CL_TRUE, 0,
+                                       signal.size() * sizeof(T), signal.data(), 0, NULL, NULL);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void inverse(std::vector<Complex> const & spectrum, std::vector<T> & signal) {
+      writeSpectrum(spectrum);
+      cl_event event = enqueueInverse();
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+      readSignal(signal);
+    }
+
+    // So that 'averageKernelDuration' can be used to measure the forward fft.
+    cl_event enqueue() {
+      return enqueueForward();
+    }
+
+  private:
+    cl_command_queue command_queue;
+    int sz;
+    GpuFftBatch batch;
+    LocalLayout localLayout;
+
+    std::unique_ptr<FftProgram<T>> program;
+    cl_kernel forward_kernel, inverse_kernel;
+    size_t global_item_size[2], local_item_size[2];
+
+    cl_mem signal_mem_obj = 0, spectrum_mem_obj = 0;
+
+    // (the errors are logged, so that the destructor doesn't throw)
+    void release() {
+      for(auto * mem : {&signal_mem_obj, &spectrum_mem_obj}) {
+        if(*mem) {
+          LOG_CL_ERROR(clReleaseMemObject(*mem));
+          *mem = 0;
+        }
+      }
+    }
+
+    cl_event enqueueKernel(cl_kernel kernel) {
+      cl_event event;
+      cl_int ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL,
+                                          global_item_size,
+                                          local_item_size,
+                                          0, NULL, &event);
+      CHECK_CL_ERROR(ret);
+      return event;
+    }
+
+    GpuRealFftPlan(const GpuRealFftPlan&) = delete;
+    GpuRealFftPlan& operator=(const GpuRealFftPlan&) = delete;
+    GpuRealFftPlan(GpuRealFftPlan&&) = delete;
+    GpuRealFftPlan& operator=(GpuRealFftPlan&&) = delete;
+  };
+
+} // NS imajuscule
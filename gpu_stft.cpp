@@ -0,0 +1,109 @@
+/*
+ A 'GpuStftPlan' computes the short-time Fourier transform (or the spectrogram) of a real signal:
+ the ffts of the frames of 'frameSize' samples, 'hop' samples apart, multiplied by a window,
+ in a single kernel launch.
+
+ There is no framing on the host: the signal is uploaded once, the frames are the overlapping inputs
+ of the batch of a 'GpuFftPlan' (the input stride is the hop), and the kernel multiplies them by the window
+ when it loads them to local memory (see stft.c). With 75% overlap, the upload is 4 times smaller
+ than the upload of the frames.
+
+ With 'SpectrumOutput::Magnitude' (resp. 'Power'), the kernel writes the magnitudes (resp. the powers)
+ of the bins instead of the spectrum, so the output has half the size.
+ */
+
+namespace imajuscule {
+
+  template<typename T>
+  struct GpuStftPlan {
+    using Complex = std::complex<T>;
+
+    // The number of frames of 'frameSize' samples, 'hop' samples apart, in a signal of 'signalSize' samples
+    static int countFrames(size_t signalSize, int frameSize, int hop) {
+      return (signalSize < static_cast<size_t>(frameSize)) ? 0 : static_cast<int>(1 + (signalSize - frameSize) / hop);
+    }
+
+    // 'window' has 'frameSize' values (see 'hannWindow'), or is empty for no window.
+    GpuStftPlan(cl_context context,
+                cl_device_id device_id,
+                cl_command_queue command_queue,
+                int frameSize,
+                int hop,
+                int nFrames,
+                std::vector<T> window,
+                SpectrumOutput output = SpectrumOutput::Complex,
+                FftAlgo algo = FftAlgo::Stockham,
+                GpuFftConfig config = {},
+                GpuMemoryMode memory_mode = GpuMemoryMode::Auto) :
+    plan(context, device_id, command_queue, frameSize, algo, std::string{}, config, framesBatch(nFrames, hop),
+         memory_mode, GpuFftPlacement::OutOfPlace, nullptr, StftProcessing<T>{std::move(window), output})
+    {}
+
+    int frameSize() const { return plan.size(); }
+    int hop() const { return plan.getBatch().inputStride; }
+    int frames() const { return plan.getBatch().count; }
+    SpectrumOutput getSpectrumOutput() const { return plan.getSpectrumOutput(); }
+
+    // The number of samples of the signal covered by the frames
+    size_t signalElements() const { return plan.inputElements(); }
+
+    GpuFftPlan<T> & getPlan() { return plan; }
+
+    // Copies the 'signalElements()' samples of the signal to the device.
+    void write(std::vector<T> const & signal) {
+      plan.write(signal);
+    }
+
+    // Enqueues the ffts of the frames of the signal that is on the device.
+    // The returned event should be released by the caller.
+    cl_event enqueue() {
+      return plan.enqueue();
+    }
+
+    // With 'SpectrumOutput::Complex': copies the 'frameSize()' bins of each frame from the device.
+    void read(std::vector<Complex> & spectrogram) {
+      verify(getSpectrumOutput() == SpectrumOutput::Complex);
+      plan.read(spectrogram);
+    }
+
+    // With 'SpectrumOutput::Magnitude' or 'Power': copies the values of the 'frameSize()' bins of each frame from the device.
+    void read(std::vector<T> & spectrogram) {
+      verify(getSpectrumOutput() != SpectrumOutput::Complex);
+      plan.read(packed);
+      // the values of the bins 2*i and 2*i+1 are the real and imaginary parts of the i-th complex number
+      spectrogram.resize(2 * packed.size());
+      for(size_t i=0; i<packed.size(); ++i) {
+        spectrogram[2*i] = packed[i].real();
+        spectrogram[2*i+1] = packed[i].imag();
+      }
+    }
+
+    template<typename Spectrogram>
+    void execute(std::vector<T> const & signal, Spectrogram & spectrogram) {
+      write(signal);
+      cl_event event = enqueue();
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+      // the read is blocking, and the queue is in-order so it waits for the kernel.
+      read(spectrogram);
+    }
+
+  private:
+    GpuFftPlan<T> plan;
+    std::vector<Complex> packed;
+
+    static GpuFftBatch framesBatch(int nFrames, int hop) {
+      verify(nFrames >= 1 && hop >= 1);
+      GpuFftBatch batch;
+      batch.count = nFrames;
+      batch.inputStride = hop;
+      return batch;
+    }
+
+    GpuStftPlan(const GpuStftPlan&) = delete;
+    GpuStftPlan& operator=(const GpuStftPlan&) = delete;
+    GpuStftPlan(GpuStftPlan&&) = delete;
+    GpuStftPlan& operator=(GpuStftPlan&&) = delete;
+  };
+
+} // NS imajuscule
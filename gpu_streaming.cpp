@@ -0,0 +1,375 @@
+/*
+ Low-latency streaming, for real-time audio: the caller pushes blocks of 'blockSize' samples
+ (typically in the audio callback), and pops the finished output blocks in the same order:
+
+ - 'GpuStreamingFft' outputs the spectrum of the last 'frameSize' samples (a sliding window in a ring buffer,
+   which hops by 'blockSize' samples),
+ - 'GpuStreamingConvolution' outputs the convolution of the stream with an impulse response (see gpu_convolution.cpp).
+
+ 'push' enqueues the upload, the kernels and the download of the block without blocking: the commands
+ are chained with event wait lists, and the only wait is in 'pop', for the download of its block.
+ Up to 'nInFlight' blocks can be pushed before the oldest one is popped.
+
+ The latency of a block is measured with the device timer, from the enqueue of its upload
+ (CL_PROFILING_COMMAND_QUEUED) to the end of its download (CL_PROFILING_COMMAND_END),
+ so it doesn't depend on when 'pop' is called (the command queue must have been created
+ with CL_QUEUE_PROFILING_ENABLE). The latencies are recorded in a 'LatencyHistogram',
+ and a block misses its deadline when its latency is longer than the deadline
+ (by default, the duration of a block at the sample rate).
+ */
+
+#include <chrono>
+
+namespace imajuscule {
+
+  /*
+   A histogram of durations in nanoseconds, with 32 buckets per power of 2:
+   the percentiles are upper bounds of the exact values, within 3%.
+   */
+  struct LatencyHistogram {
+    void add(double ns) {
+      int const b = bucket(ns);
+      if(b >= static_cast<int>(buckets.size())) {
+        buckets.resize(b+1, 0);
+      }
+      ++buckets[b];
+      ++n;
+      sum += ns;
+      maximum = std::max(maximum, ns);
+    }
+
+    void clear() {
+      buckets.clear();
+      n = 0;
+      sum = 0.;
+      maximum = 0.;
+    }
+
+    size_t count() const { return n; }
+    double mean() const { return n ? (sum / n) : 0.; }
+    double max() const { return maximum; }
+
+    // The duration below which 'p' percent of the durations are.
+    double percentile(double p) const {
+      size_t const target = std::max<size_t>(1, static_cast<size_t>(std::ceil(p / 100. * n)));
+      size_t acc = 0;
+      for(size_t b=0; b<buckets.size(); ++b) {
+        acc += buckets[b];
+        if(acc >= target) {
+          return std::min(upperBound(b), maximum);
+        }
+      }
+      return maximum;
+    }
+
+  private:
+    static constexpr int log2SubBuckets = 5;
+    static constexpr int subBuckets = 1 << log2SubBuckets;
+
+    std::vector<size_t> buckets;
+    size_t n = 0;
+    double sum = 0., maximum = 0.;
+
+    // The durations below 2*subBuckets ns have one bucket per ns.
+    static int bucket(double ns) {
+      uint64_t const v = static_cast<uint64_t>(std::max(ns, 0.));
+      if(v < 2*subBuckets) {
+        return static_cast<int>(v);
+      }
+      int e = 0; // the exponent of the highest bit of 'v'
+      while((v >> (e+1)) != 0) {
+        ++e;
+      }
+      uint64_t const m = v >> (e - log2SubBuckets); // in [subBuckets, 2*subBuckets)
+      return (e - log2SubBuckets + 1) * subBuckets + static_cast<int>(m - subBuckets);
+    }
+
+    static double upperBound(size_t b) {
+      if(b < 2*subBuckets) {
+        return static_cast<double>(b+1);
+      }
+      int const e = static_cast<int>(b / subBuckets) + log2SubBuckets - 1;
+      uint64_t const m = (b % subBuckets) + subBuckets;
+      return static_cast<double>((m+1) << (e - log2SubBuckets));
+    }
+  };
+
+  struct GpuStreamConfig {
+    // The number of blocks that can be pushed before the oldest one is popped
+    int nInFlight = 2;
+    double sampleRate = 48000.;
+    // 0 means "the duration of a block at 'sampleRate'"
+    std::chrono::nanoseconds deadline{0};
+  };
+
+  namespace detail {
+
+    // The first and the last command of a block
+    struct StreamEvents {
+      cl_event first, last;
+    };
+
+    inline std::vector<cl_event> nonNullEvents(std::initializer_list<cl_event> events) {
+      std::vector<cl_event> res;
+      for(auto e : events) {
+        if(e) {
+          res.push_back(e);
+        }
+      }
+      return res;
+    }
+
+    template<typename T>
+    struct StreamedFft {
+      using Sample = T;
+      using OutputElement = std::complex<T>;
+
+      StreamedFft(cl_context context,
+                  cl_device_id device_id,
+                  cl_command_queue command_queue,
+                  int blockSize,
+                  int frameSize,
+                  FftAlgo algo = FftAlgo::Stockham) :
+      command_queue(command_queue),
+      blockSz(blockSize),
+      // The transfers use the memory of the stream, so the plan doesn't need staging buffers.
+      plan(context, device_id, command_queue, frameSize, algo, std::string{}, GpuFftConfig{}, GpuFftBatch{},
+           GpuMemoryMode::Copy),
+      ring(frameSize, 0)
+      {
+        verify(is_power_of_two(blockSize) && blockSize <= frameSize);
+      }
+
+      ~StreamedFft() {
+        for(cl_event e : {kernel, read}) {
+          if(e) {
+            cl_int ret = clReleaseEvent(e);
+            CHECK_CL_ERROR(ret);
+          }
+        }
+      }
+
+      int blockSize() const { return blockSz; }
+      size_t inputElements() const { return plan.size(); }
+      size_t outputElements() const { return plan.size(); }
+
+      // Writes the block in the ring buffer, and the frame ending with the block to 'input'.
+      void assemble(T const * block, T * input) {
+        std::copy(block, block + blockSz, ring.begin() + pos);
+        pos = (pos + blockSz) % ring.size();
+        // the oldest sample is at 'pos'
+        std::copy(ring.begin() + pos, ring.end(), input);
+        std::copy(ring.begin(), ring.begin() + pos, input + (ring.size() - pos));
+      }
+
+      StreamEvents enqueue(T const * input, OutputElement * output) {
+        // The upload overwrites the input buffer, so it waits for the previous kernel.
+        cl_event const write = plan.enqueueWrite(command_queue, input, nonNullEvents({kernel}));
+        // The kernel overwrites the output buffer, so it waits for the previous download.
+        cl_event const k = plan.enqueue(command_queue, nonNullEvents({write, read}));
+        cl_event const r = plan.enqueueRead(command_queue, output, {k});
+        for(cl_event e : {kernel, read}) {
+          if(e) {
+            cl_int ret = clReleaseEvent(e);
+            CHECK_CL_ERROR(ret);
+          }
+        }
+        kernel = k;
+        read = r;
+        // the stream releases its references
+        cl_int ret = clRetainEvent(read);
+        CHECK_CL_ERROR(ret);
+        return {write, read};
+      }
+
+    private:
+      cl_command_queue command_queue;
+      int blockSz;
+      GpuFftPlan<T> plan;
+      std::vector<T> ring;
+      size_t pos = 0; // where the next block is written in 'ring'
+      // The events of the last block
+      cl_event kernel = 0, read = 0;
+    };
+
+    template<typename T>
+    struct StreamedConvolution {
+      using Sample = T;
+      using OutputElement = T;
+
+      StreamedConvolution(cl_context context,
+                          cl_device_id device_id,
+                          cl_command_queue command_queue,
+                          int blockSize,
+                          std::vector<T> const & impulseResponse) :
+      convolution(context, device_id, command_queue, blockSize, impulseResponse)
+      {}
+
+      int blockSize() const { return convolution.getBlockSize(); }
+      size_t inputElements() const { return blockSize(); }
+      size_t outputElements() const { return blockSize(); }
+
+      void assemble(T const * block, T * input) {
+        std::copy(block, block + blockSize(), input);
+      }
+
+      StreamEvents enqueue(T const * input, OutputElement * output) {
+        cl_event write;
+        cl_event const last = convolution.enqueueBlock(input, &write);
+        cl_event const read = convolution.enqueueReadOutput(output, {last});
+        cl_int ret = clReleaseEvent(last);
+        CHECK_CL_ERROR(ret);
+        return {write, read};
+      }
+
+      GpuConvolution<T> & getConvolution() { return convolution; }
+
+    private:
+      GpuConvolution<T> convolution;
+    };
+
+  } // NS detail
+
+  template<typename Processor>
+  struct GpuStream {
+    using T = typename Processor::Sample;
+    using OutputElement = typename Processor::OutputElement;
+
+    // 'args' are the arguments of the processor following the block size
+    // (the frame size for 'GpuStreamingFft', the impulse response for 'GpuStreamingConvolution').
+    template<typename... Args>
+    GpuStream(cl_context context,
+              cl_device_id device_id,
+              cl_command_queue command_queue,
+              int blockSize,
+              GpuStreamConfig const & config,
+              Args &&... args) :
+    command_queue(command_queue),
+    processor(context, device_id, command_queue, blockSize, std::forward<Args>(args)...),
+    deadline_ns(config.deadline.count() ? static_cast<double>(config.deadline.count()) : (1e9 * blockSize / config.sampleRate))
+    {
+      verify(config.nInFlight >= 1);
+      slots.resize(config.nInFlight);
+      for(auto & s : slots) {
+        s.input.resize(processor.inputElements());
+        s.output.resize(processor.outputElements());
+      }
+    }
+
+    ~GpuStream() {
+      cl_int ret = clFinish(command_queue);
+      CHECK_CL_ERROR(ret);
+      for(auto & s : slots) {
+        s.releaseEvents();
+      }
+    }
+
+    int blockSize() const { return processor.blockSize(); }
+    int countInFlight() const { return inFlight; }
+    bool full() const { return inFlight == static_cast<int>(slots.size()); }
+    double deadline() const { return deadline_ns; }
+    Processor & getProcessor() { return processor; }
+
+    // Enqueues the processing of a block of 'blockSize()' samples. The stream must not be full.
+    void push(T const * block) {
+      verify(!full());
+      Slot & s = slots[(oldest + inFlight) % slots.size()];
+      ++inFlight;
+      processor.assemble(block, s.input.data());
+      auto const events = processor.enqueue(s.input.data(), s.output.data());
+      s.first = events.first;
+      s.last = events.last;
+      // Submit the commands to the device now, so that they start as early as possible.
+      cl_int ret = clFlush(command_queue);
+      CHECK_CL_ERROR(ret);
+    }
+
+    void push(std::vector<T> const & block) {
+      verify(block.size() == static_cast<size_t>(blockSize()));
+      push(block.data());
+    }
+
+    // Waits for the output of the oldest pushed block.
+    // Returns false if the block missed its deadline.
+    bool pop(std::vector<OutputElement> & output) {
+      verify(inFlight > 0);
+      Slot & s = slots[oldest];
+      oldest = (oldest + 1) % slots.size();
+      --inFlight;
+
+      cl_int ret = clWaitForEvents(1, &s.last);
+      CHECK_CL_ERROR(ret);
+      cl_ulong queued, end;
+      ret = clGetEventProfilingInfo(s.first, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, NULL);
+      CHECK_CL_ERROR(ret);
+      ret = clGetEventProfilingInfo(s.last, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+      CHECK_CL_ERROR(ret);
+      s.releaseEvents();
+
+      double const latency = static_cast<double>(end - queued);
+      latencies.add(latency);
+      bool const late = latency > deadline_ns;
+      if(late) {
+        ++missed;
+      }
+      output.assign(s.output.begin(), s.output.end());
+      return !late;
+    }
+
+    LatencyHistogram const & getLatencies() const { return latencies; }
+    size_t missedDeadlines() const { return missed; }
+
+    // Forgets the latencies of the popped blocks (for example, those of the warm-up).
+    void resetStatistics() {
+      latencies.clear();
+      missed = 0;
+    }
+
+    void report(std::ostream & os) const {
+      os << latencies.count() << " blocks, latency (us): p50 " << latencies.percentile(50.)/1000.
+      << ", p99 " << latencies.percentile(99.)/1000.
+      << ", p99.9 " << latencies.percentile(99.9)/1000.
+      << ", max " << latencies.max()/1000.
+      << ", deadline " << deadline_ns/1000. << ": " << missed << " missed" << std::endl;
+    }
+
+  private:
+    struct Slot {
+      std::vector<T> input; // the memory of the upload
+      std::vector<OutputElement> output; // the memory of the download
+      cl_event first = 0, last = 0;
+
+      void releaseEvents() {
+        for(cl_event * e : {&first, &last}) {
+          if(*e) {
+            cl_int ret = clReleaseEvent(*e);
+            CHECK_CL_ERROR(ret);
+            *e = 0;
+          }
+        }
+      }
+    };
+
+    cl_command_queue command_queue;
+    Processor processor;
+    double deadline_ns;
+    std::vector<Slot> slots;
+    int oldest = 0; // the slot of the oldest block in flight
+    int inFlight = 0;
+
+    LatencyHistogram latencies;
+    size_t missed = 0;
+
+    GpuStream(const GpuStream&) = delete;
+    GpuStream& operator=(const GpuStream&) = delete;
+    GpuStream(GpuStream&&) = delete;
+    GpuStream& operator=(GpuStream&&) = delete;
+  };
+
+  template<typename T>
+  using GpuStreamingFft = GpuStream<detail::StreamedFft<T>>;
+
+  template<typename T>
+  using GpuStreamingConvolution = GpuStream<detail::StreamedConvolution<T>>;
+
+} // NS imajuscule
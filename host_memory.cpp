@@ -0,0 +1,94 @@
+/*
+ Host memory used to exchange data with the device:
+
+ - 'PageAlignedAllocator' allocates page-aligned memory, which can be wrapped
+   in a buffer created with CL_MEM_USE_HOST_PTR without copies,
+ - 'GpuMemoryMode' selects how the plans transfer their inputs and outputs.
+ */
+
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+
+namespace imajuscule {
+
+  size_t pageSize() {
+    static const size_t sz = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return sz;
+  }
+
+  size_t roundUpToPageSize(size_t bytes) {
+    size_t const page = pageSize();
+    return ((bytes + page - 1) / page) * page;
+  }
+
+  template<typename T>
+  struct PageAlignedAllocator {
+    using value_type = T;
+
+    PageAlignedAllocator() = default;
+    template<typename U>
+    PageAlignedAllocator(PageAlignedAllocator<U> const &) {}
+
+    T * allocate(size_t n) {
+      // the size passed to aligned_alloc must be a multiple of the alignment.
+      void * p = std::aligned_alloc(pageSize(), roundUpToPageSize(std::max<size_t>(1, n * sizeof(T))));
+      if(!p) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(p);
+    }
+
+    void deallocate(T * p, size_t) {
+      std::free(p);
+    }
+
+    template<typename U>
+    bool operator == (PageAlignedAllocator<U> const &) const { return true; }
+    template<typename U>
+    bool operator != (PageAlignedAllocator<U> const &) const { return false; }
+  };
+
+  template<typename T>
+  using page_aligned_vector = std::vector<T, PageAlignedAllocator<T>>;
+
+  enum class GpuMemoryMode {
+    // 'ZeroCopy' if the device shares the memory with the host, else 'Pinned'.
+    Auto,
+    // Buffers in device memory, transfers from / to pageable host memory.
+    Copy,
+    // Buffers in device memory, transfers from / to pinned host memory
+    // (allocated with CL_MEM_ALLOC_HOST_PTR), which allows DMA transfers.
+    Pinned,
+    // Buffers in page-aligned host memory (CL_MEM_USE_HOST_PTR), accessed with map / unmap:
+    // on devices sharing the memory with the host, there is no transfer at all.
+    ZeroCopy
+  };
+
+  bool hasUnifiedMemory(cl_device_id device_id) {
+    cl_bool unified;
+    cl_int ret = clGetDeviceInfo(device_id,
+                                 CL_DEVICE_HOST_UNIFIED_MEMORY,
+                                 sizeof(unified), &unified, NULL);
+    CHECK_CL_ERROR(ret);
+    return unified == CL_TRUE;
+  }
+
+  GpuMemoryMode resolveMemoryMode(cl_device_id device_id, GpuMemoryMode mode) {
+    if(mode != GpuMemoryMode::Auto) {
+      return mode;
+    }
+    return hasUnifiedMemory(device_id) ? GpuMemoryMode::ZeroCopy : GpuMemoryMode::Pinned;
+  }
+
+  const char * toString(GpuMemoryMode mode) {
+    switch(mode) {
+      case GpuMemoryMode::Auto: return "auto";
+      case GpuMemoryMode::Copy: return "copy";
+      case GpuMemoryMode::Pinned: return "pinned";
+      case GpuMemoryMode::ZeroCopy: return "zero-copy";
+    }
+    return "";
+  }
+
+} // NS imajuscule
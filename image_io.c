@@ -0,0 +1,121 @@
+/*
+ The inputs and outputs of the fft kernels, in buffers or in images, selected by the plan (see image_io.cpp).
+
+ The kernel defines IMAGE_IO and LOG2_IMAGE_WIDTH (replaced by the plan), INPUT_STRIDE and OUTPUT_STRIDE
+ before including this file (after stft.c). It declares its input and output with INPUT_PARAM and OUTPUT_PARAM,
+ and transfers them from / to local memory with 'loadInput' and 'storeOutput', which select the fft of the batch
+ with the second dimension of the NDRange, and apply the window and the spectrum output of stft.c:
+
+ - IMAGE_IO_BUFFERS: the input and the output are in global buffers,
+ - IMAGE_IO_IMAGES: the input and the output are 2D images of float RGBA pixels (4 reals, or 2 complex numbers)
+   read through the texture cache. The pixels are tiled across the rows: the pixel p is at
+   (p & (IMAGE_WIDTH-1), p >> LOG2_IMAGE_WIDTH), so the size of a batch is not limited by the width of the images,
+ - IMAGE_IO_READ_WRITE: like IMAGE_IO_IMAGES, for in-place ffts: the input and the output are the same
+   read_write image (OpenCL C 2.0). The whole input is read before the output is written.
+ */
+
+#define IMAGE_IO_BUFFERS    0
+#define IMAGE_IO_IMAGES     1
+#define IMAGE_IO_READ_WRITE 2
+
+#ifndef IMAGE_IO
+#error "the kernel must define IMAGE_IO"
+#endif
+
+#if IMAGE_IO == IMAGE_IO_BUFFERS
+
+#define INPUT_PARAM  __global const REAL_STORAGE *input
+#define OUTPUT_PARAM __global CPLX_STORAGE *global_output
+
+// 'n' is the number of reals read per work item
+inline void loadInput(INPUT_PARAM, __local scalar *to, int const n WINDOW_PARAM) {
+#if STFT_WINDOW == STFT_NO_WINDOW
+  loadRealsToBuffer(input + get_global_id(1) * INPUT_STRIDE, to, n);
+#else
+  loadWindowedRealsToBuffer(input + get_global_id(1) * INPUT_STRIDE, to, n WINDOW_PASS);
+#endif
+}
+
+// 'n' is the number of complex numbers written per work item
+inline void storeOutput(OUTPUT_PARAM, __local scalar const *from, int const n) {
+  __global CPLX_STORAGE *output = global_output + CPLX_STORAGE_OFFSET(get_global_id(1) * OUTPUT_STRIDE);
+#if SPECTRUM_OUTPUT == SPECTRUM_OUTPUT_COMPLEX
+  storeCplxsFromBuffer(output, from, n);
+#else
+  storeBinValuesFromBuffer(output, from, n);
+#endif
+}
+
+#else
+
+#if PRECISION != PRECISION_FLOAT
+#error "the pixels of the images contain floats"
+#endif
+
+#if IMAGE_IO == IMAGE_IO_READ_WRITE
+#define INPUT_PARAM  __read_write image2d_t input
+#define OUTPUT_PARAM __read_write image2d_t global_output
+#else
+#define INPUT_PARAM  __read_only image2d_t input
+#define OUTPUT_PARAM __write_only image2d_t global_output
+#endif
+
+inline int2 pixelCoord(int const p) {
+  int2 c;
+  c.x = p & ((1 << LOG2_IMAGE_WIDTH) - 1);
+  c.y = p >> LOG2_IMAGE_WIDTH;
+  return c;
+}
+
+inline void readPixelToBuffer(INPUT_PARAM, int const p, __local scalar *to, int const m WINDOW_PARAM) {
+  float4 const v = windowReal4(read_imagef(input, pixelCoord(p)), m WINDOW_PASS);
+  setLocal(to, 4*m,   complexFromReal(v.x));
+  setLocal(to, 4*m+1, complexFromReal(v.y));
+  setLocal(to, 4*m+2, complexFromReal(v.z));
+  setLocal(to, 4*m+3, complexFromReal(v.w));
+}
+
+// 'n' is the number of reals read per work item, INPUT_STRIDE is a multiple of 4
+inline void loadInput(INPUT_PARAM, __local scalar *to, int const n WINDOW_PARAM) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  int const first = get_global_id(1) * (INPUT_STRIDE/4);
+  if(n < 4) { // half the work items read a pixel.
+    if((k&1) == 0) {
+      readPixelToBuffer(input, first + k/2, to, k/2 WINDOW_PASS);
+    }
+    return;
+  }
+  for(int j=0; j<n/4; ++j) {
+    int const m = nItems * j + k;
+    readPixelToBuffer(input, first + m, to, m WINDOW_PASS);
+  }
+}
+
+// 'n' is the number of complex numbers written per work item, OUTPUT_STRIDE is a multiple of 2
+inline void storeOutput(OUTPUT_PARAM, __local scalar const *from, int const n) {
+  int const first = get_global_id(1) * (OUTPUT_STRIDE/2);
+#if SPECTRUM_OUTPUT == SPECTRUM_OUTPUT_COMPLEX
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  for(int j=0; j<n/2; ++j) {
+    int const m = nItems * j + k;
+    struct cplx const a = getLocal(from, 2*m);
+    struct cplx const b = getLocal(from, 2*m+1);
+    float4 v;
+    v.x = a.real;
+    v.y = a.imag;
+    v.z = b.real;
+    v.w = b.imag;
+    write_imagef(global_output, pixelCoord(first + m), v);
+  }
+#else
+  // a pixel has the values of 4 bins
+  for(int j=0, nGroups = binValueGroups(n); j<nGroups; ++j) {
+    int const m = binValueGroup(n, j);
+    write_imagef(global_output, pixelCoord(first + m), binValues4(from, m));
+  }
+#endif
+}
+
+#endif
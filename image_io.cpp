@@ -0,0 +1,217 @@
+/*
+ The inputs and outputs of the fft kernels in images (see image_io.c for the kernel side).
+
+ The kernels read images through the texture cache, which is faster than global memory on some devices,
+ and slower on others (see main_fft_many_floats_stockham_twiddles_images.cpp), so the storage of the inputs
+ and outputs is an option of the plan ('GpuFftConfig::io') that the autotuner tries (see autotune.cpp).
+
+ The pixels are tiled across the rows of 2D images, so the size of a batch is limited by
+ CL_DEVICE_IMAGE2D_MAX_WIDTH * CL_DEVICE_IMAGE2D_MAX_HEIGHT instead of CL_DEVICE_IMAGE2D_MAX_WIDTH.
+ The in-place ffts use a read_write image (OpenCL C 2.0) instead of passing the same image
+ as a read-only and a write-only argument.
+
+ When the device, the kernel or the plan doesn't support images, the plan falls back to buffers.
+ */
+
+#include <cstring>
+
+namespace imajuscule {
+
+  enum class IoStorage {
+    // The tuned storage (see tuning_db.cpp) if any, else 'Buffers'.
+    Auto,
+    Buffers,
+    // Images if they are supported, else 'Buffers'.
+    Images
+  };
+
+  constexpr IoStorage explicitIoStorages[] = {
+    IoStorage::Buffers, IoStorage::Images
+  };
+
+  const char * toString(IoStorage s) {
+    switch(s) {
+      case IoStorage::Auto: return "auto";
+      case IoStorage::Buffers: return "buffers";
+      case IoStorage::Images: return "images";
+    }
+    return "";
+  }
+
+  IoStorage ioStorageFromString(std::string const & str) {
+    for(auto s : {IoStorage::Auto, IoStorage::Buffers, IoStorage::Images}) {
+      if(str == toString(s)) {
+        return s;
+      }
+    }
+    throw std::runtime_error("unknown io storage: " + str);
+  }
+
+  // The value of 'IMAGE_IO' in image_io.c
+  int kernelImageIo(IoStorage s, bool readWrite) {
+    switch(s) {
+      case IoStorage::Buffers: return 0;
+      case IoStorage::Images: return readWrite ? 2 : 1;
+      case IoStorage::Auto: break;
+    }
+    throw std::runtime_error("the io storage must be resolved");
+  }
+
+  // The kernels accessing their input and output with 'loadInput' and 'storeOutput' (see image_io.c) support images.
+  bool kernelSupportsImageIo(std::string const & kernel_src) {
+    return kernel_src.find("replace_IMAGE_IO") != std::string::npos;
+  }
+
+  // The image pixels are float RGBA: 4 reals, or 2 complex numbers.
+  constexpr int realsPerPixel = 4;
+  constexpr int cplxsPerPixel = 2;
+  constexpr size_t pixelBytes = 4 * sizeof(float);
+
+  struct ImageIoSupport {
+    // CL_DEVICE_IMAGE_SUPPORT
+    bool images = false;
+    // read_write images, needed by the in-place ffts
+    bool readWrite = false;
+    size_t maxWidth = 0, maxHeight = 0;
+  };
+
+  // The major version of the OpenCL C of the device ("OpenCL C <major>.<minor> ...")
+  int openclCMajorVersion(cl_device_id device_id) {
+    std::string const version = deviceInfoString(device_id, CL_DEVICE_OPENCL_C_VERSION);
+    int major = 0;
+    sscanf(version.c_str(), "OpenCL C %d", &major);
+    return major;
+  }
+
+  ImageIoSupport imageIoSupport(cl_device_id device_id) {
+    ImageIoSupport s;
+    cl_bool images;
+    cl_int ret = clGetDeviceInfo(device_id, CL_DEVICE_IMAGE_SUPPORT, sizeof(images), &images, NULL);
+    CHECK_CL_ERROR(ret);
+    if(!images) {
+      return s;
+    }
+    s.images = true;
+    ret = clGetDeviceInfo(device_id, CL_DEVICE_IMAGE2D_MAX_WIDTH, sizeof(s.maxWidth), &s.maxWidth, NULL);
+    CHECK_CL_ERROR(ret);
+    ret = clGetDeviceInfo(device_id, CL_DEVICE_IMAGE2D_MAX_HEIGHT, sizeof(s.maxHeight), &s.maxHeight, NULL);
+    CHECK_CL_ERROR(ret);
+
+    s.readWrite = (openclCMajorVersion(device_id) >= 2);
+#ifdef CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS
+    if(s.readWrite) {
+      // read_write images are optional in OpenCL 3.0
+      cl_uint n;
+      s.readWrite = (clGetDeviceInfo(device_id, CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS, sizeof(n), &n, NULL) == CL_SUCCESS) && n > 0;
+    }
+#endif
+    return s;
+  }
+
+  // The build options of the kernels using OpenCL C 2.0 features (read_write images, sub-groups)
+  constexpr const char * openCL2BuildOptions = " -cl-std=CL2.0";
+
+  size_t imageRows(size_t width, size_t pixels) {
+    return (pixels + width - 1) / width;
+  }
+
+  // Returns the width (a power of 2) of the images of at most 'pixels' pixels,
+  // or 0 if they are too big for the device.
+  size_t imageWidth(ImageIoSupport const & s, size_t pixels) {
+    size_t width = 1;
+    while(width < pixels && 2*width <= s.maxWidth) {
+      width *= 2;
+    }
+    return (imageRows(width, pixels) <= s.maxHeight) ? width : 0;
+  }
+
+  // An image of float RGBA pixels, with 'imageRows(width, pixels)' rows.
+  // With CL_MEM_USE_HOST_PTR, 'host_ptr' has 'width * rows' pixels.
+  cl_mem createTiledImage(cl_context context, cl_mem_flags flags, size_t width, size_t pixels, void * host_ptr) {
+    cl_image_format format;
+    format.image_channel_order = CL_RGBA;
+    format.image_channel_data_type = CL_FLOAT;
+    cl_image_desc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+    desc.image_width = width;
+    desc.image_height = imageRows(width, pixels);
+    cl_int ret;
+    cl_mem image = clCreateImage(context, flags, &format, &desc, host_ptr, &ret);
+    CHECK_CL_ERROR(ret);
+    return image;
+  }
+
+  // 'width' is 0 when the kernel uses buffers
+  std::string specializeImageIo(std::string const & kernel_src, IoStorage s, bool readWrite, size_t width) {
+    return ReplaceString(ReplaceString(kernel_src,
+                                       "replace_IMAGE_IO",
+                                       std::to_string(kernelImageIo(s, readWrite))),
+                         "replace_LOG2_IMAGE_WIDTH",
+                         std::to_string(width ? power_of_two_exponent(width) : 0));
+  }
+
+  /*
+   Enqueues the transfer of the 'pixels' first pixels of 'image' from (resp. to) 'ptr':
+   the full rows, then the first pixels of the last row
+   (the second command waits for the first one, the returned event is the one of the last command).
+   */
+  cl_event enqueueTiledImageTransfer(cl_command_queue queue, cl_mem image, bool write, cl_bool blocking,
+                                     size_t width, size_t pixels, char * ptr, std::vector<cl_event> const & waitList) {
+    size_t const fullRows = pixels / width;
+    size_t const lastPixels = pixels % width;
+    cl_event event = nullptr;
+    auto const transfer = [&](size_t row, size_t rows, size_t n, cl_uint nWait, const cl_event * wait) {
+      size_t const origin[3] = {0, row, 0};
+      size_t const region[3] = {n, rows, 1};
+      char * p = ptr + row * width * pixelBytes;
+      cl_event e;
+      cl_int ret = write ?
+      clEnqueueWriteImage(queue, image, blocking, origin, region, width * pixelBytes, 0, p, nWait, wait, &e) :
+      clEnqueueReadImage(queue, image, blocking, origin, region, width * pixelBytes, 0, p, nWait, wait, &e);
+      CHECK_CL_ERROR(ret);
+      if(event) {
+        ret = clReleaseEvent(event);
+        CHECK_CL_ERROR(ret);
+      }
+      event = e;
+    };
+    if(fullRows) {
+      transfer(0, fullRows, width, waitList.size(), waitList.empty() ? NULL : waitList.data());
+    }
+    if(lastPixels) {
+      if(event) {
+        transfer(fullRows, 1, lastPixels, 1, &event);
+      }
+      else {
+        transfer(fullRows, 1, lastPixels, waitList.size(), waitList.empty() ? NULL : waitList.data());
+      }
+    }
+    return event;
+  }
+
+  cl_event enqueueWriteTiledImage(cl_command_queue queue, cl_mem image, cl_bool blocking, size_t width, size_t pixels,
+                                  void const * ptr, std::vector<cl_event> const & waitList) {
+    // the memory is not written
+    return enqueueTiledImageTransfer(queue, image, true, blocking, width, pixels,
+                                     const_cast<char *>(static_cast<char const *>(ptr)), waitList);
+  }
+
+  cl_event enqueueReadTiledImage(cl_command_queue queue, cl_mem image, cl_bool blocking, size_t width, size_t pixels,
+                                 void * ptr, std::vector<cl_event> const & waitList) {
+    return enqueueTiledImageTransfer(queue, image, false, blocking, width, pixels, static_cast<char *>(ptr), waitList);
+  }
+
+  // Maps the whole image, whose rows are contiguous.
+  void * mapTiledImage(cl_command_queue queue, cl_mem image, cl_map_flags flags, size_t width, size_t pixels) {
+    size_t const origin[3] = {0, 0, 0};
+    size_t const region[3] = {width, imageRows(width, pixels), 1};
+    size_t row_pitch;
+    cl_int ret;
+    void * p = clEnqueueMapImage(queue, image, CL_TRUE, flags, origin, region, &row_pitch, NULL, 0, NULL, NULL, &ret);
+    CHECK_CL_ERROR(ret);
+    verify(row_pitch == width * pixelBytes);
+    return p;
+  }
+
+} // NS imajuscule
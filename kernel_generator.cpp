@@ -0,0 +1,287 @@
+/*
+ A generator of fft kernels, used by 'FftAlgo::StockhamGenerated' (see gpu_fft_plan.cpp).
+
+ The kernel files are specialized by replacing tokens, so their loops over the passes and the butterflies
+ stay runtime loops with computed indices. Instead, the source generated here is specialized for a size
+ and a number of butterflies per thread: the passes and the butterflies are fully unrolled, and the
+ index arithmetic and the twiddle indices are constants (except for the 'base' index of the work item).
+
+ The optimizations that were forked in separate kernel files are options of the generator,
+ and can be combined (the autotuner tries all combinations, see autotune.cpp):
+
+ - coalesce: consecutive work items access consecutive elements of global memory (else each work item
+   accesses a contiguous range),
+ - peel: the first pass is computed on the reals read from global memory (its twiddle factors are 1),
+   which saves one pass through local memory,
+ - constant: the twiddle factors that are known at generation time are literals (and the multiplications
+   by 1 and -i are removed), the others are read from the twiddle storage of the plan (see twiddles.c).
+
+ The layout of the local memory is an option of the plan, like for the kernel files (see local_layout.cpp).
+
+ The generated kernel is a Stockham radix-2 fft, with the same parameters as the kernel files,
+ and the 'replace_*' tokens of the precision, the batch strides, the twiddle storage and the local memory layout
+ (see local_layout.c).
+ */
+
+#include <sstream>
+
+namespace imajuscule {
+
+  struct GeneratedKernelOptions {
+    bool coalesce = true;
+    bool peel = true;
+    bool constant = true;
+
+    bool operator == (GeneratedKernelOptions const & o) const {
+      return coalesce == o.coalesce && peel == o.peel && constant == o.constant;
+    }
+  };
+
+  // The enabled options, separated by '+', or "none"
+  std::string toString(GeneratedKernelOptions const & o) {
+    std::string s;
+    auto add = [&s](bool enabled, const char * name) {
+      if(enabled) {
+        s += (s.empty() ? "" : "+");
+        s += name;
+      }
+    };
+    add(o.coalesce, "coalesce");
+    add(o.peel, "peel");
+    add(o.constant, "constant");
+    return s.empty() ? "none" : s;
+  }
+
+  GeneratedKernelOptions generatedKernelOptionsFromString(std::string const & str) {
+    GeneratedKernelOptions o{false, false, false};
+    if(str == "none") {
+      return o;
+    }
+    std::istringstream names(str);
+    std::string name;
+    while(std::getline(names, name, '+')) {
+      if(name == "coalesce") {
+        o.coalesce = true;
+      }
+      else if(name == "separate") {
+        // (it is now the 'LocalLayout::Separate' layout of the plan, see local_layout.cpp)
+      }
+      else if(name == "peel") {
+        o.peel = true;
+      }
+      else if(name == "constant") {
+        o.constant = true;
+      }
+      else {
+        throw std::runtime_error("unknown kernel generator option: " + name);
+      }
+    }
+    return o;
+  }
+
+  std::vector<GeneratedKernelOptions> allGeneratedKernelOptions() {
+    std::vector<GeneratedKernelOptions> all;
+    for(int i=0; i<8; ++i) {
+      all.push_back({static_cast<bool>(i & 1), static_cast<bool>(i & 2), static_cast<bool>(i & 4)});
+    }
+    return all;
+  }
+
+  namespace detail {
+
+    // "expr + c", or "expr" when c is 0
+    inline std::string plus(std::string const & expr, int c) {
+      return c ? (expr + " + " + std::to_string(c)) : expr;
+    }
+
+    // Appends to the source of a kernel (std::ostringstream::str would collide with the 'str' macro
+    // of read_kernel_source.cpp).
+    struct SourceWriter {
+      std::string text;
+
+      SourceWriter & operator << (std::string const & s) {
+        text += s;
+        return *this;
+      }
+      SourceWriter & operator << (char const * s) {
+        text += s;
+        return *this;
+      }
+      SourceWriter & operator << (int i) {
+        text += std::to_string(i);
+        return *this;
+      }
+    };
+
+    template<typename T>
+    std::string literal(T v) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%a", v);
+      return buf;
+    }
+
+  } // NS detail
+
+  // The number of butterflies in the source of a work item ('nPasses * nButterfliesPerThread')
+  // above which the generator refuses to unroll.
+  constexpr int maxUnrolledButterflies = 1 << 12;
+
+  /*
+   Returns the source of the kernel computing ffts of size 'size' (a power of 2),
+   with 'nButterfliesPerThread' butterflies per work item and pass.
+
+   The computations are in 'T': the literal twiddle factors are computed in double precision,
+   and rounded to 'T'.
+   */
+  template<typename T>
+  std::string generateStockhamKernel(int size, int nButterfliesPerThread, GeneratedKernelOptions const & options) {
+    using detail::plus;
+    verify(is_power_of_two(size) && size >= 2);
+    int const NB = size/2; // the number of butterflies of a pass
+    int const NLB = nButterfliesPerThread;
+    if(!is_power_of_two(NLB) || NLB > NB) {
+      throw std::runtime_error("the number of butterflies per thread must be a power of 2, <= size/2");
+    }
+    int const log2NB = power_of_two_exponent(NB);
+    int const nPasses = log2NB + 1;
+    if(nPasses * NLB > maxUnrolledButterflies) {
+      throw std::runtime_error("the generated kernel would be too big");
+    }
+    int const nItems = NB / NLB;
+
+    detail::SourceWriter s;
+    s << "// Generated by kernel_generator.cpp: size " << size << ", " << NLB << " butterflies per thread, "
+    << toString(options) << "\n\n"
+    << "#define PRECISION        replace_PRECISION // see precision.cpp\n"
+    << "#include \"cplx.c\"\n\n"
+    << "#define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES\n"
+    << "#define INPUT_STRIDE     replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch\n"
+    << "#define OUTPUT_STRIDE    replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch\n"
+    << "#define TWIDDLE_STORAGE  replace_TWIDDLE_STORAGE // see twiddles.c\n"
+    << "#include \"twiddles.c\"\n\n"
+    // The local memory has room for 2 buffers of 'size' complex numbers.
+    << "#define LOCAL_LAYOUT     replace_LOCAL_LAYOUT // see local_layout.c\n"
+    << "#define LOG2_LOCAL_BANKS replace_LOG2_LOCAL_BANKS\n"
+    << "#define LOCAL_BUFFER_SIZE " << size << "\n"
+    << "#include \"local_layout.c\"\n\n";
+
+    s << "__kernel void kernel_func(__global const REAL_STORAGE *input,\n"
+    << "                          __global CPLX_STORAGE *global_output,\n"
+    << "                          __local scalar* pingpong\n"
+    << "                          TWIDDLES_PARAM) {\n"
+    << "  int const k = get_global_id(0);\n"
+    << "  input += get_global_id(1) * INPUT_STRIDE;\n"
+    << "  global_output += CPLX_STORAGE_OFFSET(get_global_id(1) * OUTPUT_STRIDE);\n"
+    << "  int const base = k * " << NLB << ";\n"
+    << "  __local scalar * const b0 = pingpong;\n"
+    << "  __local scalar * const b1 = b0 + LOCAL_BUFFER_SCALARS;\n";
+
+    auto buffer = [](int pass) { return (pass % 2) ? "b1" : "b0"; };
+
+    // The global memory read, to b0
+    if(!options.peel) {
+      s << "\n  // read\n";
+      if(options.coalesce && NLB >= 2) {
+        for(int j=0; j<(2*NLB)/4; ++j) {
+          std::string const m = plus("k", nItems * j);
+          s << "  {\n"
+          << "    scalar4 const v = loadReal4(input, " << m << ");\n"
+          << "    setLocal(b0, 4*(" << m << "), complexFromReal(v.x));\n"
+          << "    setLocal(b0, 4*(" << m << ") + 1, complexFromReal(v.y));\n"
+          << "    setLocal(b0, 4*(" << m << ") + 2, complexFromReal(v.z));\n"
+          << "    setLocal(b0, 4*(" << m << ") + 3, complexFromReal(v.w));\n"
+          << "  }\n";
+        }
+      }
+      else {
+        for(int j=0; j<2*NLB; ++j) {
+          std::string const m = options.coalesce ? plus("k", nItems * j) : plus("2*base", j);
+          s << "  setLocal(b0, " << m << ", complexFromReal(loadReal(input, " << m << ")));\n";
+        }
+      }
+    }
+
+    // The 'j'-th butterfly of the work item in the pass 'log2i' reads the elements 'base + j'
+    // and 'base + j + NB' of the previous buffer: for i <= NLB, its twiddle index and its output index
+    // (relative to 2*base) are known at generation time.
+    for(int log2i = 0; log2i < nPasses; ++log2i) {
+      int const i = 1 << log2i;
+      int const shift = log2NB - log2i;
+      char const * const from = buffer(log2i);
+      char const * const to = buffer(log2i + 1);
+      s << "\n  // pass " << log2i << "\n";
+
+      if(log2i == 0 && options.peel) {
+        for(int j=0; j<NLB; ++j) {
+          std::string const m = options.coalesce ? plus("k", nItems * j) : plus("base", j);
+          s << "  {\n"
+          << "    scalar const x0 = loadReal(input, " << m << ");\n"
+          << "    scalar const x1 = loadReal(input, " << plus(m, NB) << ");\n"
+          << "    setLocal(" << to << ", 2*(" << m << "), complexFromReal(x0 + x1));\n"
+          << "    setLocal(" << to << ", 2*(" << m << ") + 1, complexFromReal(x0 - x1));\n"
+          << "  }\n";
+        }
+        continue;
+      }
+
+      s << "  barrier(CLK_LOCAL_MEM_FENCE);\n";
+      if(i <= NLB) {
+        for(int j=0; j<NLB; ++j) {
+          int const mm = j & (i-1);
+          int const d = 2*(j-mm) + mm;
+          int const t = mm << shift;
+          std::string x = std::string("getLocal(") + from + ", " + plus("base", j + NB) + ")";
+          s << "  {\n";
+          if(!options.constant) {
+            x = "cplxMult(" + x + ", twiddle(" + std::to_string(t) + "))";
+          }
+          else if(t == 0) {
+            // the twiddle factor is 1
+          }
+          else if(2*t == NB) {
+            x = "cplxMultMinusI(" + x + ")";
+          }
+          else {
+            double const theta = -M_PI * t / NB;
+            s << "    struct cplx const w = { " << detail::literal(static_cast<T>(std::cos(theta)))
+            << ", " << detail::literal(static_cast<T>(std::sin(theta))) << " };\n";
+            x = "cplxMult(" + x + ", w)";
+          }
+          s << "    struct cplx const a = getLocal(" << from << ", " << plus("base", j) << ");\n"
+          << "    struct cplx const t = " << x << ";\n"
+          << "    setLocal(" << to << ", " << plus("2*base", d) << ", cplxAdd(a, t));\n"
+          << "    setLocal(" << to << ", " << plus("2*base", d + i) << ", cplxSub(a, t));\n"
+          << "  }\n";
+        }
+        continue;
+      }
+      // (base + j) & (i-1) = mm + j, with mm = base & (i-1), because NLB < i
+      s << "  {\n"
+      << "    int const mm = base & " << (i-1) << ";\n"
+      << "    int const d = 2*base - mm;\n";
+      for(int j=0; j<NLB; ++j) {
+        s << "    {\n"
+        << "      struct cplx const a = getLocal(" << from << ", " << plus("base", j) << ");\n"
+        << "      struct cplx const t = cplxMult(getLocal(" << from << ", " << plus("base", j + NB) << "), "
+        << "twiddle(" << plus("mm", j) << " << " << shift << "));\n"
+        << "      setLocal(" << to << ", " << plus("d", j) << ", cplxAdd(a, t));\n"
+        << "      setLocal(" << to << ", " << plus("d", j + i) << ", cplxSub(a, t));\n"
+        << "    }\n";
+      }
+      s << "  }\n";
+    }
+
+    // The global memory write, from the buffer written by the last pass
+    char const * const result = buffer(nPasses);
+    s << "\n  // write\n"
+    << "  barrier(CLK_LOCAL_MEM_FENCE);\n";
+    for(int j=0; j<NLB; ++j) {
+      std::string const m = options.coalesce ? plus("k", nItems * j) : plus("base", j);
+      s << "  storeCplx2(global_output, " << m << ", getLocal(" << result << ", 2*(" << m << ")), getLocal("
+      << result << ", 2*(" << m << ") + 1));\n";
+    }
+    s << "}\n";
+    return s.text;
+  }
+
+} // NS imajuscule
@@ -0,0 +1,137 @@
+/*
+ The layout of the complex numbers in local memory, selected by the plan (see local_layout.cpp).
+
+ The kernel defines LOCAL_LAYOUT and LOG2_LOCAL_BANKS (replaced by the plan), and LOCAL_BUFFER_SIZE
+ (the number of complex numbers of a buffer, a power of 2) before including this file.
+ A buffer is a '__local scalar *' of LOCAL_BUFFER_SCALARS scalars, accessed with 'getLocal' and 'setLocal':
+
+ - LOCAL_LAYOUT_INTERLEAVED: the real and imaginary parts are interleaved (a 'struct cplx' array),
+ - LOCAL_LAYOUT_SEPARATE: the imaginary parts are in a second array, after the real parts
+   (the accesses are 4 bytes wide instead of 8, which halves the bank conflicts of strided accesses),
+ - LOCAL_LAYOUT_PADDED: like LOCAL_LAYOUT_SEPARATE, with one unused scalar after every LOCAL_BANKS scalars,
+   so that the power of 2 strides of the butterflies don't map to the same bank,
+ - LOCAL_LAYOUT_XOR: like LOCAL_LAYOUT_SEPARATE, with the index i swizzled by xoring its bits of the bank
+   with the next ones: no memory overhead, and the power of 2 strides (>= LOCAL_BANKS) use all the banks.
+ */
+
+#define LOCAL_LAYOUT_INTERLEAVED 0
+#define LOCAL_LAYOUT_SEPARATE    1
+#define LOCAL_LAYOUT_PADDED      2
+#define LOCAL_LAYOUT_XOR         3
+
+#ifndef LOCAL_LAYOUT
+#error "the kernel must define LOCAL_LAYOUT"
+#endif
+#ifndef LOCAL_BUFFER_SIZE
+#error "the kernel must define LOCAL_BUFFER_SIZE"
+#endif
+
+#define LOCAL_BANKS (1 << LOG2_LOCAL_BANKS)
+
+#if LOCAL_LAYOUT == LOCAL_LAYOUT_PADDED
+// the number of scalars of the real (or imaginary) parts of a buffer, including the padding
+#define LOCAL_PART_SCALARS (LOCAL_BUFFER_SIZE + (LOCAL_BUFFER_SIZE >> LOG2_LOCAL_BANKS))
+inline int localIndex(int const i) {
+  return i + (i >> LOG2_LOCAL_BANKS);
+}
+#elif LOCAL_LAYOUT == LOCAL_LAYOUT_XOR
+#define LOCAL_PART_SCALARS LOCAL_BUFFER_SIZE
+inline int localIndex(int const i) {
+  return i ^ ((i >> LOG2_LOCAL_BANKS) & (LOCAL_BANKS-1));
+}
+#else
+#define LOCAL_PART_SCALARS LOCAL_BUFFER_SIZE
+inline int localIndex(int const i) {
+  return i;
+}
+#endif
+
+#define LOCAL_BUFFER_SCALARS (2*LOCAL_PART_SCALARS)
+
+#if LOCAL_LAYOUT == LOCAL_LAYOUT_INTERLEAVED
+
+inline struct cplx getLocal(__local scalar const *b, int const i) {
+  return ((__local struct cplx const *)b)[i];
+}
+
+inline void setLocal(__local scalar *b, int const i, struct cplx const c) {
+  ((__local struct cplx *)b)[i] = c;
+}
+
+#else
+
+inline struct cplx getLocal(__local scalar const *b, int const i) {
+  int const j = localIndex(i);
+  struct cplx c;
+  c.real = b[j];
+  c.imag = b[j + LOCAL_PART_SCALARS];
+  return c;
+}
+
+inline void setLocal(__local scalar *b, int const i, struct cplx const c) {
+  int const j = localIndex(i);
+  b[j] = c.real;
+  b[j + LOCAL_PART_SCALARS] = c.imag;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
+// The coalesced transfers between global memory and a local buffer
+// with the wide accesses of 'loadReal4', 'loadCplx2' and 'storeCplx2' (see cplx.c)
+////////////////////////////////////////////////////////////////////
+
+inline void loadRealsToBuffer(__global const REAL_STORAGE *input, __local scalar *to, int const n) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 4) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      setLocal(to, m, complexFromReal(loadReal(input, m)));
+    }
+    return;
+  }
+  for(int j=0; j<n/4; ++j) {
+    int const m = nItems * j + k;
+    scalar4 const v = loadReal4(input, m);
+    setLocal(to, 4*m,   complexFromReal(v.x));
+    setLocal(to, 4*m+1, complexFromReal(v.y));
+    setLocal(to, 4*m+2, complexFromReal(v.z));
+    setLocal(to, 4*m+3, complexFromReal(v.w));
+  }
+}
+
+inline void loadCplxsToBuffer(__global const CPLX_STORAGE *input, __local scalar *to, int const n) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 2) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      setLocal(to, m, loadCplx(input, m));
+    }
+    return;
+  }
+  for(int j=0; j<n/2; ++j) {
+    int const m = nItems * j + k;
+    struct cplx a, b;
+    loadCplx2(input, m, &a, &b);
+    setLocal(to, 2*m,   a);
+    setLocal(to, 2*m+1, b);
+  }
+}
+
+inline void storeCplxsFromBuffer(__global CPLX_STORAGE *output, __local scalar const *from, int const n) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 2) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      storeCplx(output, m, getLocal(from, m));
+    }
+    return;
+  }
+  for(int j=0; j<n/2; ++j) {
+    int const m = nItems * j + k;
+    storeCplx2(output, m, getLocal(from, 2*m), getLocal(from, 2*m+1));
+  }
+}
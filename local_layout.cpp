@@ -0,0 +1,91 @@
+/*
+ The layout of the complex numbers in the local memory of the fft kernels (see local_layout.c for the kernel side).
+
+ Which layout has the fewest bank conflicts depends on the device, so it is an option of the plan
+ ('GpuFftConfig::layout') that the autotuner tries (see autotune.cpp), for the kernels
+ that access the local memory with 'getLocal' and 'setLocal'.
+ */
+
+namespace imajuscule {
+
+  enum class LocalLayout {
+    // The tuned layout (see tuning_db.cpp) if any, else 'Interleaved'.
+    Auto,
+    // The real and imaginary parts are interleaved.
+    Interleaved,
+    // The imaginary parts are in a second array.
+    Separate,
+    // 'Separate', with one unused scalar every '1 << log2LocalMemoryBanks' scalars.
+    Padded,
+    // 'Separate', with xor-swizzled indices.
+    Xor
+  };
+
+  constexpr LocalLayout explicitLocalLayouts[] = {
+    LocalLayout::Interleaved, LocalLayout::Separate, LocalLayout::Padded, LocalLayout::Xor
+  };
+
+  // The number of banks of local memory assumed by 'Padded' and 'Xor' (OpenCL doesn't expose it,
+  // it is 32 on most gpus).
+  constexpr int log2LocalMemoryBanks = 5;
+
+  const char * toString(LocalLayout l) {
+    switch(l) {
+      case LocalLayout::Auto: return "auto";
+      case LocalLayout::Interleaved: return "interleaved";
+      case LocalLayout::Separate: return "separate";
+      case LocalLayout::Padded: return "padded";
+      case LocalLayout::Xor: return "xor";
+    }
+    return "";
+  }
+
+  LocalLayout localLayoutFromString(std::string const & str) {
+    for(auto l : {LocalLayout::Auto, LocalLayout::Interleaved, LocalLayout::Separate, LocalLayout::Padded, LocalLayout::Xor}) {
+      if(str == toString(l)) {
+        return l;
+      }
+    }
+    throw std::runtime_error("unknown local memory layout: " + str);
+  }
+
+  // The value of 'LOCAL_LAYOUT' in local_layout.c
+  int kernelLocalLayout(LocalLayout l) {
+    switch(l) {
+      case LocalLayout::Interleaved: return 0;
+      case LocalLayout::Separate: return 1;
+      case LocalLayout::Padded: return 2;
+      case LocalLayout::Xor: return 3;
+      case LocalLayout::Auto: break;
+    }
+    throw std::runtime_error("the local memory layout must be resolved");
+  }
+
+  bool kernelSupportsLocalLayouts(std::string const & kernel_src) {
+    return kernel_src.find("replace_LOCAL_LAYOUT") != std::string::npos;
+  }
+
+  LocalLayout resolveLocalLayout(LocalLayout l, std::string const & kernel_src) {
+    if(l == LocalLayout::Auto) {
+      return LocalLayout::Interleaved;
+    }
+    if(l != LocalLayout::Interleaved && !kernelSupportsLocalLayouts(kernel_src)) {
+      throw std::runtime_error("this kernel uses the interleaved local memory layout");
+    }
+    return l;
+  }
+
+  // The number of complex numbers of local memory used by a buffer of 'n' complex numbers.
+  constexpr int localLayoutElements(LocalLayout l, int n) {
+    return (l == LocalLayout::Padded) ? (n + (n >> log2LocalMemoryBanks)) : n;
+  }
+
+  std::string specializeLocalLayout(std::string const & kernel_src, LocalLayout l) {
+    return ReplaceString(ReplaceString(kernel_src,
+                                       "replace_LOCAL_LAYOUT",
+                                       std::to_string(kernelLocalLayout(l))),
+                         "replace_LOG2_LOCAL_BANKS",
+                         std::to_string(log2LocalMemoryBanks));
+  }
+
+} // NS imajuscule
@@ -1,31 +1,6 @@
+// To compare the kernels, use the benchmarks of main_benchmark.cpp (the 'gpgpu_bench' target).
 
-// common includes
-
-#include <complex>
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <stdio.h>
-#include <stdlib.h>
-#include <vector>
-#include <unordered_set>
-
-#ifdef __APPLE__
-#include <OpenCL/opencl.h>
-#else
-#include <CL/cl.h>
-#endif
-
-#include "error_check.cpp"
-
-#include "read_kernel_source.cpp"
-
-#include "math.cpp"
-#include "bitReverse.cpp"
-#include "rand.cpp"
-
-#include "cpu_fft.cpp"
-#include "cpu_fft_norecursion.cpp"
+#include "common_includes.cpp"
 
 
 
@@ -83,10 +58,9 @@
 //#include "main_fft_huge_floats_local_twiddles.cpp"
 
 // 6.2 This example computes an fft (Stockham radix-2)
-//    on vectors of huge sizes (using 2 different kernels to compute the fft, one for the first levels
-//    and the other for the last levels. The use of sequential kernels allow for global synchronization
-//    across workgroups), using local memory to speed up the kernel,
-//    and computing twiddle factors on the fly instead of reading them from memory:
+//    on vectors of huge sizes, using the four-step algorithm: ffts of sizes that fit in local memory,
+//    separated by tiled transposes (the use of sequential kernels allow for global synchronization
+//    across workgroups), and computing twiddle factors on the fly instead of reading them from memory:
 //
 #include "main_fft_huge_floats_stockham_local_twiddles.cpp"
 
@@ -128,3 +102,97 @@
 //    using images instead of global memory for global input and output
 //
 //#include "main_fft_many_floats_stockham_twiddles_images.cpp"
+
+// 13. This example computes batches of ffts (Stockham radix-2, or radix-4)
+//    of small sizes, using a single kernel launch per batch:
+//
+//#include "main_fft_batched_floats_stockham_twiddles.cpp"
+
+// 14. This example computes ffts of real signals (Stockham radix-2), packing the N reals
+//    as N/2 complex numbers, and the matching inverse ffts:
+//
+//#include "main_fft_many_floats_stockham_real.cpp"
+
+// 15. This example convolves a signal with an impulse response (uniformly partitioned
+//    overlap-save convolution), every stage running on the device:
+//
+//#include "main_convolution_floats_partitioned.cpp"
+
+// 16. This example computes a stream of ffts (Stockham radix-2), overlapping the transfers
+//    to and from the device with the kernels, using several command queues and buffer sets:
+//
+//#include "main_fft_pipelined_floats_stockham_twiddles.cpp"
+
+// 17. This example compares the memory modes of the plan: transfers from pageable memory,
+//    from pinned memory, and zero-copy buffers accessed with map / unmap:
+//
+//#include "main_fft_memory_modes_floats_stockham_twiddles.cpp"
+
+// 18. This example compares the precisions of the ffts of large sizes: float, double,
+//    and half precision storage with float computations:
+//
+//#include "main_fft_huge_precisions_stockham.cpp"
+
+// 19. This example compares the cpu ffts: the scalar version of the stockham kernel,
+//    and the vectorized plan for each instruction set supported by the cpu:
+//
+//#include "main_fft_many_floats_cpu_simd.cpp"
+
+// 20. This example computes batches of ffts on the backend (cpu or gpu) that is the fastest
+//    for their size and batch count, or on both:
+//
+//#include "main_fft_hybrid_dispatch.cpp"
+
+// 21. This example computes batches of ffts on all the gpus of all the platforms,
+//    sharding the batches in proportion to the throughputs of the devices:
+//
+//#include "main_fft_multi_device_batched_floats.cpp"
+
+// 22. This example compares the in-place and out-of-place ffts (device memory footprint),
+//    of batches of ffts that fit in local memory, and of huge ffts:
+//
+//#include "main_fft_in_place_floats.cpp"
+
+// 23. This example computes ffts (Stockham radix-2) with the kernels generated for each size
+//    (unrolled passes, constant indices and twiddle factors), for every combination of the options
+//    of the generator, and verifies them:
+//
+//#include "main_fft_generated_floats.cpp"
+
+// 24. This example streams blocks of audio samples through the gpu at the pace of an audio callback
+//    (spectrums of a sliding window, and a partitioned convolution), and reports the histogram
+//    of the latencies of the blocks and the missed deadlines:
+//
+//#include "main_fft_streaming_floats.cpp"
+
+// 25. This example creates plans of several sizes sharing a device memory pool (sub-buffers of a few big allocations),
+//    compares the durations of the allocations with and without the pool, and reports the usage of the pool:
+//
+//#include "main_fft_memory_pool_floats.cpp"
+
+// 26. This example traces the OpenCL commands of sequential and pipelined streams of ffts, and of small ffts:
+//    prints the durations per stage (api call, queued, submitted, executed) and writes Chrome traces:
+//
+//#include "main_fft_trace_floats.cpp"
+
+// 27. This example computes batches of ffts with each kernel family, for every local memory layout
+//    (interleaved, separate real and imaginary parts, padded, xor-swizzled), verifies the results
+//    and compares the kernel durations:
+//
+//#include "main_fft_local_layouts_floats.cpp"
+
+// 28. This example computes batches of ffts with their inputs and outputs in buffers, then in images tiled across rows
+//    (out of place, and in place with read_write images), verifies the results and compares the kernel durations:
+//
+//#include "main_fft_image_io_floats.cpp"
+
+// 29. This example computes the short-time Fourier transform of a signal (Hann window, 75% overlap), with the framing
+//    and the windowing on the host, then fused in the kernel (complex, magnitude and power outputs), verifies the results
+//    and compares the durations and the uploaded sizes:
+//
+//#include "main_fft_stft_floats.cpp"
+
+// 30. This example computes batches of small ffts with the Cooley-Tukey kernel, with the first stages in local memory,
+//    then with sub-group shuffles (when the device supports them), verifies the results and compares the kernel durations:
+//
+//#include "main_fft_subgroup_shuffles_floats.cpp"
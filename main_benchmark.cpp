@@ -0,0 +1,324 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks every plan and kernel variant (see benchmark.cpp) for a range of fft sizes and batch counts,
+// and writes the results as CSV or JSON:
+//
+// gpgpu_bench [--format csv|json] [--output file] [--filter substring]
+//             [--sizes min:max] [--batches 1,64] [--iterations n]
+//
+// The sizes are powers of 2, the filter selects the benchmarks whose name or kernel file contain the substring.
+// The progress and the skipped configurations (not supported by the device) are written to stderr.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "common_includes.cpp"
+#include "benchmark.cpp"
+
+struct Options {
+  bool json = false;
+  std::string output, filter;
+  int minSize = 16, maxSize = 65536;
+  std::vector<int> batchCounts{1, 64};
+  int nIterations = 100;
+};
+
+bool parseOptions(int argc, char * argv[], Options & o) {
+  for(int i=1; i<argc; ++i) {
+    std::string const arg = argv[i];
+    if(i+1 >= argc) {
+      return false;
+    }
+    std::string const value = argv[++i];
+    if(arg == "--format" && (value == "csv" || value == "json")) {
+      o.json = (value == "json");
+    }
+    else if(arg == "--output") {
+      o.output = value;
+    }
+    else if(arg == "--filter") {
+      o.filter = value;
+    }
+    else if(arg == "--sizes" && sscanf(value.c_str(), "%d:%d", &o.minSize, &o.maxSize) == 2) {
+      if(!imajuscule::is_power_of_two(o.minSize) || o.minSize < 4 || o.maxSize < o.minSize) {
+        return false;
+      }
+    }
+    else if(arg == "--batches") {
+      o.batchCounts.clear();
+      std::istringstream is(value);
+      for(std::string count; std::getline(is, count, ',');) {
+        o.batchCounts.push_back(std::stoi(count));
+        if(o.batchCounts.back() < 1) {
+          return false;
+        }
+      }
+    }
+    else if(arg == "--iterations") {
+      o.nIterations = std::stoi(value);
+      if(o.nIterations < 1) {
+        return false;
+      }
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace imajuscule {
+  // The plans using the precision 'T' / 'S' (see precision.cpp), with their default kernel,
+  // are benchmarked as "stockham_<precision>" and "huge_<precision>".
+  template<typename T, typename S>
+  void addPrecisionCases(std::vector<BenchmarkCase> & cases,
+                         cl_context context, cl_device_id device_id, cl_command_queue command_queue) {
+    std::string const suffix = std::string("_") + FftPrecision<T, S>::name();
+    cases.push_back({"stockham" + suffix, defaultKernelFile(FftAlgo::Stockham), true, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+      GpuFftBatch batch;
+      batch.count = batchCount;
+      using Plan = GpuFftPlan<T, S>;
+      return std::make_unique<FftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size, FftAlgo::Stockham,
+                                                                          std::string{}, GpuFftConfig{}, batch));
+    }});
+    cases.push_back({"huge" + suffix, hugeFftKernelFile, false, [=](int size, int) -> std::unique_ptr<BenchmarkRunner> {
+      using Plan = GpuHugeFftPlan<T, S>;
+      return std::make_unique<HugeFftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size));
+    }});
+  }
+} // NS imajuscule
+
+int main(int argc, char * argv[]) {
+  using namespace imajuscule;
+
+  Options options;
+  if(!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0] << " [--format csv|json] [--output file] [--filter substring]"
+    << " [--sizes min:max] [--batches 1,64] [--iterations n]" << std::endl;
+    return 1;
+  }
+  constexpr int nSkipIterations = 5;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  std::vector<BenchmarkCase> cases;
+
+  // The kernels that have the interface of 'GpuFftPlan'.
+  // The other kernels (twiddles in global memory, separate real and imaginary buffers, images)
+  // need the host code of their example in main.cpp.
+  struct FftVariant {
+    const char * name;
+    FftAlgo algo;
+    const char * kernel;
+    bool supportsBatches;
+  };
+  for(auto const & v : {
+    FftVariant{"stockham", FftAlgo::Stockham, "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles.cl", true},
+    FftVariant{"stockham_radix4", FftAlgo::StockhamRadix4, "vector_fft_floats_stockham_multi_local_coalesce_twiddles_radix.cl", true},
+    FftVariant{"stockham_radix8", FftAlgo::StockhamRadix8, "vector_fft_floats_stockham_multi_local_coalesce_twiddles_radix.cl", true},
+    FftVariant{"stockham_registers8", FftAlgo::StockhamRegisters8, "vector_fft_floats_stockham_registers_twiddles_radix.cl", true},
+    FftVariant{"stockham_registers16", FftAlgo::StockhamRegisters16, "vector_fft_floats_stockham_registers_twiddles_radix.cl", true},
+    FftVariant{"cooley_tukey", FftAlgo::CooleyTukey, "vector_fft_floats_multi_local_coalesce_shifts_twiddles.cl", true},
+    FftVariant{"cooley_tukey_natural_order", FftAlgo::CooleyTukeyNaturalOrder, "vector_fft_floats_multi_local_coalesce_shifts_twiddles.cl", true},
+    FftVariant{"cooley_tukey", FftAlgo::CooleyTukey, "vector_fft_floats_multi_local_shifts_twiddles.cl", false},
+    FftVariant{"cooley_tukey", FftAlgo::CooleyTukey, "vector_fft_floats_multi_local_shifts_twiddles_constantinput.cl", false}
+  }) {
+    // The kernels that support twiddle tables are benchmarked for each storage,
+    // the kernels that support local memory layouts are benchmarked for each layout.
+    std::string const kernel_src = read_kernel(v.kernel);
+    bool const tables = kernelSupportsTwiddleTables(kernel_src);
+    bool const layouts = kernelSupportsLocalLayouts(kernel_src);
+    for(auto twiddles : explicitTwiddleStorages) {
+      if(!tables && twiddles != TwiddleStorage::OnTheFly) {
+        continue;
+      }
+      for(auto layout : explicitLocalLayouts) {
+        if(!layouts && layout != LocalLayout::Interleaved) {
+          continue;
+        }
+        std::string name = tables ? (std::string(v.name) + "_twiddles_" + toString(twiddles)) : v.name;
+        if(layout != LocalLayout::Interleaved) {
+          name += std::string("_layout_") + toString(layout);
+        }
+        cases.push_back({name, v.kernel, v.supportsBatches, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+          GpuFftConfig config;
+          config.twiddles = twiddles;
+          config.layout = layout;
+          // (the shuffles have their own cases)
+          config.shuffles = SubgroupShuffles::Off;
+          GpuFftBatch batch;
+          batch.count = batchCount;
+          using Plan = GpuFftPlan<float>;
+          return std::make_unique<FftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size, v.algo, v.kernel,
+                                                                              config, batch));
+        }});
+      }
+    }
+    // The kernels that support images are benchmarked with their inputs and outputs in images too (see image_io.cpp).
+    if(kernelSupportsImageIo(kernel_src)) {
+      cases.push_back({std::string(v.name) + "_io_images", v.kernel, v.supportsBatches, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+        GpuFftConfig config;
+        config.io = IoStorage::Images;
+        GpuFftBatch batch;
+        batch.count = batchCount;
+        using Plan = GpuFftPlan<float>;
+        auto plan = std::make_unique<Plan>(context, device_id, command_queue, size, v.algo, v.kernel, config, batch);
+        if(plan->getIoStorage() != IoStorage::Images) {
+          // the plan fell back to buffers, which are benchmarked already.
+          throw std::runtime_error("the device doesn't support images for this plan");
+        }
+        return std::make_unique<FftPlanRunner<Plan>>(std::move(plan));
+      }});
+    }
+    // The kernels that support sub-group shuffles are benchmarked with shuffles too (see subgroups.cpp).
+    if(kernelSupportsSubgroupShuffles(kernel_src)) {
+      cases.push_back({std::string(v.name) + "_shuffles", v.kernel, v.supportsBatches, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+        GpuFftConfig config;
+        config.shuffles = SubgroupShuffles::On;
+        GpuFftBatch batch;
+        batch.count = batchCount;
+        using Plan = GpuFftPlan<float>;
+        auto plan = std::make_unique<Plan>(context, device_id, command_queue, size, v.algo, v.kernel, config, batch);
+        if(plan->getSubgroupShuffles() != SubgroupShuffles::On) {
+          // the plan fell back to local memory, which is benchmarked already.
+          throw std::runtime_error("the device doesn't support sub-group shuffles");
+        }
+        return std::make_unique<FftPlanRunner<Plan>>(std::move(plan));
+      }});
+    }
+  }
+  // The generated kernels (see kernel_generator.cpp), for each combination of the options of the generator
+  // and each local memory layout
+  for(auto const & generator : allGeneratedKernelOptions()) {
+    for(auto layout : explicitLocalLayouts) {
+      std::string name = "generated_" + toString(generator);
+      if(layout != LocalLayout::Interleaved) {
+        name += std::string("_layout_") + toString(layout);
+      }
+      cases.push_back({name, defaultKernelFile(FftAlgo::StockhamGenerated), true,
+                       [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+        GpuFftConfig config;
+        config.generator = generator;
+        config.layout = layout;
+        GpuFftBatch batch;
+        batch.count = batchCount;
+        using Plan = GpuFftPlan<float>;
+        return std::make_unique<FftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size,
+                                                                            FftAlgo::StockhamGenerated, std::string{},
+                                                                            config, batch));
+      }});
+    }
+  }
+  // The real and huge ffts, for each local memory layout
+  for(auto layout : explicitLocalLayouts) {
+    std::string const suffix = (layout == LocalLayout::Interleaved) ? std::string{} : std::string("_layout_") + toString(layout);
+    cases.push_back({"real" + suffix, realFftKernelFile, true, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+      GpuFftConfig config;
+      config.layout = layout;
+      GpuFftBatch batch;
+      batch.count = batchCount;
+      using Plan = GpuRealFftPlan<float>;
+      return std::make_unique<RealFftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size,
+                                                                              config, batch));
+    }});
+    cases.push_back({"huge" + suffix, hugeFftKernelFile, false, [=](int size, int) -> std::unique_ptr<BenchmarkRunner> {
+      using Plan = GpuHugeFftPlan<float>;
+      return std::make_unique<HugeFftPlanRunner<Plan>>(std::make_unique<Plan>(context, device_id, command_queue, size,
+                                                                              GpuFftPlacement::OutOfPlace, nullptr, layout));
+    }});
+  }
+  addPrecisionCases<double, double>(cases, context, device_id, command_queue);
+  addPrecisionCases<float, cl_half>(cases, context, device_id, command_queue);
+
+  // The cpu baselines (see cpu_fft_simd.cpp), for each instruction set supported by the cpu
+  for(auto isa : {CpuIsa::Scalar, CpuIsa::Sse, CpuIsa::Neon, CpuIsa::Avx2, CpuIsa::Avx512}) {
+    if(!cpuSupports(isa)) {
+      continue;
+    }
+    cases.push_back({std::string("cpu_") + toString(isa), "cpu_fft_simd.cpp", true, [=](int size, int batchCount) -> std::unique_ptr<BenchmarkRunner> {
+      GpuFftBatch batch;
+      batch.count = batchCount;
+      using Plan = CpuFftPlan<float>;
+      return std::make_unique<CpuFftPlanRunner<Plan>>(std::make_unique<Plan>(size, batch, isa));
+    }});
+  }
+  cases.push_back({"cpu_huge", "cpu_huge_fft_plan.cpp", false, [=](int size, int) -> std::unique_ptr<BenchmarkRunner> {
+    using Plan = CpuHugeFftPlan<float>;
+    return std::make_unique<CpuHugeFftPlanRunner<Plan>>(std::make_unique<Plan>(size));
+  }});
+
+  std::vector<BenchmarkResult> results;
+  for(auto const & c : cases) {
+    if(c.name.find(options.filter) == std::string::npos &&
+       c.kernel.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    for(int sz = options.minSize; sz <= options.maxSize; sz *= 2) {
+      for(int batchCount : options.batchCounts) {
+        if(batchCount > 1 && !c.supportsBatches) {
+          continue;
+        }
+        std::cerr << c.name << " " << c.kernel << " size " << sz << " batch " << batchCount << ": ";
+        try {
+          auto runner = c.makeRunner(sz, batchCount);
+          results.push_back(runBenchmark(c, *runner, sz, batchCount, options.nIterations, nSkipIterations));
+        }
+        catch(std::runtime_error const & e) {
+          std::cerr << "skipped (" << e.what() << ")" << std::endl;
+          continue;
+        }
+        catch(const char * e) {
+          // an OpenCL error (see 'kill' in error_check.cpp), reported on stderr: the other configurations are still benchmarked.
+          std::cerr << "failed (" << e << ")" << std::endl;
+          continue;
+        }
+        std::cerr << results.back().kernelStats.median/1000. << " us" << std::endl;
+      }
+    }
+  }
+
+  std::ofstream file;
+  if(!options.output.empty()) {
+    file.open(options.output);
+    if(!file) {
+      std::cerr << "can't open " << options.output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream & os = options.output.empty() ? std::cout : file;
+  if(options.json) {
+    writeJson(os, deviceInfoString(device_id, CL_DEVICE_NAME), results);
+  }
+  else {
+    writeCsv(os, results);
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
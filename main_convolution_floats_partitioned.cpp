@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Convolves a signal with an impulse response (uniformly partitioned overlap-save convolution),
+// with every stage running on the device.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int block_size = 256;
+constexpr int impulse_response_size = 10000;
+constexpr int n_blocks = 100;
+
+// The reference: the direct convolution, computed on the cpu.
+std::vector<float> directConvolution(std::vector<float> const & signal, std::vector<float> const & impulseResponse) {
+  std::vector<float> res(signal.size());
+  for(size_t i=0; i<signal.size(); ++i) {
+    double acc = 0.;
+    for(size_t j=0; j<impulseResponse.size() && j<=i; ++j) {
+      acc += static_cast<double>(signal[i-j]) * impulseResponse[j];
+    }
+    res[i] = static_cast<float>(acc);
+  }
+  return res;
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  {
+    // A decaying impulse response
+    std::vector<float> impulseResponse;
+    impulseResponse.reserve(impulse_response_size);
+    for(int i=0; i<impulse_response_size; ++i) {
+      impulseResponse.push_back(rand_float(0.f,1.f) * std::exp(-4.f * i / impulse_response_size));
+    }
+
+    std::vector<float> signal;
+    signal.reserve(n_blocks * block_size);
+    for(int i=0; i<n_blocks * block_size; ++i) {
+      signal.push_back(rand_float(0.f,1.f));
+    }
+
+    GpuConvolution<float> convolution(context, device_id, command_queue, block_size, impulseResponse);
+    std::cout << "block size: " << block_size << ", " << convolution.getPartitionCount() << " partitions" << std::endl;
+
+    std::vector<float> input(block_size), output, result;
+    result.reserve(signal.size());
+
+    double elapsed = 0.;
+    for(int b=0; b<n_blocks; ++b) {
+      std::copy(signal.begin() + b * block_size, signal.begin() + (b+1) * block_size, input.begin());
+
+      auto const start = std::chrono::steady_clock::now();
+      convolution.process(input, output);
+      elapsed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+      result.insert(result.end(), output.begin(), output.end());
+    }
+    std::cout << "avg block duration, including transfers (us) : " << elapsed / n_blocks << std::endl;
+
+    std::cout << "verifying results... " << std::endl;
+    verifyVectorsAreEqual(result, directConvolution(signal, impulseResponse), 0.001f);
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of small ffts (one kernel launch per batch), as is done in partitioned convolution.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr auto algo = imajuscule::FftAlgo::Stockham;
+constexpr auto kernel_file = "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles.cl";
+
+//constexpr auto algo = imajuscule::FftAlgo::StockhamRadix4;
+//constexpr auto kernel_file = "vector_fft_floats_stockham_multi_local_coalesce_twiddles_radix.cl";
+
+//constexpr auto algo = imajuscule::FftAlgo::StockhamRegisters16;
+//constexpr auto kernel_file = "vector_fft_floats_stockham_registers_twiddles_radix.cl";
+
+constexpr int batch_count = 256;
+
+// Set this to a non-zero value to separate the input (resp. output) of consecutive ffts
+// of the batch by 'padding' unused elements.
+constexpr int padding = 0;
+
+bool withInput(imajuscule::GpuFftPlan<float> & plan,
+               std::vector<float> const & input,
+               bool verifyResults
+               )
+{
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  std::vector<std::complex<float>> output;
+
+  // Copy the input to the device.
+  // This can crash if the GPU has not enough memory.
+  plan.write(input);
+
+  auto const & batch = plan.getBatch();
+  std::cout << "run kernels using global size : " << plan.getGlobalSize() << " x " << batch.count << std::endl;
+
+  constexpr int nIterations = 1000;
+  constexpr int nSkipIterations = 5;
+  double const elapsed = averageKernelDuration(plan, nIterations, nSkipIterations);
+  std::cout << "avg kernel duration (us) : " << elapsed/1000. <<
+  ", per fft : " << elapsed/(1000. * batch.count) << std::endl;
+
+  // Read the output buffer on the device to the local variable output
+  plan.read(output);
+
+  if(verifyResults) {
+    std::cout << "verifying results... " << std::endl;
+    int const sz = plan.size();
+    for(int b=0; b<batch.count; ++b) {
+      std::vector<float> const fft_input(input.begin() + b * batch.inputStride,
+                                         input.begin() + b * batch.inputStride + sz);
+      std::vector<std::complex<float>> const fft_output(output.begin() + b * batch.outputStride,
+                                                        output.begin() + b * batch.outputStride + sz);
+      // The output produced by the gpu is the same as the output produced by the cpu:
+      verifyVectorsAreEqual(fft_output,
+                            makeRefForwardFft(fft_input),
+                            0.01f);
+    }
+  }
+
+  return true;
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  for(int sz=256; sz <= 4096; sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << ", batch of " << batch_count << std::endl;
+
+    if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+      std::cout << "not enough local memory on the device!" << std::endl;
+      break;
+    }
+
+    GpuFftBatch batch;
+    batch.count = batch_count;
+    batch.inputStride = sz + padding;
+    batch.outputStride = sz + padding;
+
+    GpuFftPlan<float> plan(context, device_id, command_queue, sz, algo, kernel_file, {}, batch);
+
+    // Create the input vector (the padding elements are also initialized, but they are not used)
+    std::vector<float> input;
+    input.reserve(plan.inputElements());
+    for(size_t i=0; i<plan.inputElements(); ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+
+    if(!withInput(plan,
+                  input,
+                  true // set this to true to verify results
+                  )) {
+      break;
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of ffts with the kernels generated for each size (see kernel_generator.cpp),
+// for every combination of the options of the generator, verifies the results
+// and compares the kernel durations.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int batch_count = 4;
+constexpr int nIterations = 100;
+constexpr int nSkipIterations = 5;
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  constexpr auto algo = FftAlgo::StockhamGenerated;
+
+  for(int sz=2; sz <= 8192; sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << ", batch of " << batch_count << std::endl;
+
+    if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+      std::cout << "not enough local memory on the device!" << std::endl;
+      break;
+    }
+
+    std::vector<float> input;
+    input.reserve(batch_count * sz);
+    for(int i=0; i<batch_count * sz; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+
+    for(auto const & generator : allGeneratedKernelOptions()) {
+      GpuFftConfig config;
+      config.generator = generator;
+      GpuFftBatch batch;
+      batch.count = batch_count;
+      std::unique_ptr<GpuFftPlan<float>> plan;
+      try {
+        plan = std::make_unique<GpuFftPlan<float>>(context, device_id, command_queue, sz, algo, std::string{}, config, batch);
+      }
+      catch(std::runtime_error const & e) {
+        std::cout << toString(generator) << ": " << e.what() << std::endl;
+        continue;
+      }
+
+      std::vector<std::complex<float>> output;
+      plan->execute(input, output);
+      for(int b=0; b<batch_count; ++b) {
+        verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + b * sz, output.begin() + (b+1) * sz),
+                              makeRefForwardFft(std::vector<float>(input.begin() + b * sz, input.begin() + (b+1) * sz)),
+                              0.01f);
+      }
+
+      double const duration = averageKernelDuration(*plan, nIterations, nSkipIterations);
+      std::cout << toString(generator) << ", " << plan->getButterfliesPerThread() << " butterflies per thread: "
+      << duration/1000. << " us" << std::endl;
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
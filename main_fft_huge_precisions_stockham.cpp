@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares the precisions of the ffts that don't fit in local memory (see precision.cpp and gpu_huge_fft_plan.cpp):
+// float, double, and half storage with float computations.
+//
+// The errors are measured against the cpu fft computed in double precision:
+// with floats, the error grows with the size of the fft (which is why the other examples
+// verify the float results with a tolerance of 0.01), double precision is needed
+// for long impulse responses.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T, typename S>
+void withPrecision(cl_context context,
+                   cl_device_id device_id,
+                   cl_command_queue command_queue,
+                   std::vector<double> const & input,
+                   std::vector<std::complex<double>> const & refForwardFft)
+{
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+  using Plan = GpuHugeFftPlan<T, S>;
+
+  std::cout << FftPrecision<T, S>::name() << ": ";
+
+  std::unique_ptr<Plan> plan;
+  try {
+    plan = std::make_unique<Plan>(context, device_id, command_queue, input.size());
+  }
+  catch(std::runtime_error const & e) {
+    std::cout << "skipped (" << e.what() << ")" << std::endl;
+    return;
+  }
+
+  std::vector<T> const plan_input(input.begin(), input.end());
+  plan->write(plan_input);
+
+  double elapsed = 0.;
+  int nIterations = 100;
+  constexpr int nSkipIterations = 1;
+  std::vector<cl_event> events;
+  for(int i=0; i<nSkipIterations+nIterations; ++i)
+  {
+    plan->enqueue(events);
+    cl_int ret = clWaitForEvents(1, &events.back());
+    CHECK_CL_ERROR(ret);
+
+    cl_ulong delta = 0;
+    for(auto e : events) {
+      delta += commandDuration(e);
+      ret = clReleaseEvent(e);
+      CHECK_CL_ERROR(ret);
+    }
+
+    // skip first measurements
+    if(i<nSkipIterations) {
+      continue;
+    }
+    elapsed += delta;
+
+    // stop if the test is too long
+    if(elapsed/1000000 > 1000) {
+      nIterations = 1+i-nSkipIterations;
+      break;
+    }
+  }
+
+  std::vector<std::complex<T>> output;
+  plan->read(output);
+
+  // The error relative to the biggest frequency bin
+  double maxError = 0., maxBin = 0.;
+  for(size_t i=0; i<output.size(); ++i) {
+    maxError = std::max(maxError, std::abs(std::complex<double>(output[i]) - refForwardFft[i]));
+    maxBin = std::max(maxBin, std::abs(refForwardFft[i]));
+  }
+  std::cout << "avg kernels duration (us) : " << (elapsed/(double)nIterations)/1000 <<
+  ", max error / max bin : " << maxError / maxBin << std::endl;
+
+  // The output produced by the gpu is the same as the output produced by the cpu, in the same precision:
+  verifyVectorsAreEqual(output,
+                        makeRefForwardFft(plan_input),
+                        FftPrecision<T, S>::tolerance(input.size()));
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  for(int sz=8192; sz <= (1 << 24); sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << std::endl;
+
+    // The inputs are scaled so that the biggest frequency bin (the first one)
+    // is less than the biggest half, 65504.
+    double const amplitude = std::min(1., 65536. / sz);
+    std::vector<double> input;
+    input.reserve(sz);
+    for(int i=0; i<sz; ++i) {
+      input.push_back(amplitude * rand_float(0.f,1.f));
+    }
+    auto const refForwardFft = makeRefForwardFft(input);
+
+    withPrecision<float, float>(context, device_id, command_queue, input, refForwardFft);
+    withPrecision<double, double>(context, device_id, command_queue, input, refForwardFft);
+    withPrecision<float, cl_half>(context, device_id, command_queue, input, refForwardFft);
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
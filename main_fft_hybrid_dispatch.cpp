@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of ffts on the cpu or on the gpu, depending on which one is the fastest
+// for their size and batch count, or on both (see fft_dispatcher.cpp).
+//
+// The durations are measured at the first run, and read from the tuning db at the next runs.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  std::vector<int> sizes;
+  for(int sz=16; sz <= (1 << 16); sz *= 4) {
+    sizes.push_back(sz);
+  }
+  std::vector<int> const batchCounts{1, 64};
+
+  FftDispatcher fastest(context, device_id, command_queue, FftDispatch::Fastest);
+  FftDispatcher split(context, device_id, command_queue, FftDispatch::Split);
+  fastest.calibrate(sizes, batchCounts);
+
+  for(int sz : sizes) {
+    for(int batchCount : batchCounts) {
+      auto const & d = fastest.durations(sz, batchCount);
+      std::cout << "size " << sz << " batch " << batchCount << ": cpu " << d.cpu/1000. << " us, gpu " << d.gpu/1000.
+      << " us -> " << toString(d.fastest()) << ", split: " << d.cpuShare(batchCount) << " fft(s) on the cpu" << std::endl;
+
+      std::vector<float> input;
+      input.reserve(sz * batchCount);
+      for(int i=0; i<sz * batchCount; ++i) {
+        input.push_back(rand_float(0.f,1.f));
+      }
+      for(auto * dispatcher : {&fastest, &split}) {
+        std::vector<std::complex<float>> output;
+        dispatcher->execute(sz, batchCount, input, output);
+
+        // The output is the same as the output produced by the cpu, for every fft of the batch:
+        for(int b=0; b<batchCount; ++b) {
+          std::vector<float> const in(input.begin() + b*sz, input.begin() + (b+1)*sz);
+          std::vector<std::complex<float>> const out(output.begin() + b*sz, output.begin() + (b+1)*sz);
+          verifyVectorsAreEqual(out, makeRefForwardFft(in), 0.01);
+        }
+      }
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of ffts with their inputs and outputs in buffers, then in images tiled across rows (see image_io.cpp),
+// out of place and in place, verifies the results and compares the kernel durations.
+//
+// When the device doesn't support images (or read_write images, for the in-place ffts), the plans use buffers.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int batch_count = 64;
+constexpr int nIterations = 100;
+constexpr int nSkipIterations = 5;
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  {
+    ImageIoSupport const support = imageIoSupport(device_id);
+    std::cout << "images: " << (support.images ? "yes" : "no");
+    if(support.images) {
+      std::cout << ", max " << support.maxWidth << " x " << support.maxHeight << " pixels"
+      << ", read_write images: " << (support.readWrite ? "yes" : "no");
+    }
+    std::cout << std::endl;
+  }
+
+  for(auto algo : {FftAlgo::Stockham, FftAlgo::StockhamRadix4}) {
+    std::cout << std::endl << "* kernel: " << defaultKernelFile(algo) << std::endl;
+
+    for(int sz=4; sz <= 8192; sz *= 2) {
+      if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+        std::cout << "not enough local memory on the device!" << std::endl;
+        break;
+      }
+      std::cout << "input size: " << sz << ", batch of " << batch_count << std::endl;
+
+      std::vector<float> input;
+      input.reserve(batch_count * sz);
+      for(int i=0; i<batch_count * sz; ++i) {
+        input.push_back(rand_float(0.f,1.f));
+      }
+
+      for(auto placement : {GpuFftPlacement::OutOfPlace, GpuFftPlacement::InPlace}) {
+        for(auto io : explicitIoStorages) {
+          GpuFftConfig config;
+          config.io = io;
+          GpuFftBatch batch;
+          batch.count = batch_count;
+          GpuFftPlan<float> plan(context, device_id, command_queue, sz, algo, std::string{}, config, batch,
+                                 GpuMemoryMode::Auto, placement);
+
+          // in place, the input of an fft is in the first half of the memory of its output.
+          std::vector<float> plan_input(plan.inputElements());
+          for(int b=0; b<batch_count; ++b) {
+            std::copy(input.begin() + b * sz, input.begin() + (b+1) * sz, plan_input.begin() + b * plan.getBatch().inputStride);
+          }
+          std::vector<std::complex<float>> output;
+          plan.execute(plan_input, output);
+          for(int b=0; b<batch_count; ++b) {
+            verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + b * sz, output.begin() + (b+1) * sz),
+                                  makeRefForwardFft(std::vector<float>(input.begin() + b * sz, input.begin() + (b+1) * sz)),
+                                  0.01f);
+          }
+
+          plan.write(plan_input);
+          double const duration = averageKernelDuration(plan, nIterations, nSkipIterations);
+          std::cout << ((placement == GpuFftPlacement::InPlace) ? "in place" : "out of place") << ", " << toString(io) << " requested, "
+          << toString(plan.getIoStorage()) << " used: " << duration/1000. << " us" << std::endl;
+        }
+      }
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares the in-place and out-of-place ffts: device memory footprint, and verification of the results,
+// for batches of ffts that fit in local memory, and for huge ffts (see gpu_huge_fft_plan.cpp).
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int batch_count = 64;
+
+const char * toString(imajuscule::GpuFftPlacement p) {
+  return (p == imajuscule::GpuFftPlacement::InPlace) ? "in-place" : "out-of-place";
+}
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  for(auto algo : {FftAlgo::Stockham, FftAlgo::StockhamRegisters16}) {
+    for(int sz=256; sz <= 8192; sz *= 2) {
+      std::cout << std::endl << "* " << defaultKernelFile(algo) << ", input size: " << sz << ", batch of " << batch_count << std::endl;
+
+      if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+        std::cout << "not enough local memory on the device!" << std::endl;
+        break;
+      }
+      std::cout << "local memory: " << GpuFftPlan<float>::localMemoryNeeds(sz, algo) << " bytes" << std::endl;
+
+      std::vector<std::vector<float>> inputs(batch_count);
+      for(auto & input : inputs) {
+        input.reserve(sz);
+        for(int i=0; i<sz; ++i) {
+          input.push_back(rand_float(0.f,1.f));
+        }
+      }
+
+      for(auto placement : {GpuFftPlacement::OutOfPlace, GpuFftPlacement::InPlace}) {
+        GpuFftBatch batch;
+        batch.count = batch_count;
+        std::unique_ptr<GpuFftPlan<float>> plan;
+        try {
+          plan = std::make_unique<GpuFftPlan<float>>(context, device_id, command_queue, sz, algo, std::string{}, GpuFftConfig{},
+                                                     batch, GpuMemoryMode::Auto, placement);
+        }
+        catch(std::runtime_error const & e) {
+          std::cout << toString(placement) << ": " << e.what() << std::endl;
+          continue;
+        }
+
+        // The inputs of the in-place ffts are separated by 'sz' unused elements.
+        int const inputStride = plan->getBatch().inputStride;
+        std::vector<float> input(plan->inputElements());
+        for(int b=0; b<batch_count; ++b) {
+          std::copy(inputs[b].begin(), inputs[b].end(), input.begin() + b * inputStride);
+        }
+        std::vector<std::complex<float>> output;
+        plan->execute(input, output);
+
+        std::cout << toString(placement) << ": " << plan->bufferBytes() << " bytes of buffers" << std::endl;
+
+        std::cout << "verifying results... " << std::endl;
+        for(int b=0; b<batch_count; ++b) {
+          verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + b * sz, output.begin() + (b+1) * sz),
+                                makeRefForwardFft(inputs[b]),
+                                0.01f);
+        }
+      }
+    }
+  }
+
+  for(int sz=1 << 16; sz <= (1 << 22); sz *= 4) {
+    std::cout << std::endl << "* huge fft, input size: " << sz << std::endl;
+
+    std::vector<float> input;
+    input.reserve(sz);
+    for(int i=0; i<sz; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+    // The reference is computed by the multi-threaded cpu fft (see cpu_huge_fft_plan.cpp).
+    std::vector<std::complex<float>> refForwardFft;
+    CpuHugeFftPlan<float>(sz).execute(input, refForwardFft);
+
+    for(auto placement : {GpuFftPlacement::OutOfPlace, GpuFftPlacement::InPlace}) {
+      GpuHugeFftPlan<float> plan(context, device_id, command_queue, sz, placement);
+      std::vector<std::complex<float>> output;
+      plan.execute(input, output);
+
+      std::cout << toString(placement) << ": " << plan.bufferBytes() << " bytes of buffers" << std::endl;
+
+      std::cout << "verifying results... " << std::endl;
+      verifyVectorsAreEqual(output,
+                            refForwardFft,
+                            0.01f);
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares the ffts computed on the cpu (no OpenCL device is used):
+// 'cpu_fft_norecursion_stockham', the scalar version of the stockham kernel,
+// and 'CpuFftPlan' (see cpu_fft_simd.cpp) for each instruction set supported by the cpu.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the average duration of 'f', in microseconds.
+template<typename F>
+double averageDuration(F && f) {
+  int nIterations = 100;
+  constexpr int nSkipIterations = 1;
+  double elapsed = 0.;
+  for(int i=0; i<nSkipIterations+nIterations; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    auto const end = std::chrono::steady_clock::now();
+
+    // skip first measurements
+    if(i<nSkipIterations) {
+      continue;
+    }
+    elapsed += std::chrono::duration<double, std::micro>(end - start).count();
+
+    // stop if the test is too long
+    if(elapsed/1000 > 1000) {
+      nIterations = 1+i-nSkipIterations;
+      break;
+    }
+  }
+  return elapsed / nIterations;
+}
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  std::cout << "best instruction set: " << toString(bestCpuIsa()) << std::endl;
+
+  for(int sz=16; sz <= (1 << 20); sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << std::endl;
+
+    std::vector<float> input;
+    input.reserve(sz);
+    for(int i=0; i<sz; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+    auto const refForwardFft = makeRefForwardFft(input);
+
+    {
+      std::vector<std::complex<float>> output;
+      auto const duration = averageDuration([&]() { output = cpu_fft_norecursion_stockham(input); });
+      std::cout << "stockham (scalar): " << duration << " us" << std::endl;
+      verifyVectorsAreEqual(output, refForwardFft, 0.01);
+    }
+
+    for(auto isa : {CpuIsa::Scalar, CpuIsa::Sse, CpuIsa::Neon, CpuIsa::Avx2, CpuIsa::Avx512}) {
+      if(!cpuSupports(isa)) {
+        continue;
+      }
+      CpuFftPlan<float> plan(sz, {}, isa);
+      plan.write(input);
+      auto const duration = averageDuration([&]() { plan.compute(); });
+      std::cout << "plan (" << toString(plan.getIsa()) << "): " << duration << " us" << std::endl;
+
+      std::vector<std::complex<float>> output;
+      plan.read(output);
+      verifyVectorsAreEqual(output, refForwardFft, 0.01);
+    }
+  }
+
+  return 0;
+}
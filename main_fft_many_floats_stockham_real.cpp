@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes the fft of real signals by packing the N reals as N/2 complex numbers,
+// and the matching inverse fft.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool withInput(imajuscule::GpuRealFftPlan<float> & plan,
+               std::vector<float> const & input,
+               bool verifyResults
+               )
+{
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  std::vector<std::complex<float>> spectrum;
+  std::vector<float> signal;
+
+  // Copy the input to the device.
+  // This can crash if the GPU has not enough memory.
+  plan.writeSignal(input);
+
+  std::cout << "run kernels using global size : " << plan.getGlobalSize() << std::endl;
+
+  constexpr int nIterations = 3000;
+  constexpr int nSkipIterations = 5;
+  double const elapsed = averageKernelDuration(plan, nIterations, nSkipIterations);
+  std::cout << "avg kernel duration (us) : " << (int)elapsed/1000 << std::endl;
+
+  plan.readSpectrum(spectrum);
+
+  if(verifyResults) {
+    std::cout << "verifying results... " << std::endl;
+    // The spectrum produced by the gpu is the first half of the spectrum produced by the cpu:
+    auto ref = makeRefForwardFft(input);
+    ref.resize(spectrum.size());
+    verifyVectorsAreEqual(spectrum, ref, 0.01f);
+  }
+
+  // The inverse fft is not normalized
+  plan.inverse(spectrum, signal);
+
+  if(verifyResults) {
+    std::cout << "verifying inverse... " << std::endl;
+    std::vector<float> scaled(signal.size());
+    std::transform(signal.begin(), signal.end(), scaled.begin(),
+                   [n = plan.size()](float v) { return v / n; });
+    verifyVectorsAreEqual(scaled, input, 0.001f);
+  }
+
+  return true;
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  for(int sz=4; sz < 10000000; sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << std::endl;
+
+    if(!GpuRealFftPlan<float>::fitsInLocalMemory(device_id, sz)) {
+      std::cout << "not enough local memory on the device!" << std::endl;
+      break;
+    }
+
+    // Create the input vector
+    std::vector<float> input;
+    input.reserve(sz);
+    for(int i=0; i<sz; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+
+    // Set this to true to autotune the kernel: the best configuration
+    // is stored in the tuning db, and used by the plan.
+    constexpr bool autotuneKernel = false;
+    if(autotuneKernel) {
+      autotuneRealFft<float>(context, device_id, command_queue, sz);
+    }
+
+    GpuRealFftPlan<float> plan(context, device_id, command_queue, sz);
+
+    if(!withInput(plan,
+                  input,
+                  true // set this to true to verify results
+                  )) {
+      break;
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compares the memory modes of the plan (see host_memory.cpp): transfers from pageable memory,
+// from pinned memory, and zero-copy buffers accessed with map / unmap.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr auto algo = imajuscule::FftAlgo::Stockham;
+constexpr auto kernel_file = "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles.cl";
+
+constexpr int n_blocks = 256;
+
+// Returns the duration in microseconds
+template<typename F>
+double measure(F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  std::cout << "the device " << (hasUnifiedMemory(device_id) ? "shares" : "doesn't share")
+            << " the memory with the host, the automatic mode is '"
+            << toString(resolveMemoryMode(device_id, GpuMemoryMode::Auto)) << "'" << std::endl;
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  for(int sz=256; sz <= 8192; sz *= 2) {
+    std::cout << std::endl << "* input size: " << sz << ", " << n_blocks << " blocks" << std::endl;
+
+    if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+      std::cout << "not enough local memory on the device!" << std::endl;
+      break;
+    }
+
+    std::vector<std::vector<float>> inputs(n_blocks);
+    for(auto & input : inputs) {
+      input.reserve(sz);
+      for(int i=0; i<sz; ++i) {
+        input.push_back(rand_float(0.f,1.f));
+      }
+    }
+    std::vector<std::vector<std::complex<float>>> outputs(n_blocks);
+
+    for(auto mode : {GpuMemoryMode::Copy, GpuMemoryMode::Pinned, GpuMemoryMode::ZeroCopy}) {
+      GpuFftPlan<float> plan(context, device_id, command_queue, sz, algo, kernel_file, {}, {}, mode);
+
+      // 'write' / 'read' copy between the vectors and the memory used by the mode.
+      double const elapsed = measure([&]() {
+        for(int b=0; b<n_blocks; ++b) {
+          plan.execute(inputs[b], outputs[b]);
+        }
+      });
+
+      // The input is produced directly in the mapped memory, and the result is consumed from it.
+      double const elapsed_mapped = measure([&]() {
+        for(int b=0; b<n_blocks; ++b) {
+          std::copy(inputs[b].begin(), inputs[b].end(), plan.mapInput());
+          plan.unmapInput();
+          cl_event event = plan.enqueue();
+          ret = clReleaseEvent(event);
+          CHECK_CL_ERROR(ret);
+          auto const * res = plan.mapOutput();
+          verifyVectorsAreEqual(std::vector<std::complex<float>>(res, res + plan.outputElements()),
+                                outputs[b],
+                                0.0001f);
+          plan.unmapOutput();
+        }
+      });
+
+      std::cout << toString(plan.getMemoryMode()) << ": "
+                << elapsed / n_blocks << " us per block, "
+                << elapsed_mapped / n_blocks << " us per block with map / unmap (including the verification)" << std::endl;
+
+      std::cout << "verifying results... " << std::endl;
+      for(int b=0; b<n_blocks; ++b) {
+        verifyVectorsAreEqual(outputs[b],
+                              makeRefForwardFft(inputs[b]),
+                              0.01f);
+      }
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Creates and destroys plans of several sizes, with and without a device memory pool (see device_memory_pool.cpp):
+// compares the durations of the allocations of the device buffers, reports the usage of the pool
+// when plans of different sizes share it, and the batch count that fits in the memory it can still hand out.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int nIterations = 100;
+constexpr int batch_count = 16;
+
+template<typename F>
+double averageDuration(F f) {
+  auto const start = std::chrono::steady_clock::now();
+  for(int i=0; i<nIterations; ++i) {
+    f();
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / nIterations;
+}
+
+void printBytes(std::string const & name, size_t bytes) {
+  std::cout << name << ": " << bytes / 1024. << " KB" << std::endl;
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  constexpr auto algo = FftAlgo::Stockham;
+
+  {
+    DeviceMemoryPool pool(context, device_id);
+    std::cout << "alignment of the sub-buffers: " << pool.alignment() << " bytes" << std::endl;
+
+    std::cout << std::endl << "* allocation + release of a device buffer:" << std::endl;
+    for(size_t bytes = 1024; bytes <= (16 << 20); bytes *= 16) {
+      double const created = averageDuration([&]() {
+        cl_int ret;
+        cl_mem mem = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &ret);
+        CHECK_CL_ERROR(ret);
+        ret = clReleaseMemObject(mem);
+        CHECK_CL_ERROR(ret);
+      });
+      // the first allocation of the pool allocates a chunk
+      pool.release(pool.allocate(bytes));
+      double const pooled = averageDuration([&]() {
+        pool.release(pool.allocate(bytes));
+      });
+      std::cout << bytes / 1024 << " KB: clCreateBuffer " << created << " us, pool " << pooled << " us" << std::endl;
+    }
+
+    std::cout << std::endl << "* plans of different sizes sharing the pool:" << std::endl;
+    std::vector<std::unique_ptr<GpuFftPlan<float>>> plans;
+    for(int sz=16; sz <= 4096; sz *= 4) {
+      if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, algo)) {
+        break;
+      }
+      GpuFftBatch batch;
+      batch.count = batch_count;
+      plans.push_back(std::make_unique<GpuFftPlan<float>>(context, device_id, command_queue, sz, algo, std::string{},
+                                                          GpuFftConfig{}, batch, GpuMemoryMode::Auto,
+                                                          GpuFftPlacement::OutOfPlace, &pool));
+    }
+    for(auto & plan : plans) {
+      int const sz = plan->size();
+      std::vector<float> input;
+      input.reserve(batch_count * sz);
+      for(int i=0; i<batch_count * sz; ++i) {
+        input.push_back(rand_float(0.f,1.f));
+      }
+      std::vector<std::complex<float>> output;
+      plan->execute(input, output);
+      for(int b=0; b<batch_count; ++b) {
+        verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + b * sz, output.begin() + (b+1) * sz),
+                              makeRefForwardFft(std::vector<float>(input.begin() + b * sz, input.begin() + (b+1) * sz)),
+                              0.01f);
+      }
+      std::cout << "size " << sz << ": " << plan->bufferBytes() / 1024. << " KB" << std::endl;
+    }
+    printBytes("used", pool.usedBytes());
+    printBytes("reserved", pool.reservedBytes());
+    std::cout << "chunks: " << pool.countChunks() << std::endl;
+
+    // the slices of the destroyed plans are reused by the next plans
+    plans.erase(plans.begin(), plans.begin() + plans.size() / 2);
+    printBytes("used after destroying half of the plans", pool.usedBytes());
+    {
+      int const sz = 1024;
+      GpuFftBatch batch;
+      batch.count = batch_count;
+      GpuFftPlan<float> plan(context, device_id, command_queue, sz, algo, std::string{},
+                             GpuFftConfig{}, batch, GpuMemoryMode::Auto, GpuFftPlacement::OutOfPlace, &pool);
+      printBytes("used with a new plan", pool.usedBytes());
+      std::cout << "chunks: " << pool.countChunks() << std::endl;
+
+      // the batch count that fits in the memory that the pool can still hand out
+      size_t const bytesPerFft = plan.bufferBytes() / batch_count;
+      std::cout << "max batch count of size " << sz << ": " << pool.availableBytes() / bytesPerFft << std::endl;
+    }
+    plans.clear();
+    printBytes("peak", pool.peakBytes());
+    pool.trim();
+    printBytes("reserved after trim", pool.reservedBytes());
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
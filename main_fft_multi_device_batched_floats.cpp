@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of ffts on all the gpus of all the platforms (see gpu_multi_device_fft_plan.cpp),
+// and compares the throughput with the throughput of the fastest device alone.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+using T = float;
+
+// Returns the average duration of 'plan.execute', in microseconds.
+template<typename Plan>
+double averageDuration(Plan & plan, std::vector<T> const & input, std::vector<std::complex<T>> & output) {
+  int nIterations = 100;
+  constexpr int nSkipIterations = 1;
+  double elapsed = 0.;
+  for(int i=0; i<nSkipIterations+nIterations; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    plan.execute(input, output);
+    auto const end = std::chrono::steady_clock::now();
+
+    // skip first measurements
+    if(i<nSkipIterations) {
+      continue;
+    }
+    elapsed += std::chrono::duration<double, std::micro>(end - start).count();
+
+    // stop if the test is too long
+    if(elapsed/1000 > 1000) {
+      nIterations = 1+i-nSkipIterations;
+      break;
+    }
+  }
+  return elapsed / nIterations;
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  auto devices = enumerateDevices(CL_DEVICE_TYPE_GPU);
+  if(devices.empty()) {
+    devices = enumerateDevices(CL_DEVICE_TYPE_ALL);
+  }
+  std::vector<GpuDevice *> all;
+  for(auto const & d : devices) {
+    std::cout << "device " << all.size() << ": " << d->name() << std::endl;
+    all.push_back(d.get());
+  }
+
+  constexpr int batchCount = 256;
+  for(int sz=16; sz <= 4096; sz *= 4) {
+    std::cout << std::endl << "* input size: " << sz << ", batch: " << batchCount << std::endl;
+
+    std::vector<T> input;
+    input.reserve(sz * batchCount);
+    for(int i=0; i<sz * batchCount; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+
+    MultiDeviceFftPlan<T> plan(all, sz, batchCount);
+    for(auto const & s : plan.getShards()) {
+      std::cout << s.device->name() << ": " << s.count << " ffts (" << s.throughput << " ffts / s alone)" << std::endl;
+    }
+    std::vector<std::complex<T>> output;
+    double const duration = averageDuration(plan, input, output);
+    std::cout << "all devices: " << batchCount / (duration * 1e-6) << " ffts / s" << std::endl;
+
+    // The output is the same as the output produced by the cpu, for every fft of the batch:
+    for(int b=0; b<batchCount; ++b) {
+      std::vector<T> const in(input.begin() + b*sz, input.begin() + (b+1)*sz);
+      std::vector<std::complex<T>> const out(output.begin() + b*sz, output.begin() + (b+1)*sz);
+      verifyVectorsAreEqual(out, makeRefForwardFft(in), 0.01);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes the short-time Fourier transform of a signal (Hann window, 75% overlap):
+// - with the framing and the windowing on the host, and a batch of ffts of the frames,
+// - with a 'GpuStftPlan', where the kernel reads the overlapping frames from the signal and applies the window,
+// verifies the results (and the magnitude and power outputs), and compares the durations and the uploaded sizes.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int signal_size = 1 << 16;
+constexpr int overlap_factor = 4; // the hop is a quarter of the frame size
+constexpr int nIterations = 20;
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  std::vector<float> signal;
+  signal.reserve(signal_size);
+  for(int i=0; i<signal_size; ++i) {
+    signal.push_back(rand_float(-1.f,1.f));
+  }
+
+  for(int sz=256; sz <= 4096; sz *= 2) {
+    if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, sz, FftAlgo::Stockham)) {
+      std::cout << "not enough local memory on the device!" << std::endl;
+      break;
+    }
+    int const hop = sz / overlap_factor;
+    int const nFrames = GpuStftPlan<float>::countFrames(signal.size(), sz, hop);
+    std::vector<float> const window = hannWindow<float>(sz);
+    std::cout << std::endl << "frame size: " << sz << ", hop: " << hop << ", " << nFrames << " frames" << std::endl;
+
+    std::vector<std::vector<std::complex<float>>> refs;
+    for(int f=0; f<nFrames; ++f) {
+      std::vector<float> frame(signal.begin() + f * hop, signal.begin() + f * hop + sz);
+      for(int i=0; i<sz; ++i) {
+        frame[i] *= window[i];
+      }
+      refs.push_back(makeRefForwardFft(frame));
+    }
+
+    // framing and windowing on the host
+    {
+      GpuFftBatch batch;
+      batch.count = nFrames;
+      GpuFftPlan<float> plan(context, device_id, command_queue, sz, FftAlgo::Stockham, std::string{}, {}, batch);
+      std::vector<float> frames(plan.inputElements());
+      std::vector<std::complex<float>> output;
+      double elapsed = 0.;
+      for(int it=0; it<nIterations; ++it) {
+        auto const start = std::chrono::steady_clock::now();
+        for(int f=0; f<nFrames; ++f) {
+          for(int i=0; i<sz; ++i) {
+            frames[f * sz + i] = signal[f * hop + i] * window[i];
+          }
+        }
+        plan.execute(frames, output);
+        elapsed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+      }
+      for(int f=0; f<nFrames; ++f) {
+        verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + f * sz, output.begin() + (f+1) * sz),
+                              refs[f],
+                              0.01f);
+      }
+      std::cout << "host framing: upload of " << plan.inputElements() * sizeof(float) << " bytes, "
+      << averageKernelDuration(plan, nIterations, 0)/1000. << " us per kernel, "
+      << elapsed / nIterations << " us per stft" << std::endl;
+    }
+
+    // framing and windowing in the kernel
+    for(auto output : {SpectrumOutput::Complex, SpectrumOutput::Magnitude, SpectrumOutput::Power}) {
+      GpuStftPlan<float> stft(context, device_id, command_queue, sz, hop, nFrames, window, output);
+      std::vector<float> const stft_signal(signal.begin(), signal.begin() + stft.signalElements());
+      std::vector<std::complex<float>> spectrogram;
+      std::vector<float> values;
+      double elapsed = 0.;
+      for(int it=0; it<nIterations; ++it) {
+        auto const start = std::chrono::steady_clock::now();
+        if(output == SpectrumOutput::Complex) {
+          stft.execute(stft_signal, spectrogram);
+        }
+        else {
+          stft.execute(stft_signal, values);
+        }
+        elapsed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+      }
+      for(int f=0; f<nFrames; ++f) {
+        if(output == SpectrumOutput::Complex) {
+          verifyVectorsAreEqual(std::vector<std::complex<float>>(spectrogram.begin() + f * sz, spectrogram.begin() + (f+1) * sz),
+                                refs[f],
+                                0.01f);
+          continue;
+        }
+        std::vector<float> ref_values;
+        for(auto const & c : refs[f]) {
+          ref_values.push_back((output == SpectrumOutput::Magnitude) ? std::abs(c) : std::norm(c));
+        }
+        verifyVectorsAreEqual(std::vector<float>(values.begin() + f * sz, values.begin() + (f+1) * sz),
+                              ref_values,
+                              (output == SpectrumOutput::Magnitude) ? 0.01f : 0.1f);
+      }
+      std::cout << "fused framing, " << toString(output) << " output: upload of " << stft.signalElements() * sizeof(float) << " bytes, "
+      << averageKernelDuration(stft.getPlan(), nIterations, 0)/1000. << " us per kernel, "
+      << elapsed / nIterations << " us per stft" << std::endl;
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
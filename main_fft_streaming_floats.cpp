@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Streams blocks of audio samples through the gpu, at the pace of an audio callback (see gpu_streaming.cpp):
+// for each block size, the spectrums of a sliding window and a partitioned convolution are computed,
+// and the histogram of the latencies and the missed deadlines are reported.
+//
+// The output of a block is popped in the callback of the block (1 block in flight),
+// or in the next callback (2 blocks in flight, i.e. one more block of latency).
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+
+constexpr double sample_rate = 48000.;
+constexpr int frame_size = 1024;
+constexpr int impulse_response_size = 4096;
+constexpr int n_blocks = 3000;
+constexpr int n_warmup_blocks = 100;
+// the outputs of the first blocks are verified
+constexpr int n_verified_blocks = 32;
+
+// The reference: the direct convolution of the first 'n' samples, computed on the cpu.
+std::vector<float> directConvolution(std::vector<float> const & signal, std::vector<float> const & impulseResponse, size_t n) {
+  std::vector<float> res(n);
+  for(size_t i=0; i<n; ++i) {
+    double acc = 0.;
+    for(size_t j=0; j<impulseResponse.size() && j<=i; ++j) {
+      acc += static_cast<double>(signal[i-j]) * impulseResponse[j];
+    }
+    res[i] = static_cast<float>(acc);
+  }
+  return res;
+}
+
+// Pushes the blocks of 'signal' at the pace of the sample rate, and calls 'f(b, output)'
+// with the output of each block 'b'.
+template<typename Stream, typename F>
+void stream(Stream & s, std::vector<float> const & signal, F f) {
+  int const blockSize = s.blockSize();
+  auto const blockDuration = std::chrono::nanoseconds(static_cast<long long>(1e9 * blockSize / sample_rate));
+  std::vector<float> block(blockSize);
+  std::vector<typename Stream::OutputElement> output;
+  int popped = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for(int b=0; b<n_blocks; ++b) {
+    // the audio callback of block 'b'
+    std::this_thread::sleep_until(start + b * blockDuration);
+    std::copy(signal.begin() + b * blockSize, signal.begin() + (b+1) * blockSize, block.begin());
+    s.push(block);
+    if(s.full()) {
+      s.pop(output);
+      f(popped++, output);
+    }
+    if(popped == n_warmup_blocks) {
+      s.resetStatistics();
+    }
+  }
+  while(s.countInFlight()) {
+    s.pop(output);
+    f(popped++, output);
+  }
+}
+
+int main(void) {
+  using namespace imajuscule;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // A decaying impulse response
+  std::vector<float> impulseResponse;
+  impulseResponse.reserve(impulse_response_size);
+  for(int i=0; i<impulse_response_size; ++i) {
+    impulseResponse.push_back(rand_float(0.f,1.f) * std::exp(-4.f * i / impulse_response_size));
+  }
+
+  for(int block_size : {64, 128, 256}) {
+    std::vector<float> signal;
+    signal.reserve(n_blocks * block_size);
+    for(int i=0; i<n_blocks * block_size; ++i) {
+      signal.push_back(rand_float(0.f,1.f));
+    }
+    std::vector<float> const refConvolution = directConvolution(signal, impulseResponse, n_verified_blocks * block_size);
+
+    for(int nInFlight : {1, 2}) {
+      GpuStreamConfig config;
+      config.nInFlight = nInFlight;
+      config.sampleRate = sample_rate;
+
+      std::cout << std::endl << "* block size: " << block_size << ", " << nInFlight << " block(s) in flight" << std::endl;
+      {
+        GpuStreamingFft<float> s(context, device_id, command_queue, block_size, config, frame_size);
+        stream(s, signal, [&](int b, std::vector<std::complex<float>> const & spectrum) {
+          if(b >= n_verified_blocks) {
+            return;
+          }
+          // the frame ending with block 'b', with zeros before the first block
+          std::vector<float> frame(frame_size, 0.f);
+          int const end = (b+1) * block_size;
+          for(int i=std::max(0, end - frame_size); i<end; ++i) {
+            frame[i - (end - frame_size)] = signal[i];
+          }
+          verifyVectorsAreEqual(spectrum, makeRefForwardFft(frame), 0.01f);
+        });
+        std::cout << "spectrums of " << frame_size << " samples: ";
+        s.report(std::cout);
+      }
+      {
+        GpuStreamingConvolution<float> s(context, device_id, command_queue, block_size, config, impulseResponse);
+        stream(s, signal, [&](int b, std::vector<float> const & output) {
+          if(b >= n_verified_blocks) {
+            return;
+          }
+          verifyVectorsAreEqual(output,
+                                std::vector<float>(refConvolution.begin() + b * block_size, refConvolution.begin() + (b+1) * block_size),
+                                0.001f);
+        });
+        std::cout << "convolution with " << impulse_response_size << " samples: ";
+        s.report(std::cout);
+      }
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
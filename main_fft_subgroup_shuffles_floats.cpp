@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Computes batches of small ffts with the Cooley-Tukey kernel, with the first stages in local memory,
+// then with sub-group shuffles (see subgroups.cpp), verifies the results and compares the kernel durations.
+//
+// When the device doesn't support sub-group shuffles, the plans use local memory for every stage.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr int batch_count = 256;
+constexpr int nIterations = 100;
+constexpr int nSkipIterations = 5;
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  std::cout << "sub-group shuffles: " << toString(subgroupExtension(device_id)) << std::endl;
+
+  for(auto algo : {FftAlgo::CooleyTukey, FftAlgo::CooleyTukeyNaturalOrder}) {
+    std::cout << std::endl << "* kernel: " << defaultKernelFile(algo)
+    << ((algo == FftAlgo::CooleyTukeyNaturalOrder) ? " (natural order input)" : " (bit-reversed input)") << std::endl;
+
+    for(int sz=4; sz <= 1024; sz *= 2) {
+      std::cout << "input size: " << sz << ", batch of " << batch_count << std::endl;
+
+      std::vector<float> input;
+      input.reserve(batch_count * sz);
+      for(int i=0; i<batch_count * sz; ++i) {
+        input.push_back(rand_float(0.f,1.f));
+      }
+
+      // 1 butterfly per thread has the most stages between the work items, hence the most barriers.
+      for(int nButterfliesPerThread = 1; nButterfliesPerThread <= std::min(4, sz/2); nButterfliesPerThread *= 2) {
+        for(auto shuffles : explicitSubgroupShuffles) {
+          GpuFftConfig config;
+          config.nButterfliesPerThread = nButterfliesPerThread;
+          config.shuffles = shuffles;
+          GpuFftBatch batch;
+          batch.count = batch_count;
+          std::unique_ptr<GpuFftPlan<float>> plan;
+          try {
+            plan = std::make_unique<GpuFftPlan<float>>(context, device_id, command_queue, sz, algo, std::string{}, config, batch);
+          }
+          catch(std::runtime_error const & e) {
+            std::cout << nButterfliesPerThread << " butterflies per thread: " << e.what() << std::endl;
+            continue;
+          }
+
+          std::vector<std::complex<float>> output;
+          plan->execute(input, output);
+          for(int b=0; b<batch_count; ++b) {
+            std::vector<float> const in(input.begin() + b * sz, input.begin() + (b+1) * sz);
+            // When the kernel expects a bit-reversed input, it computes the Cooley-Tukey fft of the bit-reversed input.
+            verifyVectorsAreEqual(std::vector<std::complex<float>>(output.begin() + b * sz, output.begin() + (b+1) * sz),
+                                  expectsBitReversedInput(algo) ? cpu_fft_norecursion(in) : makeRefForwardFft(in),
+                                  0.01f);
+          }
+
+          double const duration = averageKernelDuration(*plan, nIterations, nSkipIterations);
+          std::cout << nButterfliesPerThread << " butterflies per thread, " << toString(shuffles) << " shuffles requested, "
+          << toString(plan->getSubgroupShuffles()) << " used: " << duration/1000. << " us" << std::endl;
+        }
+      }
+    }
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Traces the OpenCL commands (see cl_trace.cpp) of a stream of ffts computed sequentially (blocking transfers)
+// and with a pipeline (see gpu_fft_pipeline.cpp), and of small ffts launched one by one:
+// prints the per-stage summary (is it compute-bound, transfer-bound or launch-bound? do the transfers
+// overlap the kernels?), and writes the traces, to be opened in chrome://tracing or https://ui.perfetto.dev.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr auto algo = imajuscule::FftAlgo::Stockham;
+constexpr auto kernel_file = "vector_fft_floats_stockham_multi_local_coalesce_shift_twiddles.cl";
+
+constexpr int size = 2048;
+constexpr int small_size = 16;
+constexpr int n_blocks = 64;
+constexpr int n_in_flight = 3;
+
+// Traces the commands enqueued by 'f', prints the summary and writes the trace.
+template<typename F>
+void trace(std::string const & name, F f) {
+  using namespace imajuscule;
+  auto & t = ClTrace::getInstance();
+  t.clear();
+  t.enable(true);
+  {
+    ClTraceStage stage(name);
+    f();
+  }
+  t.enable(false);
+  std::string const file = "trace_" + name + ".json";
+  std::cout << std::endl << "* " << name << " (" << file << ")" << std::endl;
+  t.summary(std::cout);
+  t.writeChromeTrace(file);
+}
+
+int main(void) {
+  using namespace imajuscule;
+  using namespace imajuscule::fft;
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  if(!GpuFftPlan<float>::fitsInLocalMemory(device_id, size, algo)) {
+    std::cout << "not enough local memory on the device!" << std::endl;
+    return 0;
+  }
+
+  std::vector<std::vector<float>> inputs(n_blocks);
+  for(auto & input : inputs) {
+    input.reserve(size);
+    for(int i=0; i<size; ++i) {
+      input.push_back(rand_float(0.f,1.f));
+    }
+  }
+  std::vector<std::vector<std::complex<float>>> outputs(n_blocks);
+
+  {
+    GpuFftPlan<float> plan(context, device_id, command_queue, size, algo, kernel_file);
+    trace("sequential", [&]() {
+      for(int b=0; b<n_blocks; ++b) {
+        plan.execute(inputs[b], outputs[b]);
+      }
+    });
+  }
+  {
+    GpuFftPipeline<float> pipeline(context, device_id, size, algo, kernel_file, {}, n_in_flight);
+    trace("pipelined", [&]() {
+      for(int b=0; b<n_blocks; ++b) {
+        pipeline.submit(inputs[b], outputs[b]);
+      }
+      pipeline.finish();
+    });
+  }
+  std::cout << "verifying results... " << std::endl;
+  for(int b=0; b<n_blocks; ++b) {
+    verifyVectorsAreEqual(outputs[b], makeRefForwardFft(inputs[b]), 0.01f);
+  }
+
+  {
+    GpuFftPlan<float> plan(context, device_id, command_queue, small_size, algo, kernel_file);
+    std::vector<float> input(inputs[0].begin(), inputs[0].begin() + small_size);
+    std::vector<std::complex<float>> output;
+    trace("small", [&]() {
+      for(int b=0; b<n_blocks; ++b) {
+        plan.execute(input, output);
+      }
+    });
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
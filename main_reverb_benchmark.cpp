@@ -0,0 +1,226 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks a convolution reverb (uniformly partitioned overlap-save convolution) on the gpu and on the cpu
+// (see reverb_benchmark.cpp), for a range of impulse response lengths, block sizes and channel counts,
+// and writes the real-time factors, the cpu usages and the latencies as CSV or JSON:
+//
+// gpgpu_reverb_bench [--format csv|json] [--output file] [--filter substring]
+//                    [--ir-sizes 24000,96000] [--block-sizes 64,128,256,512] [--channels 2]
+//                    [--sample-rate 48000] [--seconds 5] [--paced on|off]
+//
+// The impulse response sizes are in samples, the block sizes are powers of 2, '--seconds' is the duration of the stream,
+// and '--paced on' processes the blocks at the sample rate instead of as fast as possible.
+// The filter selects the backends whose name contains the substring.
+// The progress and the skipped configurations (not supported by the device) are written to stderr.
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "common_includes.cpp"
+#include "reverb_benchmark.cpp"
+
+struct Options {
+  bool json = false;
+  std::string output, filter;
+  std::vector<int> irSizes{24000, 96000};
+  std::vector<int> blockSizes{64, 128, 256, 512};
+  std::vector<int> channelCounts{2};
+  double sampleRate = 48000.;
+  double seconds = 5.;
+  bool paced = false;
+};
+
+// Parses a comma separated list of positive integers.
+bool parseList(std::string const & value, std::vector<int> & list) {
+  list.clear();
+  std::istringstream is(value);
+  for(std::string v; std::getline(is, v, ',');) {
+    list.push_back(std::stoi(v));
+    if(list.back() < 1) {
+      return false;
+    }
+  }
+  return !list.empty();
+}
+
+bool parseOptions(int argc, char * argv[], Options & o) {
+  for(int i=1; i<argc; ++i) {
+    std::string const arg = argv[i];
+    if(i+1 >= argc) {
+      return false;
+    }
+    std::string const value = argv[++i];
+    if(arg == "--format" && (value == "csv" || value == "json")) {
+      o.json = (value == "json");
+    }
+    else if(arg == "--output") {
+      o.output = value;
+    }
+    else if(arg == "--filter") {
+      o.filter = value;
+    }
+    else if(arg == "--ir-sizes") {
+      if(!parseList(value, o.irSizes)) {
+        return false;
+      }
+    }
+    else if(arg == "--block-sizes") {
+      if(!parseList(value, o.blockSizes)) {
+        return false;
+      }
+      for(int b : o.blockSizes) {
+        if(!imajuscule::is_power_of_two(b) || b < 4) {
+          return false;
+        }
+      }
+    }
+    else if(arg == "--channels") {
+      if(!parseList(value, o.channelCounts)) {
+        return false;
+      }
+    }
+    else if(arg == "--sample-rate") {
+      o.sampleRate = std::stod(value);
+      if(o.sampleRate <= 0.) {
+        return false;
+      }
+    }
+    else if(arg == "--seconds") {
+      o.seconds = std::stod(value);
+      if(o.seconds <= 0.) {
+        return false;
+      }
+    }
+    else if(arg == "--paced" && (value == "on" || value == "off")) {
+      o.paced = (value == "on");
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr int nSkipBlocks = 10;
+
+int main(int argc, char * argv[]) {
+  using namespace imajuscule;
+
+  Options options;
+  if(!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0] << " [--format csv|json] [--output file] [--filter substring]" << std::endl
+    << "       [--ir-sizes 24000,96000] [--block-sizes 64,128,256,512] [--channels 2]" << std::endl
+    << "       [--sample-rate 48000] [--seconds 5] [--paced on|off]" << std::endl;
+    return 1;
+  }
+
+  srand(0); // we use rand() as random number generator and we want reproducible results so we use a fixed seeed.
+
+  // Get platform and device information
+  cl_platform_id platform_id = NULL;
+  cl_device_id device_id = NULL;
+  cl_uint ret_num_devices;
+  cl_uint ret_num_platforms;
+  cl_int ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
+  CHECK_CL_ERROR(ret);
+  ret = clGetDeviceIDs( platform_id, CL_DEVICE_TYPE_DEFAULT, 1,
+                       &device_id, &ret_num_devices);
+  CHECK_CL_ERROR(ret);
+
+  // Create an OpenCL context
+  cl_context context = clCreateContext( NULL, 1, &device_id, NULL, NULL, &ret);
+  CHECK_CL_ERROR(ret);
+
+  // Create a command queue
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id,
+                                                        CL_QUEUE_PROFILING_ENABLE, &ret);
+  CHECK_CL_ERROR(ret);
+
+  using ImpulseResponses = std::vector<std::vector<float>>;
+  std::vector<ReverbCase> cases;
+  cases.push_back({"gpu", [=](int blockSize, ImpulseResponses const & irs) -> std::unique_ptr<ReverbRunner> {
+    return std::make_unique<GpuReverbRunner<GpuRealFftPlan<float>>>(context, device_id, command_queue, blockSize, irs);
+  }});
+#ifdef GPGPU_CLFFT
+  cases.push_back({"clfft", [=](int blockSize, ImpulseResponses const & irs) -> std::unique_ptr<ReverbRunner> {
+    return std::make_unique<GpuReverbRunner<ClFftRealPlan<float>>>(context, device_id, command_queue, blockSize, irs);
+  }});
+#else
+  std::cerr << "clfft: skipped (clFFT was not found by CMakeLists.txt)" << std::endl;
+#endif
+  cases.push_back({"cpu_imj", [=](int blockSize, ImpulseResponses const & irs) -> std::unique_ptr<ReverbRunner> {
+    return std::make_unique<CpuReverbRunner<ImjRealFft>>(blockSize, irs);
+  }});
+  // For each instruction set supported by the cpu (see cpu_fft_simd.cpp)
+  for(auto isa : {CpuIsa::Scalar, CpuIsa::Sse, CpuIsa::Neon, CpuIsa::Avx2, CpuIsa::Avx512}) {
+    if(!cpuSupports(isa)) {
+      continue;
+    }
+    cases.push_back({std::string("cpu_") + toString(isa), [=](int blockSize, ImpulseResponses const & irs) -> std::unique_ptr<ReverbRunner> {
+      return std::make_unique<CpuReverbRunner<SimdRealFft>>(blockSize, irs, isa);
+    }});
+  }
+
+  std::vector<ReverbResult> results;
+  for(int irSize : options.irSizes) {
+    for(int blockSize : options.blockSizes) {
+      for(int nChannels : options.channelCounts) {
+        ReverbWorkload w{irSize, blockSize, nChannels, options.sampleRate, 0, options.paced};
+        w.nBlocks = nSkipBlocks + std::max(1, static_cast<int>(options.seconds * options.sampleRate / blockSize));
+
+        // The same signals and impulse responses for all backends
+        ImpulseResponses const irs = makeImpulseResponses(w);
+        std::vector<float> const signals = makeSignals(w);
+
+        for(auto const & c : cases) {
+          if(c.name.find(options.filter) == std::string::npos) {
+            continue;
+          }
+          std::cerr << c.name << " ir " << irSize << " block " << blockSize << " channels " << nChannels << ": ";
+          try {
+            auto runner = c.makeRunner(blockSize, irs);
+            results.push_back(runReverbBenchmark(c, *runner, w, signals, irs, nSkipBlocks));
+          }
+          catch(std::runtime_error const & e) {
+            std::cerr << "skipped (" << e.what() << ")" << std::endl;
+            continue;
+          }
+          catch(const char * e) {
+            // an OpenCL (or clFFT) error, or wrong results (see 'kill' in error_check.cpp):
+            // the other backends are still benchmarked.
+            std::cerr << "failed (" << e << ")" << std::endl;
+            continue;
+          }
+          auto const & r = results.back();
+          std::cerr << "real-time factor " << r.realTimeFactor << ", cpu " << r.cpuPercent << "%, latency p99 "
+          << r.latencies.percentile(99.)/1000. << " us" << std::endl;
+        }
+      }
+    }
+  }
+
+  std::ofstream file;
+  if(!options.output.empty()) {
+    file.open(options.output);
+    if(!file) {
+      std::cerr << "can't open " << options.output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream & os = options.output.empty() ? std::cout : file;
+  if(options.json) {
+    writeReverbJson(os, deviceInfoString(device_id, CL_DEVICE_NAME), results);
+  }
+  else {
+    writeReverbCsv(os, results);
+  }
+
+  // Clean up
+  ret = clFlush(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clFinish(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CHECK_CL_ERROR(ret);
+  ret = clReleaseContext(context);
+  CHECK_CL_ERROR(ret);
+
+  return 0;
+}
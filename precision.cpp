@@ -0,0 +1,171 @@
+/*
+ The precisions of the fft plans (see cplx.c for the kernel side).
+
+ The plans are templated by 'T', the type of the computations (float or double),
+ and by 'S', the type of the inputs and outputs in device memory:
+
+ - 'S' = 'T' by default,
+ - 'S' = 'cl_half' (with 'T' = float) halves the memory traffic of bandwidth-bound transforms,
+   at the cost of the accuracy of the inputs and outputs: the results must stay below 65504
+   (the biggest half), and have 3 significant digits.
+
+ The host vectors of the plans always contain 'T' and std::complex<T>,
+ the plans convert them from / to 'S' when it differs.
+ */
+
+#include <cstring>
+
+namespace imajuscule {
+
+  struct HalfComplex {
+    cl_half real;
+    cl_half imag;
+  };
+
+  // The type of the complex numbers in device memory
+  template<typename S>
+  struct StorageComplex_ {
+    using type = std::complex<S>;
+  };
+  template<>
+  struct StorageComplex_<cl_half> {
+    using type = HalfComplex;
+  };
+  template<typename S>
+  using StorageComplex = typename StorageComplex_<S>::type;
+
+  // Rounds to the nearest even, like 'vstore_half' in the kernels.
+  cl_half floatToHalf(float const f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t const sign = (x >> 16) & 0x8000;
+    uint32_t const absx = x & 0x7fffffff;
+    if(absx >= 0x7f800000) {
+      // infinity or nan
+      return sign | 0x7c00 | (absx > 0x7f800000 ? 0x200 : 0);
+    }
+    if(absx >= 0x477ff000) {
+      // rounds to infinity
+      return sign | 0x7c00;
+    }
+    if(absx < 0x33000000) {
+      // rounds to 0
+      return sign;
+    }
+    uint32_t h, rem, halfway;
+    if(absx < 0x38800000) {
+      // a subnormal half
+      int const shift = 126 - static_cast<int>(absx >> 23);
+      uint32_t const m = (absx & 0x7fffff) | 0x800000;
+      h = m >> shift;
+      rem = m & ((1u << shift) - 1);
+      halfway = 1u << (shift - 1);
+    }
+    else {
+      // rebias the exponent, and drop the 13 least significant bits of the mantissa
+      h = (absx - 0x38000000) >> 13;
+      rem = absx & 0x1fff;
+      halfway = 0x1000;
+    }
+    // a carry in the mantissa increments the exponent, which is what we want.
+    h += (rem > halfway || (rem == halfway && (h & 1))) ? 1 : 0;
+    return static_cast<cl_half>(sign | h);
+  }
+
+  float halfToFloat(cl_half const h) {
+    uint32_t const sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t const exponent = (h >> 10) & 0x1f;
+    uint32_t const mantissa = h & 0x3ff;
+    if(exponent == 0) {
+      // 0 or a subnormal half
+      float const f = std::ldexp(static_cast<float>(mantissa), -24);
+      return sign ? -f : f;
+    }
+    uint32_t const x = sign | (mantissa << 13) | ((exponent == 0x1f) ? 0x7f800000 : ((exponent + 112) << 23));
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+  }
+
+  template<typename S, typename T>
+  S toStorage(T const v) {
+    if constexpr (std::is_same_v<S, cl_half>) {
+      return floatToHalf(v);
+    }
+    else {
+      return v;
+    }
+  }
+
+  template<typename T, typename S>
+  std::complex<T> fromStorage(StorageComplex<S> const & c) {
+    if constexpr (std::is_same_v<S, cl_half>) {
+      return {halfToFloat(c.real), halfToFloat(c.imag)};
+    }
+    else {
+      return c;
+    }
+  }
+
+  template<typename T, typename S>
+  struct FftPrecision {
+    static_assert((std::is_same_v<T, float> && (std::is_same_v<S, float> || std::is_same_v<S, cl_half>)) ||
+                  (std::is_same_v<T, double> && std::is_same_v<S, double>),
+                  "the supported precisions are float, double, and half storage with float computations");
+
+    // The value of 'PRECISION' in cplx.c
+    static constexpr int kernelPrecision = std::is_same_v<T, double> ? 1 : (std::is_same_v<S, cl_half> ? 2 : 0);
+
+    static const char * name() {
+      switch(kernelPrecision) {
+        case 1: return "double";
+        case 2: return "half";
+        default: return "float";
+      }
+    }
+
+    // Throws std::runtime_error if the device doesn't support this precision.
+    // (the kernels use 'vload_half' and 'vstore_half' which don't need cl_khr_fp16)
+    static void checkDevice(cl_device_id device_id) {
+      if(kernelPrecision != 1) {
+        return;
+      }
+      std::string const extensions = deviceInfoString(device_id, CL_DEVICE_EXTENSIONS);
+      if(extensions.find("cl_khr_fp64") == std::string::npos) {
+        throw std::runtime_error("the device doesn't support double precision (cl_khr_fp64)");
+      }
+    }
+
+    // Replaces the 'replace_PRECISION' token of the kernel source.
+    // Throws std::runtime_error if the kernel supports floats only.
+    static std::string specialize(std::string const & kernel_src) {
+      if(kernel_src.find("replace_PRECISION") == std::string::npos) {
+        if(kernelPrecision != 0) {
+          throw std::runtime_error(std::string("this kernel doesn't support the ") + name() + " precision");
+        }
+        return kernel_src;
+      }
+      return ReplaceString(kernel_src, "replace_PRECISION", std::to_string(kernelPrecision));
+    }
+
+    /*
+     The tolerance used to compare the results of the plans for ffts of size 'size'
+     with 'makeRefForwardFft' in the same precision (see verifyVectorsAreEqual).
+
+     The comparison is relative to the magnitude of each frequency bin, so the small bins
+     have errors much bigger than getFFTEpsilon, hence the factors, found experimentally.
+     */
+    static double tolerance(int size) {
+      if constexpr (std::is_same_v<S, float>) {
+        return 0.01; // the value used by the float examples so far
+      }
+      else if constexpr (std::is_same_v<S, double>) {
+        return 1000. * fft::getFFTEpsilon<S>(size);
+      }
+      else {
+        return 20. * fft::getFFTEpsilon<S>(size);
+      }
+    }
+  };
+
+} // NS imajuscule
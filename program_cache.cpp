@@ -0,0 +1,178 @@
+/*
+ On-disk cache of compiled OpenCL programs.
+
+ The binaries are keyed by a hash of:
+ - the final kernel source (after the 'replace_*' substitutions),
+ - the content of the files it includes,
+ - the build options,
+ - the device name, the device version and the driver version.
+
+ The cache directory is read from the 'GPGPU_CACHE_DIR' environment variable,
+ and defaults to '.kernel_cache' in the source root. Setting it to an empty string
+ disables the cache.
+ */
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace imajuscule {
+
+  // 64 bits FNV-1a
+  struct Hasher {
+    uint64_t h = 14695981039346656037ULL;
+
+    void add(const char * data, size_t sz) {
+      for(size_t i=0; i<sz; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+      }
+      // separate consecutive strings, so that ("ab","c") and ("a","bc") differ.
+      h ^= 0xFF;
+      h *= 1099511628211ULL;
+    }
+    void add(std::string const & s) {
+      add(s.data(), s.size());
+    }
+  };
+
+  std::string deviceInfoString(cl_device_id device_id, cl_device_info info) {
+    size_t sz;
+    cl_int ret = clGetDeviceInfo(device_id, info, 0, NULL, &sz);
+    CHECK_CL_ERROR(ret);
+    std::string res(sz, '\0');
+    ret = clGetDeviceInfo(device_id, info, sz, &res[0], NULL);
+    CHECK_CL_ERROR(ret);
+    // remove the terminating null character(s)
+    while(!res.empty() && res.back() == '\0') {
+      res.pop_back();
+    }
+    return res;
+  }
+
+  // Identifies the compiler that will be used for the device.
+  std::string deviceCompilerId(cl_device_id device_id) {
+    return deviceInfoString(device_id, CL_DEVICE_NAME) + " / " +
+    deviceInfoString(device_id, CL_DEVICE_VERSION) + " / " +
+    deviceInfoString(device_id, CL_DRIVER_VERSION);
+  }
+
+  // Hashes the files included with '#include "file"', recursively.
+  void hashIncludes(Hasher & hasher, std::string const & src, int depth = 0) {
+    verify(depth < 16); // an include cycle ?
+    static const std::string directive = "#include \"";
+    for(size_t pos = src.find(directive); pos != std::string::npos; pos = src.find(directive, pos)) {
+      pos += directive.size();
+      auto const end = src.find('"', pos);
+      if(end == std::string::npos) {
+        break;
+      }
+      std::string const included = read_kernel(src.substr(pos, end-pos));
+      hasher.add(included);
+      hashIncludes(hasher, included, depth+1);
+    }
+  }
+
+  struct ProgramCache {
+
+    static ProgramCache & getInstance() {
+      static ProgramCache cache;
+      return cache;
+    }
+
+    bool enabled() const { return !dir.empty(); }
+
+    void setDirectory(std::string d) {
+      dir = std::move(d);
+      if(enabled()) {
+        ::mkdir(dir.c_str(), 0755); // fails harmlessly if the directory exists
+      }
+    }
+
+    std::string path(cl_device_id device_id, std::string const & src, std::string const & options) const {
+      Hasher hasher;
+      hasher.add(src);
+      hashIncludes(hasher, src);
+      hasher.add(options);
+      hasher.add(deviceCompilerId(device_id));
+
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hasher.h));
+      return dir + "/" + buf + ".bin";
+    }
+
+    // Returns 0 if the binary is not in the cache, or if it could not be used.
+    cl_program load(cl_context context, cl_device_id device_id, std::string const & file, std::string const & options) const {
+      std::string binary;
+      try {
+        get_file_contents(file, binary);
+      }
+      catch(...) {
+        return 0;
+      }
+      if(binary.empty()) {
+        return 0;
+      }
+      size_t const binary_size = binary.size();
+      const unsigned char * binary_data = reinterpret_cast<const unsigned char *>(binary.data());
+      cl_int binary_status, ret;
+      cl_program program = clCreateProgramWithBinary(context, 1, &device_id,
+                                                     &binary_size, &binary_data,
+                                                     &binary_status, &ret);
+      if(ret != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        if(program) {
+          clReleaseProgram(program);
+        }
+        return 0;
+      }
+      // Programs created from binaries need to be built, too (but it is fast).
+      ret = clBuildProgram(program, 1, &device_id, options.c_str(), NULL, NULL);
+      if(ret != CL_SUCCESS) {
+        clReleaseProgram(program);
+        return 0;
+      }
+      return program;
+    }
+
+    void store(cl_program program, std::string const & file) const {
+      size_t binary_size;
+      cl_int ret = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL);
+      CHECK_CL_ERROR(ret);
+      if(!binary_size) {
+        return;
+      }
+      std::string binary(binary_size, '\0');
+      unsigned char * binary_data = reinterpret_cast<unsigned char *>(&binary[0]);
+      ret = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary_data), &binary_data, NULL);
+      CHECK_CL_ERROR(ret);
+
+      // write to a temporary file first, so that a concurrent process never reads a partial binary.
+      std::string const tmp = file + ".tmp" + std::to_string(getpid());
+      bool written;
+      {
+        std::ofstream out(tmp, std::ios::out | std::ios::binary);
+        out.write(binary.data(), binary.size());
+        out.close();
+        written = static_cast<bool>(out);
+      }
+      // a partial or unused temporary file is removed.
+      if(!written || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+      }
+    }
+
+  private:
+    ProgramCache() {
+      const char * env = getenv("GPGPU_CACHE_DIR");
+      setDirectory(env ? env : fullpath(".kernel_cache"));
+    }
+
+    std::string dir;
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+    ProgramCache(ProgramCache&&) = delete;
+    ProgramCache& operator=(ProgramCache&&) = delete;
+  };
+
+} // NS imajuscule
@@ -34,3 +34,13 @@ std::string read_kernel(const std::string & kernel) {
   get_file_contents(fullpath(kernel), ret);
   return ret;
 }
+
+std::string ReplaceString(std::string subject, const std::string& search,
+                          const std::string& replace) {
+  size_t pos = 0;
+  while ((pos = subject.find(search, pos)) != std::string::npos) {
+    subject.replace(pos, search.length(), replace);
+    pos += replace.length();
+  }
+  return subject;
+}
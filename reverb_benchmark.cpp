@@ -0,0 +1,258 @@
+/*
+ The convolution reverb benchmark (see main_reverb_benchmark.cpp): a multichannel stream is convolved
+ with an impulse response per channel, block by block like in an audio callback, by each backend:
+
+ - "gpu": a 'GpuConvolution' per channel (see gpu_convolution.cpp),
+ - "clfft": the same, with the ffts computed by clFFT (see clfft_plan.cpp), when the library is found,
+ - "cpu_imj": a 'CpuConvolution' per channel using the imajuscule fft (see cpu_convolution.cpp),
+ - "cpu_<isa>": a 'CpuConvolution' per channel using the vectorized ffts, for each instruction set supported by the cpu.
+
+ For each backend, we measure:
+
+ - the real-time factor: the processing duration divided by the duration of the stream at the sample rate
+   (the backend keeps up with the stream when it is below 1),
+ - the cpu usage: the cpu time of the process (all threads, including the threads of the OpenCL driver)
+   divided by the duration of the stream, in percent of a core,
+ - the latency of a block, from the end of its reception to the availability of its output:
+   the duration of a block (the convolution needs the whole block) plus the processing duration,
+   and the count of blocks whose processing takes longer than a block (missed deadlines).
+
+ The blocks are processed as fast as possible, or 'paced' at the sample rate like in an audio callback
+ (the devices may then lower their clocks between the blocks). The outputs are verified against a direct convolution.
+ */
+
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <thread>
+
+namespace imajuscule {
+
+  struct ReverbWorkload {
+    int irSize, blockSize, nChannels;
+    double sampleRate;
+    int nBlocks;
+    bool paced;
+
+    // The duration of a block at the sample rate, in nanoseconds
+    double blockDuration() const { return 1e9 * blockSize / sampleRate; }
+  };
+
+  // Owns the convolutions of the channels of a workload.
+  struct ReverbRunner {
+    virtual ~ReverbRunner() = default;
+
+    // Convolves a block of each channel: 'input' (resp. 'output') has the 'nChannels' blocks one after the other.
+    virtual void process(float const * input, float * output) = 0;
+  };
+
+  template<typename RealFft>
+  struct GpuReverbRunner : public ReverbRunner {
+    GpuReverbRunner(cl_context context, cl_device_id device_id, cl_command_queue command_queue,
+                    int blockSize, std::vector<std::vector<float>> const & impulseResponses) :
+    blockSz(blockSize)
+    {
+      for(auto const & ir : impulseResponses) {
+        convolutions.push_back(std::make_unique<GpuConvolution<float, RealFft>>(context, device_id, command_queue, blockSize, ir));
+      }
+    }
+
+    // The commands of all channels are enqueued before we wait for the outputs.
+    void process(float const * input, float * output) override {
+      reads.clear();
+      for(size_t c=0; c<convolutions.size(); ++c) {
+        releaseEvent(convolutions[c]->enqueueBlock(input + c * blockSz));
+        reads.push_back(convolutions[c]->enqueueReadOutput(output + c * blockSz, {}));
+      }
+      cl_int ret = clWaitForEvents(reads.size(), reads.data());
+      CHECK_CL_ERROR(ret);
+      for(auto e : reads) {
+        releaseEvent(e);
+      }
+    }
+
+  private:
+    int blockSz;
+    std::vector<std::unique_ptr<GpuConvolution<float, RealFft>>> convolutions;
+    std::vector<cl_event> reads;
+
+    static void releaseEvent(cl_event event) {
+      cl_int ret = clReleaseEvent(event);
+      CHECK_CL_ERROR(ret);
+    }
+  };
+
+  template<typename RealFft>
+  struct CpuReverbRunner : public ReverbRunner {
+    // 'fftArgs' are passed to the constructors of 'RealFft', after the fft size.
+    template<typename... Args>
+    CpuReverbRunner(int blockSize, std::vector<std::vector<float>> const & impulseResponses, Args const & ... fftArgs) :
+    blockSz(blockSize)
+    {
+      for(auto const & ir : impulseResponses) {
+        convolutions.push_back(std::make_unique<CpuConvolution<RealFft>>(blockSize, ir, fftArgs...));
+      }
+    }
+
+    // The channels are convolved one after the other, on the calling thread (the audio thread).
+    void process(float const * input, float * output) override {
+      for(size_t c=0; c<convolutions.size(); ++c) {
+        convolutions[c]->process(input + c * blockSz, output + c * blockSz);
+      }
+    }
+
+  private:
+    int blockSz;
+    std::vector<std::unique_ptr<CpuConvolution<RealFft>>> convolutions;
+  };
+
+  struct ReverbCase {
+    std::string name;
+    // Throws std::runtime_error when the device doesn't support the workload.
+    std::function<std::unique_ptr<ReverbRunner>(int blockSize, std::vector<std::vector<float>> const & impulseResponses)> makeRunner;
+  };
+
+  struct ReverbResult {
+    std::string name;
+    ReverbWorkload workload;
+    double realTimeFactor = 0.;
+    double cpuPercent = 0.;
+    // The latencies of the blocks, in nanoseconds
+    LatencyHistogram latencies;
+    size_t missedDeadlines = 0;
+  };
+
+  // A decaying impulse response per channel
+  std::vector<std::vector<float>> makeImpulseResponses(ReverbWorkload const & w) {
+    std::vector<std::vector<float>> irs(w.nChannels);
+    for(auto & ir : irs) {
+      ir.reserve(w.irSize);
+      for(int i=0; i<w.irSize; ++i) {
+        ir.push_back(rand_float(0.f,1.f) * std::exp(-4.f * i / w.irSize));
+      }
+    }
+    return irs;
+  }
+
+  // The signals of the channels, one after the other
+  std::vector<float> makeSignals(ReverbWorkload const & w) {
+    std::vector<float> signals;
+    signals.reserve(static_cast<size_t>(w.nChannels) * w.nBlocks * w.blockSize);
+    for(size_t i=0; i<signals.capacity(); ++i) {
+      signals.push_back(rand_float(0.f,1.f));
+    }
+    return signals;
+  }
+
+  // The samples [begin, end) of the direct convolution of 'signal' with 'impulseResponse', computed on the cpu.
+  std::vector<float> directConvolution(float const * signal, std::vector<float> const & impulseResponse,
+                                       size_t begin, size_t end) {
+    std::vector<float> res;
+    res.reserve(end - begin);
+    for(size_t i=begin; i<end; ++i) {
+      double acc = 0.;
+      for(size_t j=0; j<impulseResponse.size() && j<=i; ++j) {
+        acc += static_cast<double>(signal[i-j]) * impulseResponse[j];
+      }
+      res.push_back(static_cast<float>(acc));
+    }
+    return res;
+  }
+
+  /*
+   'signals' has the 'nChannels' signals of 'nBlocks * blockSize' samples one after the other.
+   The first 'nSkipBlocks' blocks are processed but not measured.
+   The first and the last blocks of the outputs are verified.
+   */
+  ReverbResult runReverbBenchmark(ReverbCase const & c, ReverbRunner & runner, ReverbWorkload const & w,
+                                  std::vector<float> const & signals, std::vector<std::vector<float>> const & impulseResponses,
+                                  int nSkipBlocks) {
+    ReverbResult res{c.name, w, 0., 0., {}, 0};
+    size_t const signalSize = static_cast<size_t>(w.nBlocks) * w.blockSize;
+    std::vector<float> input(w.nChannels * w.blockSize), output(input.size());
+    std::vector<float> outputs(signals.size());
+
+    double processing = 0.;
+    std::clock_t cpuStart = std::clock();
+    auto deadline = std::chrono::steady_clock::now();
+    for(int b=0; b<w.nBlocks; ++b) {
+      if(b == nSkipBlocks) {
+        cpuStart = std::clock();
+      }
+      for(int ch=0; ch<w.nChannels; ++ch) {
+        auto const from = signals.begin() + ch * signalSize + b * w.blockSize;
+        std::copy(from, from + w.blockSize, input.begin() + ch * w.blockSize);
+      }
+      if(w.paced) {
+        // the next block is received one block duration after the previous one.
+        deadline += std::chrono::nanoseconds(static_cast<int64_t>(w.blockDuration()));
+        std::this_thread::sleep_until(deadline);
+      }
+
+      auto const start = std::chrono::steady_clock::now();
+      runner.process(input.data(), output.data());
+      double const duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      for(int ch=0; ch<w.nChannels; ++ch) {
+        std::copy(output.begin() + ch * w.blockSize, output.begin() + (ch+1) * w.blockSize,
+                  outputs.begin() + ch * signalSize + b * w.blockSize);
+      }
+      if(b < nSkipBlocks) {
+        continue;
+      }
+      processing += duration;
+      res.latencies.add(w.blockDuration() + duration);
+      if(duration > w.blockDuration()) {
+        ++res.missedDeadlines;
+      }
+    }
+    double const cpuTime = 1e9 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    double const streamDuration = (w.nBlocks - nSkipBlocks) * w.blockDuration();
+    res.realTimeFactor = processing / streamDuration;
+    res.cpuPercent = 100. * cpuTime / streamDuration;
+
+    for(int ch=0; ch<w.nChannels; ++ch) {
+      float const * signal = signals.data() + ch * signalSize;
+      for(size_t begin : {size_t{0}, signalSize - w.blockSize}) {
+        auto const from = outputs.begin() + ch * signalSize + begin;
+        verifyVectorsAreEqual(std::vector<float>(from, from + w.blockSize),
+                              directConvolution(signal, impulseResponses[ch], begin, begin + w.blockSize),
+                              0.001f);
+      }
+    }
+    return res;
+  }
+
+  // The durations are written in microseconds.
+
+  void writeReverbCsv(std::ostream & os, std::vector<ReverbResult> const & results) {
+    os << "name,ir_size,block_size,channels,sample_rate,blocks,paced,"
+    << "real_time_factor,cpu_percent,latency_median_us,latency_p99_us,latency_max_us,missed_deadlines" << std::endl;
+    for(auto const & r : results) {
+      auto const & w = r.workload;
+      os << r.name << "," << w.irSize << "," << w.blockSize << "," << w.nChannels << "," << w.sampleRate << ","
+      << r.latencies.count() << "," << (w.paced ? 1 : 0) << ","
+      << r.realTimeFactor << "," << r.cpuPercent << ","
+      << r.latencies.percentile(50.)/1000. << "," << r.latencies.percentile(99.)/1000. << "," << r.latencies.max()/1000. << ","
+      << r.missedDeadlines << std::endl;
+    }
+  }
+
+  void writeReverbJson(std::ostream & os, std::string const & device, std::vector<ReverbResult> const & results) {
+    os << "{" << std::endl << "  \"device\": \"" << device << "\"," << std::endl << "  \"results\": [";
+    for(size_t i=0; i<results.size(); ++i) {
+      auto const & r = results[i];
+      auto const & w = r.workload;
+      os << (i ? "," : "") << std::endl << "    {\"name\": \"" << r.name << "\""
+      << ", \"ir_size\": " << w.irSize << ", \"block_size\": " << w.blockSize << ", \"channels\": " << w.nChannels
+      << ", \"sample_rate\": " << w.sampleRate << ", \"blocks\": " << r.latencies.count() << ", \"paced\": " << (w.paced ? "true" : "false")
+      << ", \"real_time_factor\": " << r.realTimeFactor << ", \"cpu_percent\": " << r.cpuPercent
+      << ", \"latency\": {\"median_us\": " << r.latencies.percentile(50.)/1000. << ", \"p99_us\": " << r.latencies.percentile(99.)/1000.
+      << ", \"max_us\": " << r.latencies.max()/1000. << "}, \"missed_deadlines\": " << r.missedDeadlines << "}";
+    }
+    os << std::endl << "  ]" << std::endl << "}" << std::endl;
+  }
+
+} // NS imajuscule
@@ -0,0 +1,129 @@
+/*
+ The processing of the short-time Fourier transforms, fused in the global memory transfers of the fft kernels
+ (see gpu_stft.cpp and image_io.c): 'loadInput' multiplies the frames by a window when it loads them to local memory,
+ and 'storeOutput' writes the magnitudes (or the powers) of the bins instead of the spectrum.
+
+ The kernel defines STFT_WINDOW and SPECTRUM_OUTPUT (replaced by the plan) before including this file
+ (after local_layout.c).
+
+ With a window, the kernel receives the window table (one real per element of an input) after the twiddles:
+ the kernels (and 'loadInput') end their parameter list with 'WINDOW_PARAM', and the calls with 'WINDOW_PASS'.
+
+ With a magnitude or power output, the values of the bins 2*i and 2*i+1 are the real and imaginary parts
+ of the i-th complex number of the output, so the output of an fft of size N has N/2 complex numbers.
+ */
+
+#define STFT_NO_WINDOW    0
+#define STFT_WINDOW_TABLE 1
+
+#define SPECTRUM_OUTPUT_COMPLEX   0
+#define SPECTRUM_OUTPUT_MAGNITUDE 1
+#define SPECTRUM_OUTPUT_POWER     2
+
+#ifndef STFT_WINDOW
+#error "the kernel must define STFT_WINDOW"
+#endif
+
+#ifndef SPECTRUM_OUTPUT
+#error "the kernel must define SPECTRUM_OUTPUT"
+#endif
+
+#if STFT_WINDOW == STFT_WINDOW_TABLE
+#define WINDOW_PARAM , __global const scalar * restrict window
+#define WINDOW_PASS , window
+#else
+#define WINDOW_PARAM
+#define WINDOW_PASS
+#endif
+
+// the real 'i' of the input, multiplied by the window
+inline scalar windowReal(scalar const x, int const i WINDOW_PARAM) {
+#if STFT_WINDOW == STFT_WINDOW_TABLE
+  return x * window[i];
+#else
+  return x;
+#endif
+}
+
+// the reals 4*i ... 4*i+3 of the input, multiplied by the window
+inline scalar4 windowReal4(scalar4 v, int const i WINDOW_PARAM) {
+#if STFT_WINDOW == STFT_WINDOW_TABLE
+  scalar4 const w = vload4(i, window);
+  v.x *= w.x;
+  v.y *= w.y;
+  v.z *= w.z;
+  v.w *= w.w;
+#endif
+  return v;
+}
+
+// Like 'loadRealsToBuffer' (see local_layout.c), with the reals multiplied by the window.
+inline void loadWindowedRealsToBuffer(__global const REAL_STORAGE *input, __local scalar *to, int const n WINDOW_PARAM) {
+  int const k = get_global_id(0);
+  int const nItems = get_global_size(0);
+  if(n < 4) {
+    for(int j=0; j<n; ++j) {
+      int const m = nItems * j + k;
+      setLocal(to, m, complexFromReal(windowReal(loadReal(input, m), m WINDOW_PASS)));
+    }
+    return;
+  }
+  for(int j=0; j<n/4; ++j) {
+    int const m = nItems * j + k;
+    scalar4 const v = windowReal4(loadReal4(input, m), m WINDOW_PASS);
+    setLocal(to, 4*m,   complexFromReal(v.x));
+    setLocal(to, 4*m+1, complexFromReal(v.y));
+    setLocal(to, 4*m+2, complexFromReal(v.z));
+    setLocal(to, 4*m+3, complexFromReal(v.w));
+  }
+}
+
+inline scalar binValue(struct cplx const c) {
+  scalar const power = c.real * c.real + c.imag * c.imag;
+#if SPECTRUM_OUTPUT == SPECTRUM_OUTPUT_MAGNITUDE
+  return sqrt(power);
+#else
+  return power;
+#endif
+}
+
+// the values of the bins 4*i ... 4*i+3
+inline scalar4 binValues4(__local scalar const *from, int const i) {
+  scalar4 v;
+  v.x = binValue(getLocal(from, 4*i));
+  v.y = binValue(getLocal(from, 4*i+1));
+  v.z = binValue(getLocal(from, 4*i+2));
+  v.w = binValue(getLocal(from, 4*i+3));
+  return v;
+}
+
+// The number of groups of 4 bin values written by the work item, when each work item has 'n' bins (a power of 2):
+// when n < 4, half the work items write a group.
+inline int binValueGroups(int const n) {
+  if(n < 4) {
+    return (get_global_id(0) & 1) ? 0 : 1;
+  }
+  return n/4;
+}
+
+// The index of the j-th group of 4 bin values written by the work item
+inline int binValueGroup(int const n, int const j) {
+  if(n < 4) {
+    return get_global_id(0)/2;
+  }
+  return get_global_size(0) * j + get_global_id(0);
+}
+
+// Like 'storeCplxsFromBuffer' (see local_layout.c), writes the values of the bins, 4 at a time.
+inline void storeBinValuesFromBuffer(__global CPLX_STORAGE *output, __local scalar const *from, int const n) {
+  for(int j=0, nGroups = binValueGroups(n); j<nGroups; ++j) {
+    int const m = binValueGroup(n, j);
+    scalar4 const v = binValues4(from, m);
+    struct cplx a, b;
+    a.real = v.x;
+    a.imag = v.y;
+    b.real = v.z;
+    b.imag = v.w;
+    storeCplx2(output, m, a, b);
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ The processing of the short-time Fourier transforms fused in the fft kernels (see stft.c for the kernel side,
+ and gpu_stft.cpp): the inputs of the batch are multiplied by a window when the kernel loads them to local memory,
+ and the kernel can write the magnitudes (or the powers) of the bins instead of the spectrum.
+ */
+
+namespace imajuscule {
+
+  enum class SpectrumOutput {
+    // The complex numbers of the spectrum
+    Complex,
+    // |X[k]|
+    Magnitude,
+    // |X[k]|^2
+    Power
+  };
+
+  const char * toString(SpectrumOutput o) {
+    switch(o) {
+      case SpectrumOutput::Complex: return "complex";
+      case SpectrumOutput::Magnitude: return "magnitude";
+      case SpectrumOutput::Power: return "power";
+    }
+    return "";
+  }
+
+  // The value of 'SPECTRUM_OUTPUT' in stft.c
+  constexpr int kernelSpectrumOutput(SpectrumOutput o) {
+    switch(o) {
+      case SpectrumOutput::Complex: return 0;
+      case SpectrumOutput::Magnitude: return 1;
+      case SpectrumOutput::Power: return 2;
+    }
+    return 0;
+  }
+
+  /*
+   The processing fused in the global memory transfers of a 'GpuFftPlan'.
+
+   With a magnitude or power output, the output of an fft of size N has N/2 complex numbers:
+   the values of the bins 2*i and 2*i+1 are the real and imaginary parts of the i-th complex number.
+   */
+  template<typename T>
+  struct StftProcessing {
+    // The window multiplying every input of the batch (one value per element of an input),
+    // or empty for no window.
+    std::vector<T> window;
+    SpectrumOutput output = SpectrumOutput::Complex;
+
+    bool enabled() const { return !window.empty() || output != SpectrumOutput::Complex; }
+  };
+
+  // The kernels accessing their input and output with 'loadInput' and 'storeOutput' (see image_io.c)
+  // support the windows and the spectrum outputs.
+  bool kernelSupportsStft(std::string const & kernel_src) {
+    return kernel_src.find("replace_STFT_WINDOW") != std::string::npos;
+  }
+
+  std::string specializeStft(std::string const & kernel_src, bool windowed, SpectrumOutput output) {
+    return ReplaceString(ReplaceString(kernel_src,
+                                       "replace_STFT_WINDOW",
+                                       std::to_string(windowed ? 1 : 0)),
+                         "replace_SPECTRUM_OUTPUT",
+                         std::to_string(kernelSpectrumOutput(output)));
+  }
+
+  // The periodic Hann window of 'size' elements, the usual window of the STFT:
+  // the sum of the windows of frames overlapping by 50% (or 75%) is constant.
+  template<typename T>
+  std::vector<T> hannWindow(int size) {
+    std::vector<T> w(size);
+    for(int i=0; i<size; ++i) {
+      w[i] = static_cast<T>(0.5 - 0.5 * std::cos(2. * M_PI * i / size));
+    }
+    return w;
+  }
+
+} // NS imajuscule
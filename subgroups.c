@@ -0,0 +1,44 @@
+/*
+ The exchange of values between the work items of a sub-group, selected by the plan (see subgroups.cpp).
+
+ The kernel defines SUBGROUP_SHUFFLE (replaced by the plan) before including this file:
+
+ - SUBGROUP_SHUFFLE_NONE: the work items exchange their values through local memory only,
+ - SUBGROUP_SHUFFLE_KHR: 'sub_group_shuffle_xor' (cl_khr_subgroup_shuffle, OpenCL C 2.0),
+ - SUBGROUP_SHUFFLE_INTEL: 'intel_sub_group_shuffle_xor' (cl_intel_subgroups).
+
+ With shuffles, 'shuffleXor(c, mask)' returns the value 'c' of the work item whose sub-group local id is
+ the local id of the caller xor 'mask' (< get_sub_group_size()). All the work items of the sub-group must call it.
+ */
+
+#define SUBGROUP_SHUFFLE_NONE  0
+#define SUBGROUP_SHUFFLE_KHR   1
+#define SUBGROUP_SHUFFLE_INTEL 2
+
+#ifndef SUBGROUP_SHUFFLE
+#error "the kernel must define SUBGROUP_SHUFFLE"
+#endif
+
+#if SUBGROUP_SHUFFLE == SUBGROUP_SHUFFLE_KHR
+
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable
+#define shuffleXorScalar(x, mask) sub_group_shuffle_xor((x), (mask))
+
+#elif SUBGROUP_SHUFFLE == SUBGROUP_SHUFFLE_INTEL
+
+#pragma OPENCL EXTENSION cl_intel_subgroups : enable
+#define shuffleXorScalar(x, mask) intel_sub_group_shuffle_xor((x), (mask))
+
+#endif
+
+#if SUBGROUP_SHUFFLE != SUBGROUP_SHUFFLE_NONE
+
+inline struct cplx shuffleXor(struct cplx const c, uint const mask) {
+  struct cplx r;
+  r.real = shuffleXorScalar(c.real, mask);
+  r.imag = shuffleXorScalar(c.imag, mask);
+  return r;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ The sub-group shuffles of the fft kernels (see subgroups.c for the kernel side).
+
+ In the Cooley-Tukey kernel (vector_fft_floats_multi_local_coalesce_shifts_twiddles.cl), the butterflies
+ of the first stages span fewer elements than a sub-group has work items: with shuffles, these stages are computed
+ in private memory, the work items of a sub-group exchanging their values with 'shuffleXor', without local memory
+ accesses nor barriers. The local memory is used once the butterflies span more than a sub-group.
+ (OpenCL doesn't specify which local ids form a sub-group, so during these stages the elements of a work item
+ are given by its sub-group id and sub-group local id.)
+
+ The shuffles are detected per device (cl_khr_subgroup_shuffle or cl_intel_subgroups), and are an option
+ of the plan ('GpuFftConfig::shuffles') that the autotuner tries (see autotune.cpp).
+ */
+
+#include <sstream>
+
+namespace imajuscule {
+
+  enum class SubgroupShuffles {
+    // The tuned option (see tuning_db.cpp) if any, else 'On' when the device supports shuffles.
+    Auto,
+    Off,
+    // 'Off' when the device or the kernel doesn't support shuffles.
+    On
+  };
+
+  constexpr SubgroupShuffles explicitSubgroupShuffles[] = {
+    SubgroupShuffles::Off, SubgroupShuffles::On
+  };
+
+  const char * toString(SubgroupShuffles s) {
+    switch(s) {
+      case SubgroupShuffles::Auto: return "auto";
+      case SubgroupShuffles::Off: return "off";
+      case SubgroupShuffles::On: return "on";
+    }
+    return "";
+  }
+
+  SubgroupShuffles subgroupShufflesFromString(std::string const & str) {
+    for(auto s : {SubgroupShuffles::Auto, SubgroupShuffles::Off, SubgroupShuffles::On}) {
+      if(str == toString(s)) {
+        return s;
+      }
+    }
+    throw std::runtime_error("unknown sub-group shuffles option: " + str);
+  }
+
+  // The shuffle functions of a device
+  enum class SubgroupExtension {
+    None,
+    // cl_khr_subgroups and cl_khr_subgroup_shuffle, the kernels are built as OpenCL C 2.0
+    Khr,
+    // cl_intel_subgroups
+    Intel
+  };
+
+  const char * toString(SubgroupExtension e) {
+    switch(e) {
+      case SubgroupExtension::None: return "none";
+      case SubgroupExtension::Khr: return "cl_khr_subgroup_shuffle";
+      case SubgroupExtension::Intel: return "cl_intel_subgroups";
+    }
+    return "";
+  }
+
+  // The value of 'SUBGROUP_SHUFFLE' in subgroups.c
+  constexpr int kernelSubgroupShuffle(SubgroupExtension e) {
+    switch(e) {
+      case SubgroupExtension::None: return 0;
+      case SubgroupExtension::Khr: return 1;
+      case SubgroupExtension::Intel: return 2;
+    }
+    return 0;
+  }
+
+  bool hasExtension(std::string const & extensions, std::string const & name) {
+    std::istringstream s(extensions);
+    std::string e;
+    while(s >> e) {
+      if(e == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  SubgroupExtension subgroupExtension(cl_device_id device_id) {
+    std::string const extensions = deviceInfoString(device_id, CL_DEVICE_EXTENSIONS);
+    // (the intel extension doesn't need OpenCL C 2.0)
+    if(hasExtension(extensions, "cl_intel_subgroups")) {
+      return SubgroupExtension::Intel;
+    }
+    if(hasExtension(extensions, "cl_khr_subgroups") && hasExtension(extensions, "cl_khr_subgroup_shuffle") &&
+       openclCMajorVersion(device_id) >= 2) {
+      return SubgroupExtension::Khr;
+    }
+    return SubgroupExtension::None;
+  }
+
+  bool kernelSupportsSubgroupShuffles(std::string const & kernel_src) {
+    return kernel_src.find("replace_SUBGROUP_SHUFFLE") != std::string::npos;
+  }
+
+  std::string specializeSubgroupShuffles(std::string const & kernel_src, SubgroupExtension e) {
+    return ReplaceString(kernel_src,
+                         "replace_SUBGROUP_SHUFFLE",
+                         std::to_string(kernelSubgroupShuffle(e)));
+  }
+
+} // NS imajuscule
@@ -0,0 +1,186 @@
+/*
+ A work-stealing thread pool, for the cpu ffts that are split across cores (see cpu_huge_fft_plan.cpp).
+
+ Each worker has its own queue of tasks: it runs its tasks in LIFO order, and when its queue is empty,
+ it steals the oldest task of another queue. 'parallelFor' splits a loop in tasks, and the calling thread
+ runs tasks too until the loop is done, so it can be called from a task.
+
+ By default ('instance'), the pool has one worker less than the number of cores,
+ so that the thread feeding the gpu queues is not starved when it doesn't take part in the loops.
+
+ The tasks must not throw.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace imajuscule {
+
+  struct ThreadPool {
+    explicit ThreadPool(int nWorkers) :
+    queues(std::max(nWorkers, 0))
+    {
+      verify(nWorkers >= 0);
+      for(auto & q : queues) {
+        q = std::make_unique<Queue>();
+      }
+      workers.reserve(nWorkers);
+      for(int i=0; i<nWorkers; ++i) {
+        workers.emplace_back([this, i]() { workerLoop(i); });
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> l(sleepMutex);
+        stop = true;
+      }
+      sleepCondition.notify_all();
+      for(auto & w : workers) {
+        w.join();
+      }
+    }
+
+    static ThreadPool & instance() {
+      static ThreadPool pool(std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1);
+      return pool;
+    }
+
+    int countWorkers() const { return static_cast<int>(workers.size()); }
+
+    /*
+     Calls 'f(begin, end)' for consecutive ranges of [0, n) of (at most) 'grain' indices,
+     in parallel, and returns when all calls have returned.
+     */
+    template<typename F>
+    void parallelFor(int n, int grain, F const & f) {
+      verify(grain >= 1);
+      int const nTasks = (n + grain - 1) / grain;
+      if(nTasks <= 1 || queues.empty()) {
+        for(int begin = 0; begin < n; begin += grain) {
+          f(begin, std::min(n, begin + grain));
+        }
+        return;
+      }
+
+      std::atomic<int> remaining{nTasks};
+      std::mutex doneMutex;
+      std::condition_variable done;
+      for(int t=0; t<nTasks; ++t) {
+        push([&, t]() {
+          f(t * grain, std::min(n, (t+1) * grain));
+          std::lock_guard<std::mutex> l(doneMutex);
+          if(--remaining == 0) {
+            done.notify_all();
+          }
+        });
+      }
+
+      // Run the tasks of the pool until the loop is done: when there is no task left to run,
+      // the remaining tasks of the loop are being run by other threads.
+      while(remaining) {
+        if(!runOne(currentWorker())) {
+          std::unique_lock<std::mutex> l(doneMutex);
+          done.wait(l, [&]() { return remaining == 0; });
+        }
+      }
+      // The last task may still hold the mutex.
+      std::lock_guard<std::mutex> l(doneMutex);
+    }
+
+  private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    // The number of tasks in the queues, modified with 'sleepMutex' locked when it is incremented.
+    std::atomic<int> queued{0};
+    bool stop = false;
+
+    struct WorkerOfThread {
+      ThreadPool const * pool = nullptr;
+      int index = -1;
+    };
+    static WorkerOfThread & workerOfThread() {
+      thread_local WorkerOfThread w;
+      return w;
+    }
+    // The index of the worker of this pool running on this thread, or -1.
+    int currentWorker() const {
+      auto const & w = workerOfThread();
+      return (w.pool == this) ? w.index : -1;
+    }
+
+    // The tasks pushed by a worker go to its queue, the others are distributed round-robin.
+    void push(Task t) {
+      static std::atomic<unsigned> next{0};
+      int const w = currentWorker();
+      auto & q = *queues[(w >= 0) ? w : (next++ % queues.size())];
+      {
+        std::lock_guard<std::mutex> l(q.mutex);
+        q.tasks.push_back(std::move(t));
+      }
+      {
+        std::lock_guard<std::mutex> l(sleepMutex);
+        ++queued;
+      }
+      sleepCondition.notify_one();
+    }
+
+    // Runs the newest task of the queue of worker 'w', or steals the oldest task of another queue.
+    bool runOne(int w) {
+      Task t;
+      if(w >= 0) {
+        auto & q = *queues[w];
+        std::lock_guard<std::mutex> l(q.mutex);
+        if(!q.tasks.empty()) {
+          t = std::move(q.tasks.back());
+          q.tasks.pop_back();
+        }
+      }
+      int const n = static_cast<int>(queues.size());
+      for(int i=1; !t && i<=n; ++i) {
+        auto & q = *queues[(std::max(w, 0) + i) % n];
+        std::lock_guard<std::mutex> l(q.mutex);
+        if(!q.tasks.empty()) {
+          t = std::move(q.tasks.front());
+          q.tasks.pop_front();
+        }
+      }
+      if(!t) {
+        return false;
+      }
+      --queued;
+      t();
+      return true;
+    }
+
+    void workerLoop(int w) {
+      workerOfThread() = {this, w};
+      while(true) {
+        if(runOne(w)) {
+          continue;
+        }
+        std::unique_lock<std::mutex> l(sleepMutex);
+        sleepCondition.wait(l, [this]() { return stop || queued > 0; });
+        if(stop && queued == 0) {
+          return;
+        }
+      }
+    }
+  };
+
+} // NS imajuscule
@@ -0,0 +1,185 @@
+/*
+ Persisted results of the autotuner (see autotune.cpp).
+
+ For each (device, fft size, kernel variant), the database contains the configuration
+ that gave the shortest kernel duration. 'GpuFftPlan' reads it at construction.
+
+ The file is read from the 'GPGPU_TUNING_DB' environment variable, and defaults to
+ 'tuning_db.txt' in the source root. It has one entry per line,
+ with tab-separated fields:
+
+   device name, variant, size, butterflies per thread, workgroups, kernel duration (ns), twiddle storage,
+   options of the generated kernel, local memory layout, io storage, sub-group shuffles
+
+ The variant is the fft algorithm, the precision and the kernel file (see 'tuningVariant' in gpu_fft_plan.cpp),
+ or, for the end-to-end durations measured by 'measuredDuration', starts with "end_to_end/".
+
+ The twiddle storage is optional (the kernel then uses the default storage), and so are the options
+ of the generated kernel (see kernel_generator.cpp), the local memory layout (see local_layout.cpp),
+ the storage of the inputs and outputs (see image_io.cpp) and the sub-group shuffles (see subgroups.cpp).
+ */
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+namespace imajuscule {
+
+  struct GpuFftConfig {
+    // 0 means "the minimum number allowed by the device".
+    int nButterfliesPerThread = 0;
+    int nWorkgroups = 1;
+    TwiddleStorage twiddles = TwiddleStorage::Auto;
+    // only used by 'FftAlgo::StockhamGenerated'
+    GeneratedKernelOptions generator;
+    LocalLayout layout = LocalLayout::Auto;
+    IoStorage io = IoStorage::Auto;
+    SubgroupShuffles shuffles = SubgroupShuffles::Auto;
+
+    bool automatic() const { return nButterfliesPerThread == 0; }
+  };
+
+  struct TuningEntry {
+    GpuFftConfig config;
+    double duration_ns;
+  };
+
+  struct TuningDb {
+
+    static TuningDb & getInstance() {
+      static TuningDb db;
+      return db;
+    }
+
+    std::string const & getPath() const { return path; }
+
+    // returns nullptr if the configuration was never tuned.
+    TuningEntry const * find(std::string const & device, std::string const & variant, int size) const {
+      auto it = entries.find(key(device, variant, size));
+      if(it == entries.end()) {
+        return nullptr;
+      }
+      return &it->second;
+    }
+
+    void set(std::string const & device, std::string const & variant, int size, TuningEntry const & e) {
+      entries[key(device, variant, size)] = e;
+      save();
+    }
+
+  private:
+    TuningDb() {
+      const char * env = getenv("GPGPU_TUNING_DB");
+      path = env ? env : fullpath("tuning_db.txt");
+      load();
+    }
+
+    using Key = std::tuple<std::string, std::string, int>;
+
+    static Key key(std::string const & device, std::string const & variant, int size) {
+      return {device, variant, size};
+    }
+
+    std::string path;
+    std::map<Key, TuningEntry> entries;
+
+    void load() {
+      std::ifstream in(path);
+      std::string line;
+      while(std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string device, variant, size, nbpt, nwg, duration;
+        if(!std::getline(fields, device, '\t') ||
+           !std::getline(fields, variant, '\t') ||
+           !std::getline(fields, size, '\t') ||
+           !std::getline(fields, nbpt, '\t') ||
+           !std::getline(fields, nwg, '\t') ||
+           !std::getline(fields, duration, '\t')) {
+          std::cerr << "ignoring malformed line in tuning db: " << line << std::endl;
+          continue;
+        }
+        TuningEntry e;
+        e.config.nButterfliesPerThread = std::stoi(nbpt);
+        e.config.nWorkgroups = std::stoi(nwg);
+        e.duration_ns = std::stod(duration);
+        std::string twiddles, generator, layout, io, shuffles;
+        if(std::getline(fields, twiddles, '\t')) {
+          try {
+            e.config.twiddles = twiddleStorageFromString(twiddles);
+            if(std::getline(fields, generator, '\t')) {
+              e.config.generator = generatedKernelOptionsFromString(generator);
+              if(std::getline(fields, layout, '\t')) {
+                e.config.layout = localLayoutFromString(layout);
+                if(std::getline(fields, io, '\t')) {
+                  e.config.io = ioStorageFromString(io);
+                  if(std::getline(fields, shuffles, '\t')) {
+                    e.config.shuffles = subgroupShufflesFromString(shuffles);
+                  }
+                }
+              }
+            }
+          }
+          catch(std::runtime_error const & err) {
+            std::cerr << "ignoring malformed line in tuning db: " << line << std::endl;
+            continue;
+          }
+        }
+        entries[key(device, variant, std::stoi(size))] = e;
+      }
+    }
+
+    void save() const {
+      std::ofstream out(path, std::ios::out | std::ios::trunc);
+      if(!out) {
+        std::cerr << "could not write the tuning db to " << path << std::endl;
+        return;
+      }
+      for(auto const & [k, e] : entries) {
+        out << std::get<0>(k) << '\t' << std::get<1>(k) << '\t' << std::get<2>(k) << '\t'
+        << e.config.nButterfliesPerThread << '\t' << e.config.nWorkgroups << '\t'
+        << e.duration_ns << '\t' << toString(e.config.twiddles) << '\t' << toString(e.config.generator)
+        << '\t' << toString(e.config.layout) << '\t' << toString(e.config.io)
+        << '\t' << toString(e.config.shuffles) << '\n';
+      }
+    }
+
+    TuningDb(const TuningDb&) = delete;
+    TuningDb& operator=(const TuningDb&) = delete;
+    TuningDb(TuningDb&&) = delete;
+    TuningDb& operator=(TuningDb&&) = delete;
+  };
+
+  /*
+   The median end-to-end duration of a function, in nanoseconds, measured once per (device, variant, size)
+   and stored in the db with a default configuration.
+   'makeRun()' returns the function to measure, it is called only when the duration is not in the db.
+   The variant is prefixed so that these entries never match the variant of a kernel (see 'tunedConfig').
+   */
+  template<typename MakeRun>
+  double measuredDuration(std::string const & device, std::string const & variant, int size, MakeRun && makeRun) {
+    constexpr int nIterations = 20;
+    constexpr int nSkipIterations = 2;
+
+    auto & db = TuningDb::getInstance();
+    std::string const v = "end_to_end/" + variant;
+    if(auto const * e = db.find(device, v, size)) {
+      return e->duration_ns;
+    }
+    auto run = makeRun();
+    std::vector<double> durations;
+    for(int i=0; i<nSkipIterations+nIterations; ++i) {
+      auto const start = std::chrono::steady_clock::now();
+      run();
+      auto const end = std::chrono::steady_clock::now();
+      if(i>=nSkipIterations) {
+        durations.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+      }
+    }
+    std::sort(durations.begin(), durations.end());
+    double const median = durations[durations.size()/2];
+    db.set(device, v, size, TuningEntry{GpuFftConfig{}, median});
+    return median;
+  }
+
+} // NS imajuscule
@@ -0,0 +1,59 @@
+/*
+ Access to the twiddle factors, in the storage selected by the plan (see twiddles.cpp).
+
+ 'twiddle(t)' is exp(i * t * MINUS_PI_over_N_GLOBAL_BUTTERFLIES), i.e. exp(-2*i*pi*t/N)
+ for ffts of size N, 0 <= t < N.
+
+ The kernel defines TWIDDLE_STORAGE (replaced by the plan) before including this file.
+
+ When the twiddles are not computed on the fly, they are read from a table
+ that the kernel receives as its last argument: the kernels (and the functions using 'twiddle')
+ end their parameter list with 'TWIDDLES_PARAM', and the calls with 'TWIDDLES_PASS'.
+ */
+
+#define TWIDDLES_ON_THE_FLY 0
+#define TWIDDLES_CONSTANT   1
+#define TWIDDLES_GLOBAL     2
+#define TWIDDLES_IMAGE      3
+
+#ifndef TWIDDLE_STORAGE
+#error "the kernel must define TWIDDLE_STORAGE"
+#endif
+
+#if TWIDDLE_STORAGE == TWIDDLES_ON_THE_FLY
+
+#define TWIDDLES_PARAM
+#define TWIDDLES_PASS
+#define twiddle(t) polar((t) * MINUS_PI_over_N_GLOBAL_BUTTERFLIES)
+
+#elif TWIDDLE_STORAGE == TWIDDLES_CONSTANT
+
+#define TWIDDLES_PARAM , __constant const struct cplx * twiddles
+#define TWIDDLES_PASS , twiddles
+#define twiddle(t) twiddles[t]
+
+#elif TWIDDLE_STORAGE == TWIDDLES_GLOBAL
+
+#define TWIDDLES_PARAM , __global const struct cplx * restrict twiddles
+#define TWIDDLES_PASS , twiddles
+#define twiddle(t) twiddles[t]
+
+#elif TWIDDLE_STORAGE == TWIDDLES_IMAGE
+
+#define TWIDDLES_PARAM , __read_only image1d_t twiddles
+#define TWIDDLES_PASS , twiddles
+
+__constant sampler_t twiddles_sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+// The image has one texel per twiddle, with the real part in the 'x' channel and the imaginary part in the 'y' channel.
+inline struct cplx readTwiddle(__read_only image1d_t img, int const t) {
+  float4 const v = read_imagef(img, twiddles_sampler, t);
+  struct cplx c;
+  c.real = v.x;
+  c.imag = v.y;
+  return c;
+}
+
+#define twiddle(t) readTwiddle(twiddles, (t))
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ The twiddle factors of the fft kernels (see twiddles.c for the kernel side):
+
+ - 'TwiddleStorage' selects whether the kernel computes them on the fly, or reads them
+   from a table in constant memory, global memory or an image,
+ - 'twiddleTable' computes the table of a size once, in double precision,
+ - 'GpuTwiddles' uploads a table to the device, in the selected storage.
+ */
+
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace imajuscule {
+
+  enum class TwiddleStorage {
+    // A table in global memory if the kernel supports tables, else 'OnTheFly'.
+    Auto,
+    // The kernel computes the twiddles with 'polar', whose accuracy is reduced by -cl-fast-relaxed-math.
+    OnTheFly,
+    Constant,
+    Global,
+    Image
+  };
+
+  constexpr TwiddleStorage explicitTwiddleStorages[] = {
+    TwiddleStorage::OnTheFly, TwiddleStorage::Constant, TwiddleStorage::Global, TwiddleStorage::Image
+  };
+
+  const char * toString(TwiddleStorage s) {
+    switch(s) {
+      case TwiddleStorage::Auto: return "auto";
+      case TwiddleStorage::OnTheFly: return "onthefly";
+      case TwiddleStorage::Constant: return "constant";
+      case TwiddleStorage::Global: return "global";
+      case TwiddleStorage::Image: return "image";
+    }
+    return "";
+  }
+
+  TwiddleStorage twiddleStorageFromString(std::string const & str) {
+    for(auto s : {TwiddleStorage::Auto, TwiddleStorage::OnTheFly, TwiddleStorage::Constant, TwiddleStorage::Global, TwiddleStorage::Image}) {
+      if(str == toString(s)) {
+        return s;
+      }
+    }
+    throw std::runtime_error("unknown twiddle storage: " + str);
+  }
+
+  // The value of 'TWIDDLE_STORAGE' in twiddles.c
+  int kernelTwiddleStorage(TwiddleStorage s) {
+    switch(s) {
+      case TwiddleStorage::OnTheFly: return 0;
+      case TwiddleStorage::Constant: return 1;
+      case TwiddleStorage::Global: return 2;
+      case TwiddleStorage::Image: return 3;
+      case TwiddleStorage::Auto: break;
+    }
+    throw std::runtime_error("the twiddle storage must be resolved");
+  }
+
+  // The kernels reading the twiddles with 'twiddle(t)' (see twiddles.c) support the tables.
+  bool kernelSupportsTwiddleTables(std::string const & kernel_src) {
+    return kernel_src.find("replace_TWIDDLE_STORAGE") != std::string::npos;
+  }
+
+  TwiddleStorage resolveTwiddleStorage(TwiddleStorage s, std::string const & kernel_src) {
+    bool const tables = kernelSupportsTwiddleTables(kernel_src);
+    if(s == TwiddleStorage::Auto) {
+      return tables ? TwiddleStorage::Global : TwiddleStorage::OnTheFly;
+    }
+    if(s != TwiddleStorage::OnTheFly && !tables) {
+      throw std::runtime_error("this kernel computes the twiddles on the fly");
+    }
+    return s;
+  }
+
+  /*
+   Returns exp(-2*i*pi*t/size), for 0 <= t < size.
+
+   The tables are computed once per size, in double precision.
+   */
+  template<typename T>
+  std::vector<std::complex<T>> const & twiddleTable(int size) {
+    static std::mutex mutex;
+    static std::map<int, std::vector<std::complex<T>>> tables;
+
+    std::lock_guard<std::mutex> l(mutex);
+    auto & table = tables[size];
+    if(table.empty()) {
+      table.reserve(size);
+      for(int t=0; t<size; ++t) {
+        auto const z = std::polar(1., -2. * M_PI * t / size);
+        table.emplace_back(static_cast<T>(z.real()), static_cast<T>(z.imag()));
+      }
+    }
+    return table;
+  }
+
+  // The twiddles of an fft of size 'size', in device memory.
+  template<typename T>
+  struct GpuTwiddles {
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "'T' is the type of the computations");
+
+    // 'nTwiddles' is the number of twiddles used by the kernel (size/2 for radix-2 kernels).
+    // Throws std::runtime_error if the device doesn't support this storage for this table size.
+    GpuTwiddles(cl_context context, cl_device_id device_id, int size, int nTwiddles, TwiddleStorage s) :
+    storage(s)
+    {
+      verify(storage != TwiddleStorage::Auto && storage != TwiddleStorage::OnTheFly);
+      verify(nTwiddles <= size);
+      auto const & table = twiddleTable<T>(size);
+      size_t const bytes = nTwiddles * sizeof(std::complex<T>);
+      void * data = const_cast<std::complex<T> *>(table.data());
+
+      cl_int ret;
+      if(storage == TwiddleStorage::Image) {
+        if(!std::is_same_v<T, float>) {
+          throw std::runtime_error("the twiddle images contain floats");
+        }
+        cl_bool images;
+        ret = clGetDeviceInfo(device_id, CL_DEVICE_IMAGE_SUPPORT, sizeof(images), &images, NULL);
+        CHECK_CL_ERROR(ret);
+        if(!images) {
+          throw std::runtime_error("the device doesn't support images");
+        }
+        size_t max_width;
+        ret = clGetDeviceInfo(device_id, CL_DEVICE_IMAGE2D_MAX_WIDTH, sizeof(max_width), &max_width, NULL);
+        CHECK_CL_ERROR(ret);
+        if(static_cast<size_t>(nTwiddles) > max_width) {
+          throw std::runtime_error("the twiddles don't fit in an image");
+        }
+        cl_image_format format;
+        format.image_channel_order = CL_RG;
+        format.image_channel_data_type = CL_FLOAT;
+        cl_image_desc desc;
+        memset(&desc, 0, sizeof(desc));
+        desc.image_type = CL_MEM_OBJECT_IMAGE1D;
+        desc.image_width = nTwiddles;
+        mem_obj = clCreateImage(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, &format, &desc, data, &ret);
+        CHECK_CL_ERROR(ret);
+        return;
+      }
+
+      if(storage == TwiddleStorage::Constant) {
+        cl_ulong max_constant;
+        ret = clGetDeviceInfo(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(max_constant), &max_constant, NULL);
+        CHECK_CL_ERROR(ret);
+        if(bytes > max_constant) {
+          throw std::runtime_error("the twiddles don't fit in constant memory");
+        }
+      }
+      mem_obj = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, data, &ret);
+      CHECK_CL_ERROR(ret);
+    }
+
+    ~GpuTwiddles() {
+      LOG_CL_ERROR(clReleaseMemObject(mem_obj));
+    }
+
+    TwiddleStorage getStorage() const { return storage; }
+    cl_mem const & getMemObject() const { return mem_obj; }
+
+  private:
+    TwiddleStorage storage;
+    cl_mem mem_obj;
+
+    GpuTwiddles(const GpuTwiddles&) = delete;
+    GpuTwiddles& operator=(const GpuTwiddles&) = delete;
+    GpuTwiddles(GpuTwiddles&&) = delete;
+    GpuTwiddles& operator=(GpuTwiddles&&) = delete;
+  };
+
+} // NS imajuscule
@@ -1,30 +1,132 @@
 
+#define PRECISION                 replace_PRECISION // see precision.cpp
 #include "cplx.c"
 
 #define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // must be a power of 2
 #define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
 #define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
 #define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch
+#define TWIDDLE_STORAGE           replace_TWIDDLE_STORAGE // see twiddles.c
+#define BIT_REVERSE_INPUT         replace_BIT_REVERSE_INPUT // 1 if the input is in natural order, 0 if it is bit-reversed
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+#define SUBGROUP_SHUFFLE          replace_SUBGROUP_SHUFFLE // see subgroups.c
 
-__kernel void kernel_func(__local struct cplx* output,
-                          __global const float *input,
-                          __global struct cplx *global_output) {
+#define LOG2_SIZE                 (LOG2_N_GLOBAL_BUTTERFLIES+1)
+#define LOCAL_BUFFER_SIZE         (2*N_GLOBAL_BUTTERFLIES)
+
+#include "twiddles.c"
+#include "local_layout.c"
+#include "subgroups.c"
+
+// Reverses the LOG2_SIZE lower bits of 'm' (Knuth's algorithm, see bitReverse.cpp)
+inline int bitReverse(int const m) {
+  uint a = m;
+  uint t;
+  a = (a << 15) | (a >> 17);
+  t = (a ^ (a >> 10)) & 0x003f801f;
+  a = (t + (t << 10)) ^ a;
+  t = (a ^ (a >>  4)) & 0x0e038421;
+  a = (t + (t <<  4)) ^ a;
+  t = (a ^ (a >>  2)) & 0x22488842;
+  a = (t + (t <<  2)) ^ a;
+  return a >> (32 - LOG2_SIZE);
+}
+
+// The butterfly of the elements 'idx' and 'idx + i'
+inline void butterflyLocal(__local scalar *v, int const idx, int const i, const struct cplx w) {
+  struct cplx const a = getLocal(v, idx);
+  struct cplx const t = cplxMult(getLocal(v, idx + i), w);
+  setLocal(v, idx + i, cplxSub(a, t));
+  setLocal(v, idx, cplxAdd(a, t));
+}
+
+// The butterfly of the elements 'idx' and 'idx + i', in private memory
+inline void butterflyPrivate(struct cplx *v, int const idx, int const i, const struct cplx w) {
+  struct cplx const a = v[idx];
+  struct cplx const t = cplxMult(v[idx + i], w);
+  v[idx + i] = cplxSub(a, t);
+  v[idx] = cplxAdd(a, t);
+}
+
+__kernel void kernel_func(__local scalar* output,
+                          __global const REAL_STORAGE *input,
+                          __global CPLX_STORAGE *global_output
+                          TWIDDLES_PARAM) {
   int const k = get_global_id(0);
+
+  // When computing a batch of ffts, the fft is selected by the second dimension of the NDRange.
+  input += get_global_id(1) * INPUT_STRIDE;
+  global_output += CPLX_STORAGE_OFFSET(get_global_id(1) * OUTPUT_STRIDE);
+
   int const base_idx = k * N_LOCAL_BUTTERFLIES;
   
-  for(int j=0; j<2*N_LOCAL_BUTTERFLIES; ++j) {
-    int const m = get_global_size(0) * j + k;
-    // coalesced global memory read, local memory write with no bank conflict.
-    output[m] = complexFromReal(input[m]);
+  if(BIT_REVERSE_INPUT) {
+    for(int j=0; j<2*N_LOCAL_BUTTERFLIES; ++j) {
+      int const m = get_global_size(0) * j + k;
+      // coalesced global memory read, the bit-reversed local memory writes are scattered.
+      setLocal(output, bitReverse(m), complexFromReal(loadReal(input, m)));
+    }
+  }
+  else {
+    // coalesced global memory read
+    loadRealsToBuffer(input, output, 2*N_LOCAL_BUTTERFLIES);
   }
   
   barrier(CLK_LOCAL_MEM_FENCE);
 
   // i = size of a butterfly half
   // LOG2_N_GLOBAL_BUTTERFLIES_over_i = log2(N_GLOBAL_BUTTERFLIES / i)
-  for(int i=1, LOG2_N_GLOBAL_BUTTERFLIES_over_i = LOG2_N_GLOBAL_BUTTERFLIES;
-      i <= N_GLOBAL_BUTTERFLIES;
-      i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i)
+  int i = 1;
+  int LOG2_N_GLOBAL_BUTTERFLIES_over_i = LOG2_N_GLOBAL_BUTTERFLIES;
+
+#if SUBGROUP_SHUFFLE != SUBGROUP_SHUFFLE_NONE
+  // The stages where the butterflies are within the 2*N_LOCAL_BUTTERFLIES elements of a work item,
+  // then within the elements of a sub-group, are computed in private memory, without barriers.
+  // OpenCL doesn't specify which local ids form a sub-group, so here the elements of a work item
+  // are given by its position in the sub-groups, not by 'k': the sub-groups have get_max_sub_group_size()
+  // work items (a power of 2 dividing the workgroup size) except maybe the last one, so the positions
+  // are a permutation of the local ids, and the elements of a sub-group are consecutive.
+  // (the local memory accesses before and after this block are separated from it by barriers)
+  {
+    uint const lane = get_sub_group_local_id();
+    int const sub_group_base_idx = (get_sub_group_id() * get_max_sub_group_size() + lane) * N_LOCAL_BUTTERFLIES;
+
+    struct cplx v[2*N_LOCAL_BUTTERFLIES];
+    for(int r=0; r<2*N_LOCAL_BUTTERFLIES; ++r) {
+      v[r] = getLocal(output, 2*sub_group_base_idx + r);
+    }
+
+    for(; i <= N_LOCAL_BUTTERFLIES; i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i) {
+      for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j) {
+        int const m = sub_group_base_idx + j;
+        int const idx = m + (m & ~(i-1));
+        int const tIdx = (m & (i-1)) << LOG2_N_GLOBAL_BUTTERFLIES_over_i;
+        butterflyPrivate(v, idx - 2*sub_group_base_idx, i, twiddle(tIdx));
+      }
+    }
+
+    // The element 'r' of the work item is paired with the element 'r' of the work item
+    // whose sub-group local id differs by 'h': the first one has the lower index.
+    for(uint h=1, sub_group_sz = get_sub_group_size(); h < sub_group_sz; h <<= 1, i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i) {
+      for(int r=0; r<2*N_LOCAL_BUTTERFLIES; ++r) {
+        int const idx = 2*sub_group_base_idx + r;
+        struct cplx const other = shuffleXor(v[r], h);
+        struct cplx const w = twiddle((idx & (i-1)) << LOG2_N_GLOBAL_BUTTERFLIES_over_i);
+        v[r] = (lane & h) ? cplxSub(other, cplxMult(v[r], w)) : cplxAdd(v[r], cplxMult(other, w));
+      }
+    }
+
+    // (the work item writes the elements it has read)
+    for(int r=0; r<2*N_LOCAL_BUTTERFLIES; ++r) {
+      setLocal(output, 2*sub_group_base_idx + r, v[r]);
+    }
+  }
+#endif
+
+  for(; i <= N_GLOBAL_BUTTERFLIES; i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i)
   {
     // During the first iterations, there is no need for synchronisation
     // because we only use memory locations where our thread has written to.
@@ -45,15 +147,12 @@ __kernel void kernel_func(__local struct cplx* output,
       //assert(idx+i < Sz);
       int const tIdx = (m & (i-1)) << LOG2_N_GLOBAL_BUTTERFLIES_over_i;
       
-      butterfly(output+idx, i, polar(tIdx * MINUS_PI_over_N_GLOBAL_BUTTERFLIES));
+      butterflyLocal(output, idx, i, twiddle(tIdx));
     }
   }
   
   barrier(CLK_LOCAL_MEM_FENCE);
   
-  for(int j=0; j<2*N_LOCAL_BUTTERFLIES; ++j) {
-    int const m = get_global_size(0) * j + k;
-    // coalesced global memory write
-    global_output[m] = output[m];
-  }
+  // coalesced global memory write
+  storeCplxsFromBuffer(global_output, output, 2*N_LOCAL_BUTTERFLIES);
 }
@@ -0,0 +1,133 @@
+#define PRECISION                 replace_PRECISION // see precision.cpp
+#include "cplx.c"
+
+/*
+ Kernels of the ffts that don't fit in local memory (see gpu_huge_fft_plan.cpp):
+ the fft of size N = N1 * N2 is decomposed in batches of ffts of size N1 and N2
+ which fit in local memory, separated by tiled transposes.
+
+ 'row_ffts' is specialized for ffts of size 2*N_GLOBAL_BUTTERFLIES.
+ */
+
+#define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // must be a power of 2
+#define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
+#define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
+#define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+#define LOCAL_BUFFER_SIZE         (2*N_GLOBAL_BUTTERFLIES)
+
+#include "local_layout.c"
+
+// The dimension of the square tiles of the transposes.
+// The local size of the transposes is (TILE_DIM, TILE_DIM), or less for smaller matrices.
+#define TILE_DIM 16
+
+
+inline int expand(int idxL, int log2N1, int mm) {
+  return ((idxL-mm) << 1) + mm;
+}
+
+__kernel void real_to_complex(__global const REAL_STORAGE *input,
+                              __global CPLX_STORAGE *output) {
+  int const i = get_global_id(0);
+  storeCplx(output, i, complexFromReal(loadReal(input, i)));
+}
+
+/*
+ Transposes the matrices of a batch (the matrix is selected by the third dimension of the NDRange).
+ The first dimension of the NDRange is the number of columns, the second dimension is the number of rows.
+
+ The tile is padded by one column so that the column-wise accesses to local memory
+ don't have bank conflicts (so it doesn't use the layouts of local_layout.c, which are for the buffers of 'row_ffts'), and both the global memory reads and writes are coalesced.
+
+ If 'minus_two_pi_over_n' is not 0, the element (row, col) of the input is multiplied by
+ exp(i * minus_two_pi_over_n * row * col) (the twiddle factors of the four-step fft).
+ */
+__kernel void transpose(__global const CPLX_STORAGE *input,
+                        __global CPLX_STORAGE *output,
+                        scalar const minus_two_pi_over_n) {
+  __local struct cplx tile[TILE_DIM][TILE_DIM+1];
+
+  int const cols = get_global_size(0);
+  int const rows = get_global_size(1);
+  int const matrix_offset = get_global_id(2) * rows * cols;
+  input += CPLX_STORAGE_OFFSET(matrix_offset);
+  output += CPLX_STORAGE_OFFSET(matrix_offset);
+
+  int const tile_dim = get_local_size(0);
+  int const lx = get_local_id(0);
+  int const ly = get_local_id(1);
+  int const col0 = get_group_id(0) * tile_dim;
+  int const row0 = get_group_id(1) * tile_dim;
+
+  {
+    int const row = row0 + ly;
+    int const col = col0 + lx;
+    struct cplx v = loadCplx(input, row * cols + col);
+    if(minus_two_pi_over_n != 0) {
+      v = cplxMult(v, polar(minus_two_pi_over_n * (row * col)));
+    }
+    tile[ly][lx] = v;
+  }
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // the output has 'cols' rows and 'rows' columns.
+  storeCplx(output, (col0 + ly) * rows + row0 + lx, tile[lx][ly]);
+}
+
+// A batch of ffts of complex inputs of size 2*N_GLOBAL_BUTTERFLIES
+// (the fft is selected by the second dimension of the NDRange).
+__kernel void row_ffts(__global const CPLX_STORAGE *input,
+                       __global CPLX_STORAGE *global_output,
+                       __local scalar* pingpong) {
+  int const k = get_global_id(0);
+
+  input += CPLX_STORAGE_OFFSET(get_global_id(1) * INPUT_STRIDE);
+  global_output += CPLX_STORAGE_OFFSET(get_global_id(1) * OUTPUT_STRIDE);
+
+  int const base_idx = k * N_LOCAL_BUTTERFLIES;
+
+  __local scalar *prev = pingpong;
+  __local scalar *next = pingpong + LOCAL_BUFFER_SCALARS;
+
+  // coalesced global memory read
+  loadCplxsToBuffer(input, prev, 2*N_LOCAL_BUTTERFLIES);
+
+  for(int i=1, LOG2_N_GLOBAL_BUTTERFLIES_over_i = LOG2_N_GLOBAL_BUTTERFLIES, log2i = 0;
+      i <= N_GLOBAL_BUTTERFLIES;
+      i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i, ++log2i)
+  {
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j)
+    {
+      int const m = base_idx + j;
+      int const mm = m & (i-1);
+
+      int idxD = expand(m, log2i, mm);
+      int const tIdx = mm << LOG2_N_GLOBAL_BUTTERFLIES_over_i;
+
+      struct cplx const t = cplxMult(getLocal(prev, m + N_GLOBAL_BUTTERFLIES),
+                                     polar(tIdx * MINUS_PI_over_N_GLOBAL_BUTTERFLIES));
+      struct cplx const a = getLocal(prev, m);
+      setLocal(next, idxD + i, cplxSub(a, t));
+      setLocal(next, idxD, cplxAdd(a, t));
+    }
+
+    // swap(prev,next)
+    {
+      __local scalar * tmp = prev;
+      prev = next;
+      next = tmp;
+    }
+  }
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // coalesced global memory write
+  storeCplxsFromBuffer(global_output, prev, 2*N_LOCAL_BUTTERFLIES);
+}
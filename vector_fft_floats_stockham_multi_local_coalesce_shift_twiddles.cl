@@ -1,29 +1,46 @@
+#define PRECISION                 replace_PRECISION // see precision.cpp
 #include "cplx.c"
 
 #define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // must be a power of 2
 #define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
 #define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
 #define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch
+#define TWIDDLE_STORAGE           replace_TWIDDLE_STORAGE // see twiddles.c
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+#define STFT_WINDOW               replace_STFT_WINDOW // see stft.c
+#define SPECTRUM_OUTPUT           replace_SPECTRUM_OUTPUT
+#define IMAGE_IO                  replace_IMAGE_IO // see image_io.c
+#define LOG2_IMAGE_WIDTH          replace_LOG2_IMAGE_WIDTH
+#define LOCAL_BUFFER_SIZE         (2*N_GLOBAL_BUTTERFLIES)
+
+#include "twiddles.c"
+#include "local_layout.c"
+#include "stft.c"
+#include "image_io.c"
 
 
 inline int expand(int idxL, int log2N1, int mm) {
   return ((idxL-mm) << 1) + mm;
 }
 
-__kernel void kernel_func(__global const float *input,
-                          __global struct cplx *global_output,
-                          __local struct cplx* pingpong) {
+__kernel void kernel_func(INPUT_PARAM,
+                          OUTPUT_PARAM,
+                          __local scalar* pingpong
+                          TWIDDLES_PARAM
+                          WINDOW_PARAM) {
   int const k = get_global_id(0);
+
   int const base_idx = k * N_LOCAL_BUTTERFLIES;
 
-  __local struct cplx *prev = pingpong;
-  __local struct cplx *next = pingpong + 2*N_GLOBAL_BUTTERFLIES;
+  __local scalar *prev = pingpong;
+  __local scalar *next = pingpong + LOCAL_BUFFER_SCALARS;
 
-  for(int j=0; j<2*N_LOCAL_BUTTERFLIES; ++j) {
-    int const m = get_global_size(0) * j + k;
-    // coalesced global memory read, local memory write with no bank conflict.
-    prev[m] = complexFromReal(input[m]);
-  }
+  // coalesced global memory read
+  // (when computing a batch of ffts, the fft is selected by the second dimension of the NDRange)
+  loadInput(input, prev, 2*N_LOCAL_BUTTERFLIES WINDOW_PASS);
 
   for(int i=1, LOG2_N_GLOBAL_BUTTERFLIES_over_i = LOG2_N_GLOBAL_BUTTERFLIES, log2i = 0;
       i <= N_GLOBAL_BUTTERFLIES;
@@ -39,13 +56,15 @@ __kernel void kernel_func(__global const float *input,
       int idxD = expand(m, log2i, mm);
       int const tIdx = mm << LOG2_N_GLOBAL_BUTTERFLIES_over_i;
       
-      butterfly_outofplace(m,idxD,prev,next, N_GLOBAL_BUTTERFLIES, i,
-                           polar(tIdx * MINUS_PI_over_N_GLOBAL_BUTTERFLIES));
+      struct cplx const t = cplxMult(getLocal(prev, m + N_GLOBAL_BUTTERFLIES), twiddle(tIdx));
+      struct cplx const a = getLocal(prev, m);
+      setLocal(next, idxD + i, cplxSub(a, t));
+      setLocal(next, idxD, cplxAdd(a, t));
     }
 
     // swap(prev,next)
     {
-      __local struct cplx * tmp = prev;
+      __local scalar * tmp = prev;
       prev = next;
       next = tmp;
     }
@@ -53,9 +72,6 @@ __kernel void kernel_func(__global const float *input,
   
   barrier(CLK_LOCAL_MEM_FENCE);
 
-  for(int j=0; j<2*N_LOCAL_BUTTERFLIES; ++j) {
-    int const m = get_global_size(0) * j + k;
-    // coalesced global memory write
-    global_output[m] = prev[m];
-  }
+  // coalesced global memory write
+  storeOutput(global_output, prev, 2*N_LOCAL_BUTTERFLIES);
 }
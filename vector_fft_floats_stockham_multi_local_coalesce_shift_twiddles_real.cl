@@ -0,0 +1,161 @@
+#include "cplx.c"
+
+/*
+ Fft of real signals of size N: the N reals are seen as N/2 complex numbers
+ z[n] = x[2n] + i*x[2n+1] (which is the same memory layout), an N/2 Stockham fft is computed
+ in local memory, and a post-processing pass separates the spectrums of the even and odd samples
+ to produce the N/2+1 first bins of the spectrum (the other bins are the conjugates of these).
+
+ The kernel is specialized for the fft of size N/2, i.e. N_GLOBAL_BUTTERFLIES = N/4.
+ */
+
+#define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // must be a power of 2
+#define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
+#define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
+#define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance (in reals) between the signals of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance (in bins) between the spectrums of consecutive ffts of a batch
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+
+#define N_COMPLEX (2*N_GLOBAL_BUTTERFLIES)
+#define LOCAL_BUFFER_SIZE N_COMPLEX
+// the angle of exp(-2*i*pi/N), where N = 2*N_COMPLEX is the size of the real signal
+#define MINUS_TWO_PI_over_N (0.5f * MINUS_PI_over_N_GLOBAL_BUTTERFLIES)
+
+#include "local_layout.c"
+
+
+inline int expand(int idxL, int log2N1, int mm) {
+  return ((idxL-mm) << 1) + mm;
+}
+
+// Computes the fft of size N_COMPLEX of 'prev', using 'next' as scratch memory,
+// and returns the buffer containing the result.
+inline __local scalar * stockham_passes(__local scalar *prev,
+                                        __local scalar *next) {
+  int const base_idx = get_global_id(0) * N_LOCAL_BUTTERFLIES;
+
+  for(int i=1, LOG2_N_GLOBAL_BUTTERFLIES_over_i = LOG2_N_GLOBAL_BUTTERFLIES, log2i = 0;
+      i <= N_GLOBAL_BUTTERFLIES;
+      i <<= 1, --LOG2_N_GLOBAL_BUTTERFLIES_over_i, ++log2i)
+  {
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j)
+    {
+      int const m = base_idx + j;
+      int const mm = m & (i-1);
+
+      int idxD = expand(m, log2i, mm);
+      int const tIdx = mm << LOG2_N_GLOBAL_BUTTERFLIES_over_i;
+
+      struct cplx const t = cplxMult(getLocal(prev, m + N_GLOBAL_BUTTERFLIES),
+                                     polar(tIdx * MINUS_PI_over_N_GLOBAL_BUTTERFLIES));
+      struct cplx const a = getLocal(prev, m);
+      setLocal(next, idxD + i, cplxSub(a, t));
+      setLocal(next, idxD, cplxAdd(a, t));
+    }
+
+    // swap(prev,next)
+    {
+      __local scalar * tmp = prev;
+      prev = next;
+      next = tmp;
+    }
+  }
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return prev;
+}
+
+// The bin m < N_COMPLEX of the spectrum, where 'z' is the fft of the packed signal.
+inline struct cplx forwardBin(__local scalar const *z, int const m) {
+  struct cplx const zk = getLocal(z, m);
+  struct cplx const zc = cplxConj(getLocal(z, (N_COMPLEX-m) & (N_COMPLEX-1)));
+  // the spectrums of the even and odd samples
+  struct cplx const even = cplxScalarMult(0.5f, cplxAdd(zk, zc));
+  struct cplx const odd = cplxScalarMult(0.5f, cplxMultMinusI(cplxSub(zk, zc)));
+  return cplxAdd(even, cplxMult(odd, polar(m * MINUS_TWO_PI_over_N)));
+}
+
+// The element m of the packed signal before the inverse fft, where 'xk' is the bin m
+// and 'xm' the bin N_COMPLEX-m of the spectrum.
+inline struct cplx inverseInput(struct cplx const xk, struct cplx const xm, int const m) {
+  struct cplx const xc = cplxConj(xm);
+  // (twice) the spectrums of the even and odd samples
+  struct cplx const even = cplxAdd(xk, xc);
+  struct cplx const odd = cplxMult(cplxSub(xk, xc), polar(-m * MINUS_TWO_PI_over_N));
+  // the inverse fft is computed as conj(fft(conj(.)))
+  return cplxConj(cplxAdd(even, cplxMultI(odd)));
+}
+
+// Forward fft: N reals -> N/2+1 bins
+__kernel void kernel_func(__global const float *input,
+                          __global struct cplx *global_output,
+                          __local scalar* pingpong) {
+  int const k = get_global_id(0);
+
+  // When computing a batch of ffts, the fft is selected by the second dimension of the NDRange.
+  input += get_global_id(1) * INPUT_STRIDE;
+  global_output += get_global_id(1) * OUTPUT_STRIDE;
+
+  __global const struct cplx *packed_input = (__global const struct cplx *)input;
+
+  __local scalar *prev = pingpong;
+  __local scalar *next = pingpong + LOCAL_BUFFER_SCALARS;
+
+  // coalesced global memory reads, 16 bytes wide.
+  loadCplxsToBuffer(packed_input, prev, 2*N_LOCAL_BUTTERFLIES);
+
+  __local scalar const *z = stockham_passes(prev, next);
+
+  // each work item writes the pairs of consecutive bins 2m, 2m+1:
+  // coalesced global memory writes, 16 bytes wide.
+  for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j) {
+    int const m = get_global_size(0) * j + k;
+    storeCplx2(global_output, m, forwardBin(z, 2*m), forwardBin(z, 2*m+1));
+  }
+  if(k == 0) {
+    // the Nyquist bin
+    struct cplx const z0 = getLocal(z, 0);
+    global_output[N_COMPLEX] = (struct cplx) {
+      .real = z0.real - z0.imag,
+      .imag = 0.f
+    };
+  }
+}
+
+// Inverse fft: N/2+1 bins -> N reals. Like the cpu ffts, it is not normalized:
+// inverse(forward(x)) = N * x
+__kernel void kernel_inverse(__global const struct cplx *input,
+                             __global float *global_output,
+                             __local scalar* pingpong) {
+  int const k = get_global_id(0);
+
+  input += get_global_id(1) * OUTPUT_STRIDE;
+  global_output += get_global_id(1) * INPUT_STRIDE;
+
+  __global struct cplx *packed_output = (__global struct cplx *)global_output;
+
+  __local scalar *prev = pingpong;
+  __local scalar *next = pingpong + LOCAL_BUFFER_SCALARS;
+
+  // each work item reads the pairs of consecutive bins 2m, 2m+1 (16 bytes wide, coalesced);
+  // their mirrored bins N_COMPLEX-2m-1, N_COMPLEX-2m straddle two pairs so they are read one by one.
+  for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j) {
+    int const m = get_global_size(0) * j + k;
+    struct cplx x0, x1;
+    loadCplx2(input, m, &x0, &x1);
+    setLocal(prev, 2*m,   inverseInput(x0, loadCplx(input, N_COMPLEX-2*m), 2*m));
+    setLocal(prev, 2*m+1, inverseInput(x1, loadCplx(input, N_COMPLEX-2*m-1), 2*m+1));
+  }
+
+  __local scalar const *z = stockham_passes(prev, next);
+
+  for(int j=0; j<N_LOCAL_BUTTERFLIES; ++j) {
+    int const m = get_global_size(0) * j + k;
+    // coalesced global memory writes, 16 bytes wide
+    storeCplx2(packed_output, m, cplxConj(getLocal(z, 2*m)), cplxConj(getLocal(z, 2*m+1)));
+  }
+}
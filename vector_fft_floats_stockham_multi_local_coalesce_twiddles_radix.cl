@@ -0,0 +1,118 @@
+#define PRECISION                 replace_PRECISION // see precision.cpp
+#include "cplx.c"
+
+#define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // must be a power of 2
+#define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
+#define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
+#define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch
+
+// The fft is done in N_RADIX_PASSES passes of radix RADIX, followed by
+// one pass of radix LAST_RADIX if the size is not a power of RADIX (else LAST_RADIX is 1).
+#define RADIX                     replace_RADIX // 2, 4 or 8
+#define LOG2_RADIX                replace_LOG2_RADIX
+#define N_RADIX_PASSES            replace_N_RADIX_PASSES
+#define LAST_RADIX                replace_LAST_RADIX // 1, 2 or 4
+#define LOG2_LAST_RADIX           replace_LOG2_LAST_RADIX
+#define TWIDDLE_STORAGE           replace_TWIDDLE_STORAGE // see twiddles.c
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+#define STFT_WINDOW               replace_STFT_WINDOW // see stft.c
+#define SPECTRUM_OUTPUT           replace_SPECTRUM_OUTPUT
+#define IMAGE_IO                  replace_IMAGE_IO // see image_io.c
+#define LOG2_IMAGE_WIDTH          replace_LOG2_IMAGE_WIDTH
+
+#define SIZE                      (2*N_GLOBAL_BUTTERFLIES)
+#define LOG2_SIZE                 (LOG2_N_GLOBAL_BUTTERFLIES+1)
+#define LOCAL_BUFFER_SIZE         SIZE
+
+#include "twiddles.c"
+#include "local_layout.c"
+#include "stft.c"
+#include "image_io.c"
+
+/*
+ One radix-R stockham pass, where 'Ns' (= 1 << log2Ns) is the product of the radices of the previous passes:
+
+ the R inputs of the b-th dft are at b + r*SIZE/R,
+ the R outputs of the b-th dft are at expand(b) + r*Ns.
+ */
+inline void stockham_pass(__local scalar const * restrict from,
+                          __local scalar * restrict to,
+                          int const log2Ns,
+                          int const R,
+                          int const log2R
+                          TWIDDLES_PARAM) {
+  int const Ns = 1 << log2Ns;
+  int const nDfts = SIZE >> log2R;
+
+  // When there are less dfts than work items (for the last pass, if its radix is lower),
+  // some work items are idle.
+  for(int b = get_global_id(0); b < nDfts; b += get_global_size(0)) {
+    int const k = b & (Ns-1);
+    // the twiddle angle for r=1 is -2*pi*k / (Ns*R)
+    int const tIdx = k << (LOG2_SIZE - log2Ns - log2R);
+
+    struct cplx v[RADIX];
+    v[0] = getLocal(from, b);
+    for(int r=1; r<R; ++r) {
+      v[r] = cplxMult(getLocal(from, b + r*nDfts),
+                      twiddle(r * tIdx));
+    }
+
+    dft(v, R);
+
+    int const idxD = ((b-k) << log2R) + k;
+    for(int r=0; r<R; ++r) {
+      setLocal(to, idxD + r*Ns, v[r]);
+    }
+  }
+}
+
+__kernel void kernel_func(INPUT_PARAM,
+                          OUTPUT_PARAM,
+                          __local scalar* pingpong
+                          TWIDDLES_PARAM
+                          WINDOW_PARAM) {
+
+  __local scalar *prev = pingpong;
+  __local scalar *next = pingpong + LOCAL_BUFFER_SCALARS;
+
+  // coalesced global memory read
+  // (when computing a batch of ffts, the fft is selected by the second dimension of the NDRange)
+  loadInput(input, prev, 2*N_LOCAL_BUTTERFLIES WINDOW_PASS);
+
+  int log2Ns = 0;
+  for(int pass=0; pass < N_RADIX_PASSES; ++pass, log2Ns += LOG2_RADIX)
+  {
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    stockham_pass(prev, next, log2Ns, RADIX, LOG2_RADIX TWIDDLES_PASS);
+
+    // swap(prev,next)
+    {
+      __local scalar * tmp = prev;
+      prev = next;
+      next = tmp;
+    }
+  }
+
+  if(LAST_RADIX > 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    stockham_pass(prev, next, log2Ns, LAST_RADIX, LOG2_LAST_RADIX TWIDDLES_PASS);
+
+    // swap(prev,next)
+    {
+      __local scalar * tmp = prev;
+      prev = next;
+      next = tmp;
+    }
+  }
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // coalesced global memory write
+  storeOutput(global_output, prev, 2*N_LOCAL_BUTTERFLIES);
+}
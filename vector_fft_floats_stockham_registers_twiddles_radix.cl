@@ -0,0 +1,146 @@
+#define PRECISION                 replace_PRECISION // see precision.cpp
+#include "cplx.c"
+
+#define N_LOCAL_BUTTERFLIES       replace_N_LOCAL_BUTTERFLIES // RADIX/2 (each work item computes one dft per pass)
+#define N_GLOBAL_BUTTERFLIES      replace_N_GLOBAL_BUTTERFLIES // must be a power of 2, and >= N_LOCAL_BUTTERFLIES
+#define LOG2_N_GLOBAL_BUTTERFLIES replace_LOG2_N_GLOBAL_BUTTERFLIES
+#define MINUS_PI_over_N_GLOBAL_BUTTERFLIES replace_MINUS_PI_over_N_GLOBAL_BUTTERFLIES
+#define INPUT_STRIDE              replace_INPUT_STRIDE // distance between the inputs of consecutive ffts of a batch
+#define OUTPUT_STRIDE             replace_OUTPUT_STRIDE // distance between the outputs of consecutive ffts of a batch
+
+// The fft is done in N_RADIX_PASSES passes of radix RADIX, followed by
+// one pass of radix LAST_RADIX if the size is not a power of RADIX (else LAST_RADIX is 1).
+#define RADIX                     replace_RADIX // 8 or 16
+#define LOG2_RADIX                replace_LOG2_RADIX
+#define N_RADIX_PASSES            replace_N_RADIX_PASSES // >= 1
+#define LAST_RADIX                replace_LAST_RADIX // 1, 2, 4 or 8
+#define LOG2_LAST_RADIX           replace_LOG2_LAST_RADIX
+#define TWIDDLE_STORAGE           replace_TWIDDLE_STORAGE // see twiddles.c
+#define LOCAL_LAYOUT              replace_LOCAL_LAYOUT // see local_layout.c
+#define LOG2_LOCAL_BANKS          replace_LOG2_LOCAL_BANKS
+
+#define SIZE                      (2*N_GLOBAL_BUTTERFLIES)
+#define LOG2_SIZE                 (LOG2_N_GLOBAL_BUTTERFLIES+1)
+// The number of work items
+#define N_ITEMS                   (SIZE/RADIX)
+#define LOCAL_BUFFER_SIZE         SIZE
+
+#include "twiddles.c"
+#include "local_layout.c"
+
+/*
+ A stockham kernel where the dfts are computed in private memory (see
+ https://mc.stanford.edu/cgi-bin/images/7/75/SC08_FFT_on_GPUs.pdf): each work item keeps
+ the RADIX inputs of its dft in registers, and a radix-RADIX dft is log2(RADIX) radix-2 passes
+ done without accessing the local memory.
+
+ The local memory is only used to exchange the results between two passes, and a single buffer
+ of SIZE complex numbers is needed (no ping pong), at the cost of a second barrier per exchange.
+ For 4096 points in radix 16, there are 3 passes, 2 exchanges and 3 barriers
+ (the radix-2 kernel has 12 passes through local memory, and 13 barriers).
+
+ The first pass computes its dfts (which have no twiddle factors) right from the global memory reads,
+ so that the latency of the reads of a work item is hidden by the compute of the others,
+ and the last pass writes its outputs to global memory.
+ */
+
+// Multiplies the inputs of the b-th dft of a radix-R pass by the twiddle factors,
+// where 'Ns' (= 1 << log2Ns) is the product of the radices of the previous passes.
+inline void twiddle_inputs(struct cplx * v,
+                           int const b,
+                           int const log2Ns,
+                           int const R,
+                           int const log2R
+                           TWIDDLES_PARAM) {
+  int const k = b & ((1 << log2Ns)-1);
+  // the twiddle angle for r=1 is -2*pi*k / (Ns*R)
+  int const tIdx = k << (LOG2_SIZE - log2Ns - log2R);
+  for(int r=1; r<R; ++r) {
+    v[r] = cplxMult(v[r], twiddle(r * tIdx));
+  }
+}
+
+// The index of the r-th output of the b-th dft of a radix-R pass.
+inline int output_index(int const b, int const r, int const log2Ns, int const log2R) {
+  int const k = b & ((1 << log2Ns)-1);
+  return ((b-k) << log2R) + k + (r << log2Ns);
+}
+
+__kernel void kernel_func(__global const REAL_STORAGE *input,
+                          __global CPLX_STORAGE *global_output,
+                          __local scalar* exchange
+                          TWIDDLES_PARAM) {
+  int const b = get_global_id(0);
+
+  // When computing a batch of ffts, the fft is selected by the second dimension of the NDRange.
+  input += get_global_id(1) * INPUT_STRIDE;
+  global_output += CPLX_STORAGE_OFFSET(get_global_id(1) * OUTPUT_STRIDE);
+
+  struct cplx v[RADIX];
+
+  // The inputs of the b-th dft of the first pass are at b + r*N_ITEMS:
+  // coalesced global memory reads. The consecutive elements belong to consecutive work items,
+  // so unlike the kernels that go through local memory, each access is one element
+  // (loadReal4 / storeCplx2 would need an additional exchange in local memory).
+  for(int r=0; r<RADIX; ++r) {
+    v[r] = complexFromReal(loadReal(input, b + r*N_ITEMS));
+  }
+  dft(v, RADIX);
+
+  int log2Ns = 0;
+  for(int pass=1; pass < N_RADIX_PASSES; ++pass) {
+    // the previous reads of the exchange buffer must be done before we overwrite it.
+    if(pass > 1) {
+      barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    for(int r=0; r<RADIX; ++r) {
+      setLocal(exchange, output_index(b, r, log2Ns, LOG2_RADIX), v[r]);
+    }
+    log2Ns += LOG2_RADIX;
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int r=0; r<RADIX; ++r) {
+      v[r] = getLocal(exchange, b + r*N_ITEMS);
+    }
+    twiddle_inputs(v, b, log2Ns, RADIX, LOG2_RADIX TWIDDLES_PASS);
+    dft(v, RADIX);
+  }
+
+  if(LAST_RADIX == 1) {
+    // in the last pass Ns == N_ITEMS, and b < N_ITEMS, so the outputs are at b + r*Ns: coalesced global memory writes.
+    for(int r=0; r<RADIX; ++r) {
+      storeCplx(global_output, output_index(b, r, log2Ns, LOG2_RADIX), v[r]);
+    }
+    return;
+  }
+
+  if(N_RADIX_PASSES > 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  for(int r=0; r<RADIX; ++r) {
+    setLocal(exchange, output_index(b, r, log2Ns, LOG2_RADIX), v[r]);
+  }
+  log2Ns += LOG2_RADIX;
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // There are RADIX/LAST_RADIX dfts of radix LAST_RADIX per work item:
+  // the j-th one is the dft b + j*N_ITEMS of the pass.
+  for(int j=0; j<RADIX/LAST_RADIX; ++j) {
+    struct cplx * w = v + j*LAST_RADIX;
+    int const d = b + j*N_ITEMS;
+    for(int r=0; r<LAST_RADIX; ++r) {
+      w[r] = getLocal(exchange, d + r*(SIZE/LAST_RADIX));
+    }
+    twiddle_inputs(w, d, log2Ns, LAST_RADIX, LOG2_LAST_RADIX TWIDDLES_PASS);
+    dft(w, LAST_RADIX);
+  }
+  for(int j=0; j<RADIX/LAST_RADIX; ++j) {
+    // d < Ns, so the outputs are at d + r*Ns: coalesced global memory writes.
+    int const d = b + j*N_ITEMS;
+    for(int r=0; r<LAST_RADIX; ++r) {
+      storeCplx(global_output, output_index(d, r, log2Ns, LOG2_LAST_RADIX), v[j*LAST_RADIX + r]);
+    }
+  }
+}
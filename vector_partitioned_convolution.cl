@@ -0,0 +1,49 @@
+#include "cplx.c"
+
+/*
+ Kernels of the uniformly partitioned overlap-save convolution (see gpu_convolution.cpp),
+ used between the real ffts so that the spectrums stay on the device.
+ */
+
+// Builds the input of the forward fft: the previous block followed by the current block.
+// 'history' contains the 2 last blocks, 'offset' is the position of the previous block in 'history'.
+// The global size is the fft size.
+__kernel void overlap_save_input(__global const float *history,
+                                 __global float *signal,
+                                 int const offset) {
+  int const i = get_global_id(0);
+  signal[i] = history[(offset + i) & (get_global_size(0) - 1)];
+}
+
+// Pushes the spectrum of the current block in the frequency-domain delay line (at 'slot'),
+// and replaces it by the sum, over the partitions of the impulse response, of the spectrums
+// of the delayed blocks multiplied by the spectrums of the partitions.
+// The global size is the number of bins.
+__kernel void spectral_mac(__global struct cplx *spectrum,
+                           __global struct cplx *fdl,
+                           __global const struct cplx *ir_spectrums,
+                           int const nPartitions,
+                           int const slot) {
+  int const k = get_global_id(0);
+  int const nBins = get_global_size(0);
+
+  struct cplx const x = spectrum[k];
+  fdl[slot * nBins + k] = x;
+
+  struct cplx acc = cplxMult(x, ir_spectrums[k]);
+  for(int p=1, s=slot; p<nPartitions; ++p) {
+    // the block delayed by 'p' blocks
+    s = (s == 0) ? (nPartitions-1) : (s-1);
+    acc = cplxAdd(acc, cplxMult(fdl[s * nBins + k], ir_spectrums[p * nBins + k]));
+  }
+  spectrum[k] = acc;
+}
+
+// Keeps the last block of the inverse fft (the first block is aliased), and normalizes it.
+// The global size is the block size.
+__kernel void overlap_save_output(__global const float *signal,
+                                  __global float *output,
+                                  float const scale) {
+  int const i = get_global_id(0);
+  output[i] = scale * signal[get_global_size(0) + i];
+}